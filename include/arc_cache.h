@@ -0,0 +1,361 @@
+/**
+ * @author shchang
+ */
+
+#pragma once
+
+#include "cache_common.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace LRUC {
+
+/**
+ * ARCCache is a thread-safe cache with Adaptive Replacement Cache (ARC) eviction.
+ *
+ * Resident entries are in two LRU lists: T1 holds keys seen once recently, T2 keys seen at least
+ * twice. Evicted keys are kept without value in the ghost lists B1 (evicted from T1) and B2
+ * (evicted from T2), up to capacity ghosts in total. Inserting a key found in a ghost list adapts
+ * the target size p of T1: a B1 ghost grows p (recency was evicted too early), a B2 ghost shrinks
+ * it (frequency was evicted too early). Eviction takes the LRU of T1 while T1 is larger than p,
+ * otherwise the LRU of T2.
+ *
+ * Thus the cache follows a workload swinging between recency and frequency heavy patterns without
+ * tuning, a one-off scan only passes through T1.
+ *
+ * find() takes ARCCache::ConstAccessor as argument which stores a copy of the found value; a hit
+ * moves the entry to the MRU of T2. A ghost is a miss.
+ *
+ * contains() and peek() look a key up without moving its entry, a ghost is absent.
+ *
+ * insert() takes key and value to insert into the cache, rvalue arguments are moved.
+ *
+ * erase() takes key to remove the entry from the cache, a ghost of key is kept.
+ *
+ * All operations take one cache-wide mutex, shard the key space over several instances for
+ * heavy concurrent load.
+ */
+template <typename TKey, typename TValue, typename THash = std::hash<TKey>, typename TKeyEqual = std::equal_to<TKey>>
+class ARCCache final {
+ public:
+  using ConstAccessor = CopyAccessor<TValue, ARCCache>;
+
+ private:
+  enum class ListId : uint8_t { T1, T2, B1, B2 };
+
+  // value_ is empty for a ghost.
+  struct Entry final : IntrusiveLink {
+    std::optional<TValue> value_{};
+    const TKey* key_{nullptr};
+    ListId list_{ListId::T1};
+  };
+
+  using EntryList = IntrusiveList<Entry>;
+
+  using HashMap = std::unordered_map<TKey, Entry, THash, TKeyEqual>;
+
+  mutable std::mutex mutex_;
+  HashMap hash_map_;
+  EntryList t1_;
+  EntryList t2_;
+  EntryList b1_;
+  EntryList b2_;
+  const size_t capacity_;
+  // target size of T1, in [0, capacity_].
+  size_t p_;
+
+ private:
+  EntryList& list(ListId id);
+
+  /**
+   * Move entry to the MRU of list id, its value is dropped if id is a ghost list.
+   * Caller holds mutex_.
+   *
+   */
+  void moveTo(Entry* entry, ListId id);
+
+  /**
+   * Evict the LRU of T1 or T2 into its ghost list, as ARC's REPLACE.
+   * b2Hit: the inserted key was found in B2.
+   * Caller holds mutex_.
+   *
+   */
+  void replace(bool b2Hit);
+
+  /**
+   * Erase the LRU entry of list id.
+   * Caller holds mutex_.
+   *
+   */
+  void dropFront(ListId id);
+
+  template <typename TKeyArg, typename TValueArg>
+  bool insertImpl(TKeyArg&& key, TValueArg&& value);
+
+ public:
+  /**
+   * size: capacity in entries, the ghost lists hold up to size keys more.
+   *
+   */
+  explicit ARCCache(size_t size);
+
+  ~ARCCache() noexcept = default;
+
+  ARCCache(const ARCCache&) = delete;
+  ARCCache& operator=(const ARCCache&) = delete;
+
+  /**
+   * find copies the value of key into caccessor and moves the entry to T2.
+   * Return true if key is found.
+   *
+   */
+  bool find(ConstAccessor& caccessor, const TKey& key);
+
+  /**
+   * contains returns true if key is resident, peek copies its value into caccessor like find.
+   * Neither moves the entry.
+   *
+   */
+  bool contains(const TKey& key);
+  bool peek(ConstAccessor& caccessor, const TKey& key);
+
+  /**
+   * insert inserts key/value if key is absent, into T2 if key has a ghost, otherwise into T1.
+   * Return true if key is inserted.
+   *
+   */
+  bool insert(const TKey& key, const TValue& value);
+  bool insert(const TKey& key, TValue&& value);
+  bool insert(TKey&& key, TValue&& value);
+
+  size_t erase(const TKey& key);
+
+  void clear();
+
+  size_t size() const;
+
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+  /**
+   * Current target size of T1, for observing the adaptation.
+   *
+   */
+  size_t recency_target() const;
+};
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+ARCCache<TKey, TValue, THash, TKeyEqual>::ARCCache(size_t size)
+  : mutex_(), hash_map_(), t1_(), t2_(), b1_(), b2_(), capacity_(size), p_(0) {
+  hash_map_.reserve(2 * size + 1);
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+typename ARCCache<TKey, TValue, THash, TKeyEqual>::EntryList&
+  ARCCache<TKey, TValue, THash, TKeyEqual>::list(ListId id) {
+  switch (id) {
+    case ListId::T1:
+      return t1_;
+    case ListId::T2:
+      return t2_;
+    case ListId::B1:
+      return b1_;
+    default:
+      return b2_;
+  }
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+void ARCCache<TKey, TValue, THash, TKeyEqual>::moveTo(Entry* entry, ListId id) {
+  list(entry->list_).remove(entry);
+  entry->list_ = id;
+  list(id).pushBack(entry);
+
+  if (id == ListId::B1 || id == ListId::B2) {
+    entry->value_.reset();
+  }
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+void ARCCache<TKey, TValue, THash, TKeyEqual>::dropFront(ListId id) {
+  if (Entry* entry = list(id).front(); entry != nullptr) {
+    list(id).remove(entry);
+    hash_map_.erase(*entry->key_);
+  }
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+void ARCCache<TKey, TValue, THash, TKeyEqual>::replace(bool b2Hit) {
+  if (t1_.size() > 0 && (t1_.size() > p_ || (b2Hit && t1_.size() == p_) || t2_.size() == 0)) {
+    moveTo(t1_.front(), ListId::B1);
+  } else if (t2_.size() > 0) {
+    moveTo(t2_.front(), ListId::B2);
+  }
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+bool ARCCache<TKey, TValue, THash, TKeyEqual>::find(ConstAccessor& caccessor, const TKey& key) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  auto it = hash_map_.find(key);
+  if (it == hash_map_.end() || !it->second.value_) {
+    return false;
+  }
+
+  moveTo(&it->second, ListId::T2);
+  caccessor.value_ = it->second.value_;
+
+  return true;
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+bool ARCCache<TKey, TValue, THash, TKeyEqual>::contains(const TKey& key) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  auto it = hash_map_.find(key);
+  return it != hash_map_.end() && it->second.value_.has_value();
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+bool ARCCache<TKey, TValue, THash, TKeyEqual>::peek(ConstAccessor& caccessor, const TKey& key) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  auto it = hash_map_.find(key);
+  if (it == hash_map_.end() || !it->second.value_) {
+    return false;
+  }
+
+  caccessor.value_ = it->second.value_;
+
+  return true;
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+template <typename TKeyArg, typename TValueArg>
+bool ARCCache<TKey, TValue, THash, TKeyEqual>::insertImpl(TKeyArg&& key, TValueArg&& value) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  if (capacity_ == 0) {
+    return false;
+  }
+
+  if (auto it = hash_map_.find(key); it != hash_map_.end()) {
+    Entry* entry = &it->second;
+    if (entry->value_) {
+      return false;
+    }
+
+    // ghost hit, adapt p towards the list the key was evicted from too early.
+    const bool b2Hit = entry->list_ == ListId::B2;
+    if (b2Hit) {
+      const size_t delta = std::max<size_t>(b1_.size() / b2_.size(), 1);
+      p_ = p_ > delta ? p_ - delta : 0;
+    } else {
+      const size_t delta = std::max<size_t>(b2_.size() / b1_.size(), 1);
+      p_ = std::min(capacity_, p_ + delta);
+    }
+
+    if (t1_.size() + t2_.size() >= capacity_) {
+      replace(b2Hit);
+    }
+
+    entry->value_.emplace(std::forward<TValueArg>(value));
+    moveTo(entry, ListId::T2);
+
+    return true;
+  }
+
+  if (t1_.size() + b1_.size() >= capacity_) {
+    if (t1_.size() < capacity_) {
+      dropFront(ListId::B1);
+      if (t1_.size() + t2_.size() >= capacity_) {
+        replace(false);
+      }
+    } else {
+      // B1 is empty, evict without a ghost.
+      dropFront(ListId::T1);
+    }
+  } else if (t1_.size() + t2_.size() + b1_.size() + b2_.size() >= capacity_) {
+    if (t1_.size() + t2_.size() + b1_.size() + b2_.size() >= 2 * capacity_) {
+      dropFront(ListId::B2);
+    }
+    if (t1_.size() + t2_.size() >= capacity_) {
+      replace(false);
+    }
+  }
+
+  auto it = hash_map_
+              .emplace(std::piecewise_construct, std::forward_as_tuple(std::forward<TKeyArg>(key)), std::tuple<>())
+              .first;
+
+  Entry* entry = &it->second;
+  entry->key_ = &it->first;
+  entry->value_.emplace(std::forward<TValueArg>(value));
+  entry->list_ = ListId::T1;
+  t1_.pushBack(entry);
+
+  return true;
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+bool ARCCache<TKey, TValue, THash, TKeyEqual>::insert(const TKey& key, const TValue& value) {
+  return insertImpl(key, value);
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+bool ARCCache<TKey, TValue, THash, TKeyEqual>::insert(const TKey& key, TValue&& value) {
+  return insertImpl(key, std::move(value));
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+bool ARCCache<TKey, TValue, THash, TKeyEqual>::insert(TKey&& key, TValue&& value) {
+  return insertImpl(std::move(key), std::move(value));
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+size_t ARCCache<TKey, TValue, THash, TKeyEqual>::erase(const TKey& key) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  auto it = hash_map_.find(key);
+  if (it == hash_map_.end() || !it->second.value_) {
+    return 0;
+  }
+
+  list(it->second.list_).remove(&it->second);
+  hash_map_.erase(it);
+
+  return 1;
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+void ARCCache<TKey, TValue, THash, TKeyEqual>::clear() {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  t1_.clear();
+  t2_.clear();
+  b1_.clear();
+  b2_.clear();
+  hash_map_.clear();
+  p_ = 0;
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+size_t ARCCache<TKey, TValue, THash, TKeyEqual>::size() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return t1_.size() + t2_.size();
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+size_t ARCCache<TKey, TValue, THash, TKeyEqual>::recency_target() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return p_;
+}
+
+}  // namespace LRUC
@@ -0,0 +1,106 @@
+/**
+ * @author shchang
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+
+namespace LRUC {
+
+/**
+ * CopyAccessor is the ConstAccessor of the eviction policies holding a copy of the value found by
+ * find() or peek(), no cache lock is held by the accessor once the call returns.
+ * TOwner is the cache type filling the accessor.
+ */
+template <typename TValue, typename TOwner>
+struct CopyAccessor final {
+  CopyAccessor() = default;
+  CopyAccessor(const CopyAccessor&) = delete;
+  CopyAccessor& operator=(const CopyAccessor&) = delete;
+
+  const TValue& operator*() const {
+    return *get();
+  }
+
+  const TValue* operator->() const {
+    return get();
+  }
+
+  bool empty() const {
+    return !value_.has_value();
+  }
+
+  const TValue* get() const {
+    return &*value_;
+  }
+
+  void release() {
+    value_.reset();
+  }
+
+ private:
+  friend TOwner;
+  std::optional<TValue> value_{};
+};
+
+/**
+ * IntrusiveLink is the base of the entries linked into an IntrusiveList.
+ */
+struct IntrusiveLink {
+  IntrusiveLink* prev_{nullptr};
+  IntrusiveLink* next_{nullptr};
+};
+
+/**
+ * IntrusiveList is a double-linked list of TEntry, derived from IntrusiveLink, front is the
+ * least-recently used. The list does not own its entries.
+ * Not thread-safe.
+ */
+template <typename TEntry>
+class IntrusiveList final {
+ public:
+  IntrusiveList() : sentinel_(), size_(0) {
+    sentinel_.prev_ = &sentinel_;
+    sentinel_.next_ = &sentinel_;
+  }
+
+  IntrusiveList(const IntrusiveList&) = delete;
+  IntrusiveList& operator=(const IntrusiveList&) = delete;
+
+  void pushBack(TEntry* entry) {
+    entry->prev_ = sentinel_.prev_;
+    entry->next_ = &sentinel_;
+    sentinel_.prev_->next_ = entry;
+    sentinel_.prev_ = entry;
+    size_++;
+  }
+
+  void remove(TEntry* entry) {
+    entry->prev_->next_ = entry->next_;
+    entry->next_->prev_ = entry->prev_;
+    size_--;
+  }
+
+  // nullptr if empty.
+  TEntry* front() const {
+    return size_ == 0 ? nullptr : static_cast<TEntry*>(sentinel_.next_);
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  void clear() {
+    sentinel_.prev_ = &sentinel_;
+    sentinel_.next_ = &sentinel_;
+    size_ = 0;
+  }
+
+ private:
+  IntrusiveLink sentinel_;
+  size_t size_;
+};
+
+}  // namespace LRUC
@@ -0,0 +1,106 @@
+/**
+ * @author shchang
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+/**
+ * LRUC_CACHE_LINE_SIZE is the distance keeping two fields off the same cache line (and off the
+ * adjacent line the hardware prefetches with it, if it is set to 128).
+ *
+ * std::hardware_destructive_interference_size is not used, its value varies with -mtune, thus
+ * translation units of one program could see different layouts of the same header-only class.
+ */
+#ifndef LRUC_CACHE_LINE_SIZE
+#define LRUC_CACHE_LINE_SIZE 64
+#endif
+
+namespace LRUC {
+
+inline constexpr size_t CacheLineSize = LRUC_CACHE_LINE_SIZE;
+
+/**
+ * threadProbe returns the stripe probe of the calling thread, threads are numbered in round-robin
+ * on their first call; masked by a power of 2 stripe count it picks the stripe of the thread.
+ */
+inline size_t threadProbe() noexcept {
+  static std::atomic<size_t> nextProbe{0};
+  thread_local const size_t probe = nextProbe.fetch_add(1, std::memory_order_relaxed);
+
+  return probe;
+}
+
+/**
+ * stripeMask returns the mask of stripeCount rounded up to a power of 2 stripes.
+ */
+inline size_t stripeMask(size_t stripeCount) noexcept {
+  size_t cnt = 1;
+  while (cnt < stripeCount) {
+    cnt <<= 1;
+  }
+
+  return cnt - 1;
+}
+
+/**
+ * StripedCounter is a counter split into cache-line sized cells, a thread adds to the cell of its
+ * threadProbe(), thus threads on different cores do not write the same line.
+ *
+ * load() sums the cells without locking: exact once the adds are done, while adds run it could
+ * miss the ones racing with it.
+ *
+ * Thread-safe, except reset().
+ */
+class StripedCounter final {
+ public:
+  explicit StripedCounter(size_t stripeCount = std::thread::hardware_concurrency());
+
+  StripedCounter(const StripedCounter&) = delete;
+  StripedCounter& operator=(const StripedCounter&) = delete;
+
+  void add(int64_t delta) noexcept {
+    cells_[threadProbe() & mask_].value_.fetch_add(delta, std::memory_order_relaxed);
+  }
+
+  int64_t load() const noexcept;
+
+  /**
+   * Not thread-safe.
+   */
+  void reset() noexcept;
+
+ private:
+  struct alignas(CacheLineSize) Cell {
+    std::atomic<int64_t> value_{0};
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  const size_t mask_;
+};
+
+inline StripedCounter::StripedCounter(size_t stripeCount) : cells_(), mask_(stripeMask(stripeCount)) {
+  cells_ = std::make_unique<Cell[]>(mask_ + 1);
+}
+
+inline int64_t StripedCounter::load() const noexcept {
+  int64_t sum = 0;
+  for (size_t i = 0; i <= mask_; i++) {
+    sum += cells_[i].value_.load(std::memory_order_relaxed);
+  }
+
+  return sum;
+}
+
+inline void StripedCounter::reset() noexcept {
+  for (size_t i = 0; i <= mask_; i++) {
+    cells_[i].value_.store(0, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace LRUC
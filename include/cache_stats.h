@@ -0,0 +1,391 @@
+/**
+ * @author shchang
+ */
+
+#pragma once
+
+#include "cache_line.h"
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace LRUC {
+
+/**
+ * StatsCounter enumerates the counters of a stats policy.
+ *
+ * Hit, Miss: lookups finding a live entry, or not.
+ * Eviction: entries removed to keep the capacity (not the expired or erased ones).
+ * SkippedPromotion: hits left at their recency position since the list lock was busy (and the
+ *   read buffer full).
+ * LockWait: acquisitions of the cache lock which found it held and blocked.
+ */
+enum class StatsCounter : size_t { Hit, Miss, Eviction, SkippedPromotion, LockWait, Count };
+
+/**
+ * CacheStats is a snapshot of the counters, see stats() of the caches.
+ */
+struct CacheStats final {
+  uint64_t hits{0};
+  uint64_t misses{0};
+  uint64_t evictions{0};
+  uint64_t skipped_promotions{0};
+  uint64_t lock_waits{0};
+
+  CacheStats& operator+=(const CacheStats& other) noexcept;
+
+  /**
+   * hit_ratio returns hits / (hits + misses), 0 without lookups.
+   */
+  double hit_ratio() const noexcept;
+
+  /**
+   * to_prometheus returns the counters in the Prometheus text format as metrics named
+   * <prefix>_<counter>_total; labels is a label set without braces, e.g. cache="dns".
+   */
+  std::string to_prometheus(const std::string& prefix = "lruc", const std::string& labels = "") const;
+
+  /**
+   * to_json returns the counters as a JSON object.
+   */
+  std::string to_json() const;
+};
+
+/**
+ * to_prometheus returns labelled snapshots (label set without braces, snapshot) in the Prometheus
+ * text format, each metric lists one sample per snapshot, e.g. one per ScalableLRUCache shard.
+ */
+std::string to_prometheus(const std::vector<std::pair<std::string, CacheStats>>& samples,
+                          const std::string& prefix = "lruc");
+
+/**
+ * NoTimer is the timer of the stats policies not timing operations, it compiles away.
+ */
+struct NoTimer final {};
+
+/**
+ * NoStats is the stats policy counting nothing: record() and time() compile away, the cache lock
+ * is taken without probing it first, stats() returns zeros and latency() empty histograms.
+ *
+ * A stats policy provides Enabled, record(StatsCounter, n), snapshot(), time(LatencyOp, active)
+ * returning a timer which records the operation latency on destruction, latency() and reset(),
+ * all thread-safe.
+ */
+struct NoStats final {
+  static constexpr bool Enabled = false;
+
+  void record(StatsCounter, uint64_t = 1) noexcept {}
+
+  CacheStats snapshot() const noexcept {
+    return {};
+  }
+
+  NoTimer time(LatencyOp, bool = true) noexcept {
+    return {};
+  }
+
+  LatencySnapshot latency() const {
+    return {};
+  }
+
+  void reset() noexcept {}
+};
+
+/**
+ * ThreadStats is the stats policy counting into per-thread cells: a thread adds to the cache-line
+ * sized cell of its threadProbe() without sharing the line with threads of other cells, only
+ * threads beyond the stripe count share a cell. snapshot() sums the cells.
+ *
+ * reset() could lose the counts racing with it.
+ */
+class ThreadStats final {
+ public:
+  static constexpr bool Enabled = true;
+
+  explicit ThreadStats(size_t stripeCount = std::thread::hardware_concurrency());
+
+  ThreadStats(const ThreadStats&) = delete;
+  ThreadStats& operator=(const ThreadStats&) = delete;
+
+  void record(StatsCounter counter, uint64_t n = 1) noexcept {
+    cells_[threadProbe() & mask_].counters_[static_cast<size_t>(counter)].fetch_add(n, std::memory_order_relaxed);
+  }
+
+  CacheStats snapshot() const noexcept;
+
+  NoTimer time(LatencyOp, bool = true) noexcept {
+    return {};
+  }
+
+  LatencySnapshot latency() const {
+    return {};
+  }
+
+  void reset() noexcept;
+
+ private:
+  struct alignas(CacheLineSize) Cell {
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(StatsCounter::Count)> counters_{};
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  const size_t mask_;
+};
+
+/**
+ * LatencyStats is ThreadStats plus sampled latency histograms: one in SampleEvery operations of a
+ * thread (counted across all caches) is timed with std::chrono::steady_clock and added to the
+ * LatencyHistogram buckets of its stripe with relaxed atomic adds, thus recording never locks.
+ * The stripes are picked by threadProbe() as the ThreadStats cells; latency() merges them.
+ *
+ * An operation not sampled costs a thread-local increment. A stripe holds about 10 KB of buckets,
+ * there are at most MaxStripes of them per cache.
+ */
+template <uint32_t SampleEvery = 64>
+class LatencyStats final {
+  static_assert(SampleEvery > 0 && (SampleEvery & (SampleEvery - 1)) == 0, "SampleEvery must be a power of 2");
+
+ public:
+  static constexpr bool Enabled = true;
+  static constexpr size_t MaxStripes = 8;
+
+  /**
+   * Timer records the time from its construction to its destruction, if it was sampled.
+   */
+  class Timer final {
+   public:
+    Timer(LatencyStats* stats, LatencyOp op) noexcept;
+    ~Timer();
+
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+   private:
+    LatencyStats* stats_;
+    LatencyOp op_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  explicit LatencyStats(size_t stripeCount = std::thread::hardware_concurrency());
+
+  LatencyStats(const LatencyStats&) = delete;
+  LatencyStats& operator=(const LatencyStats&) = delete;
+
+  void record(StatsCounter counter, uint64_t n = 1) noexcept {
+    counters_.record(counter, n);
+  }
+
+  CacheStats snapshot() const noexcept {
+    return counters_.snapshot();
+  }
+
+  /**
+   * time returns the Timer of op, it only times if active and the operation is sampled.
+   */
+  Timer time(LatencyOp op, bool active = true) noexcept {
+    return Timer(active && sampled() ? this : nullptr, op);
+  }
+
+  LatencySnapshot latency() const;
+
+  void reset() noexcept;
+
+ private:
+  struct alignas(CacheLineSize) Stripe {
+    std::array<std::array<std::atomic<uint64_t>, LatencyHistogram::BucketCount>,
+               static_cast<size_t>(LatencyOp::Count)>
+      buckets_{};
+  };
+
+  static bool sampled() noexcept;
+
+  void recordLatency(LatencyOp op, uint64_t ns) noexcept;
+
+  ThreadStats counters_;
+  std::unique_ptr<Stripe[]> stripes_;
+  const size_t mask_;
+};
+
+/**
+ * lockCounted locks lock, a deferred std::unique_lock or std::shared_lock; with stats enabled it
+ * tries the lock first and records a LockWait if it has to block.
+ */
+template <typename TStats, typename TLock>
+void lockCounted(TLock& lock, TStats& stats) {
+  if constexpr (TStats::Enabled) {
+    if (lock.try_lock()) {
+      return;
+    }
+
+    stats.record(StatsCounter::LockWait);
+  }
+
+  lock.lock();
+}
+
+inline CacheStats& CacheStats::operator+=(const CacheStats& other) noexcept {
+  hits += other.hits;
+  misses += other.misses;
+  evictions += other.evictions;
+  skipped_promotions += other.skipped_promotions;
+  lock_waits += other.lock_waits;
+
+  return *this;
+}
+
+inline double CacheStats::hit_ratio() const noexcept {
+  const uint64_t lookups = hits + misses;
+
+  return lookups == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(lookups);
+}
+
+inline std::string CacheStats::to_prometheus(const std::string& prefix, const std::string& labels) const {
+  return LRUC::to_prometheus({{labels, *this}}, prefix);
+}
+
+inline std::string CacheStats::to_json() const {
+  return "{\"hits\":" + std::to_string(hits) + ",\"misses\":" + std::to_string(misses) +
+         ",\"evictions\":" + std::to_string(evictions) +
+         ",\"skipped_promotions\":" + std::to_string(skipped_promotions) +
+         ",\"lock_waits\":" + std::to_string(lock_waits) + "}";
+}
+
+inline std::string to_prometheus(const std::vector<std::pair<std::string, CacheStats>>& samples,
+                                 const std::string& prefix) {
+  const std::pair<const char*, uint64_t CacheStats::*> metrics[] = {
+    {"hits", &CacheStats::hits},
+    {"misses", &CacheStats::misses},
+    {"evictions", &CacheStats::evictions},
+    {"skipped_promotions", &CacheStats::skipped_promotions},
+    {"lock_waits", &CacheStats::lock_waits},
+  };
+
+  std::string text;
+  for (const auto& [name, member] : metrics) {
+    const std::string metric = prefix + "_" + name + "_total";
+    text += "# TYPE " + metric + " counter\n";
+
+    for (const auto& [labels, stats] : samples) {
+      text += metric;
+      if (!labels.empty()) {
+        text += "{" + labels + "}";
+      }
+      text += " " + std::to_string(stats.*member) + "\n";
+    }
+  }
+
+  return text;
+}
+
+inline ThreadStats::ThreadStats(size_t stripeCount) : cells_(), mask_(stripeMask(stripeCount)) {
+  cells_ = std::make_unique<Cell[]>(mask_ + 1);
+}
+
+inline CacheStats ThreadStats::snapshot() const noexcept {
+  std::array<uint64_t, static_cast<size_t>(StatsCounter::Count)> sums{};
+  for (size_t i = 0; i <= mask_; i++) {
+    for (size_t counter = 0; counter < sums.size(); counter++) {
+      sums[counter] += cells_[i].counters_[counter].load(std::memory_order_relaxed);
+    }
+  }
+
+  CacheStats stats;
+  stats.hits = sums[static_cast<size_t>(StatsCounter::Hit)];
+  stats.misses = sums[static_cast<size_t>(StatsCounter::Miss)];
+  stats.evictions = sums[static_cast<size_t>(StatsCounter::Eviction)];
+  stats.skipped_promotions = sums[static_cast<size_t>(StatsCounter::SkippedPromotion)];
+  stats.lock_waits = sums[static_cast<size_t>(StatsCounter::LockWait)];
+
+  return stats;
+}
+
+inline void ThreadStats::reset() noexcept {
+  for (size_t i = 0; i <= mask_; i++) {
+    for (auto& counter : cells_[i].counters_) {
+      counter.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+template <uint32_t SampleEvery>
+LatencyStats<SampleEvery>::Timer::Timer(LatencyStats* stats, LatencyOp op) noexcept
+  : stats_(stats), op_(op), start_(stats != nullptr ? std::chrono::steady_clock::now()
+                                                    : std::chrono::steady_clock::time_point()) {}
+
+template <uint32_t SampleEvery>
+LatencyStats<SampleEvery>::Timer::~Timer() {
+  if (stats_ != nullptr) {
+    const auto elapsed = std::chrono::steady_clock::now() - start_;
+    stats_->recordLatency(op_,
+                          static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+  }
+}
+
+template <uint32_t SampleEvery>
+LatencyStats<SampleEvery>::LatencyStats(size_t stripeCount)
+  : counters_(stripeCount), stripes_(), mask_(stripeMask(std::min(stripeCount, MaxStripes))) {
+  stripes_ = std::make_unique<Stripe[]>(mask_ + 1);
+}
+
+template <uint32_t SampleEvery>
+bool LatencyStats<SampleEvery>::sampled() noexcept {
+  thread_local uint32_t tick = 0;
+
+  return (++tick & (SampleEvery - 1)) == 0;
+}
+
+template <uint32_t SampleEvery>
+void LatencyStats<SampleEvery>::recordLatency(LatencyOp op, uint64_t ns) noexcept {
+  auto& buckets = stripes_[threadProbe() & mask_].buckets_[static_cast<size_t>(op)];
+  buckets[LatencyHistogram::bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+}
+
+template <uint32_t SampleEvery>
+LatencySnapshot LatencyStats<SampleEvery>::latency() const {
+  LatencySnapshot snapshot;
+  for (size_t i = 0; i <= mask_; i++) {
+    for (size_t op = 0; op < snapshot.ops.size(); op++) {
+      for (size_t bucket = 0; bucket < LatencyHistogram::BucketCount; bucket++) {
+        const uint64_t count = stripes_[i].buckets_[op][bucket].load(std::memory_order_relaxed);
+        if (count > 0) {
+          snapshot.ops[op].addBucket(bucket, count);
+        }
+      }
+    }
+  }
+
+  return snapshot;
+}
+
+template <uint32_t SampleEvery>
+void LatencyStats<SampleEvery>::reset() noexcept {
+  counters_.reset();
+
+  for (size_t i = 0; i <= mask_; i++) {
+    for (auto& buckets : stripes_[i].buckets_) {
+      for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+}
+
+}  // namespace LRUC
+
+/**
+ * LRUC_DEFAULT_STATS is the default stats policy of LRUCache, ScalableLRUCache (LRUShard) and
+ * LRUClockCache, a build may define it (e.g. -DLRUC_DEFAULT_STATS=LRUC::ThreadStats) to count in
+ * all caches not naming a policy.
+ */
+#ifndef LRUC_DEFAULT_STATS
+#define LRUC_DEFAULT_STATS ::LRUC::NoStats
+#endif
@@ -4,39 +4,182 @@
 
 #pragma once
 
+#include "cache_stats.h"
+#include "removal_listener.h"
+#include "transparent_hash.h"
+#include "weigher.h"
+
+#include <algorithm>
 #include <atomic>
 #include <functional>
 #include <mutex>
 #include <optional>
 #include <shared_mutex>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace LRUC {
 
-template <typename TKey, typename TValue, typename THash = std::hash<TKey>, typename TKeyEqual = std::equal_to<TKey>>
+/**
+ * LRUClockCache approximates LRU with a clock sweep over a fixed number of slots.
+ *
+ * TWeigher weighs each entry (see UnitWeigher), the capacity is a budget on the total weight and
+ * the slot count bounds the number of entries; with UnitWeigher both are the constructor size.
+ * An insert keeps sweeping victims until enough weight is freed for the new entry, an entry
+ * heavier than the capacity is not stored.
+ *
+ * A removal listener (see set_removal_listener()) is notified of the entries removed by an
+ * operation once the exclusive lock is released.
+ *
+ * The index maps the key hash to the slot, keys are compared against the slot key with TKeyEqual,
+ * thus each key is stored once. If THash and TKeyEqual are transparent (e.g. StringHash and
+ * std::equal_to<>, see transparent_hash.h) find(), erase(), contains() and peek() take key-like
+ * types.
+ * Keys are hashed once per operation; hashed_key() returns a HashedKey which is not hashed again.
+ *
+ * TStats selects the stats policy (see cache_stats.h), stats() returns the counted hits, misses,
+ * swept evictions and waits for the cache lock. A hit only sets the survive bit, thus no
+ * promotion is ever skipped.
+ *
+ * contains() and peek() look a key up without setting its survive bit, nor counting a hit or miss.
+ */
+template <typename TKey,
+          typename TValue,
+          typename THash = std::hash<TKey>,
+          typename TKeyEqual = std::equal_to<TKey>,
+          typename TWeigher = UnitWeigher,
+          typename TStats = LRUC_DEFAULT_STATS>
 class LRUClockCache final {
 private:
   // type defs
-  using HashMap = std::unordered_map<TKey, size_t, THash, TKeyEqual>;
+  // key hash -> slot, colliding keys share a hash.
+  using HashMap = std::unordered_multimap<size_t, size_t>;
   using Mutex = std::shared_mutex;
   using CharVector = std::vector<std::atomic<char>>;
   using KeyVector = std::vector<TKey>;
   using ValueVector = std::vector<TValue>;
+  using WeightVector = std::vector<size_t>;
   using Optional = std::optional<TValue>;
+  using Notifications = std::vector<RemovalNotification<TKey, TValue>>;
 
 private:
   Mutex mutex_;
   HashMap hash_map_;
+  const THash hasher_;
+  const TKeyEqual keyEqual_;
   KeyVector keyBuf_;
   ValueVector valueBuf_;
   CharVector surviveBuf_;
+  // weight of the entry stored in a slot, 0 for an empty slot.
+  WeightVector weightBuf_;
+  const TWeigher weigher_;
   const size_t capacity_;
+  const size_t slotCount_;
+  // modified under the exclusive lock.
+  std::atomic<size_t> weight_;
   size_t cur_idx_;
   size_t evict_idx_;
+  RemovalListener<TKey, TValue> removalListener_;
+  // entries removed by the running write operation, guarded by the exclusive lock.
+  Notifications removed_;
+  TStats stats_;
+
+private:
+  size_t weigh(const TKey& key, const TValue& value) const;
+
+  /**
+   * Lock mutex_ exclusive or shared, recording a LockWait into stats_ if the lock has to block.
+   *
+   */
+  std::unique_lock<Mutex> lockExclusive();
+  std::shared_lock<Mutex> lockShared();
+
+  /**
+   * Return the index entry of key, a hashed TKey or key-like type, or hash_map_.end().
+   * Caller holds the lock.
+   *
+   */
+  template <typename TKeyLike>
+  typename HashMap::iterator locate(const HashedKey<TKeyLike>& key);
+
+  /**
+   * erase(), find(), contains() and peek() of a hashed TKey or key-like type.
+   *
+   */
+  template <typename TKeyLike>
+  size_t eraseImpl(const HashedKey<TKeyLike>& key);
+
+  template <typename TKeyLike>
+  Optional findImpl(const HashedKey<TKeyLike>& key);
+
+  template <typename TKeyLike>
+  bool containsImpl(const HashedKey<TKeyLike>& key);
+
+  template <typename TKeyLike>
+  Optional peekImpl(const HashedKey<TKeyLike>& key);
+
+  /**
+   * Advance the clock hands and return the next slot without the survive bit.
+   * Caller holds the exclusive lock.
+   *
+   */
+  size_t sweep();
+
+  /**
+   * Erase the entry stored in slot idx, if any.
+   * Caller holds the exclusive lock.
+   *
+   */
+  void evictSlot(size_t idx);
+
+  /**
+   * Move key/value into removed_ if a removal listener is set.
+   * Caller holds the exclusive lock.
+   *
+   */
+  template <typename TKeyArg, typename TValueArg>
+  void recordRemoval(TKeyArg&& key, TValueArg&& value, RemovalCause cause);
+
+  /**
+   * Take the entries removed under lock and release it, then deliver them to the removal
+   * listener.
+   *
+   */
+  void notifyRemoval(std::unique_lock<Mutex>& lock);
+
+  /**
+   * Re-weigh the value stored in slot idx after it was assigned, and evict until the weight is
+   * within the capacity.
+   * Caller holds the exclusive lock.
+   *
+   */
+  void reweighSlot(size_t idx);
+
+  /**
+   * Store key and the value constructed by makeValue into the victim slot chosen by the clock sweep,
+   * if key is absent. makeValue is only invoked if the key is inserted.
+   *
+   */
+  template <typename TKeyArg, typename TMakeValue>
+  bool insertImpl(size_t hash, TKeyArg&& key, TMakeValue&& makeValue);
+
+  /**
+   * Sweep the clock for a victim slot and store key (of hash) and value into it.
+   * Caller holds the exclusive lock and checked key is absent.
+   *
+   */
+  template <typename TKeyArg, typename TMakeValue>
+  void insertLocked(size_t hash, TKeyArg&& key, TMakeValue&& makeValue);
 
 public:
-  explicit LRUClockCache(size_t size);
+  /**
+   * size: capacity in weight units (entries with UnitWeigher).
+   * slotCount: maximum number of entries, 0 for size.
+   * weigher: weighs the entries.
+   *
+   */
+  explicit LRUClockCache(size_t size, size_t slotCount = 0, const TWeigher& weigher = TWeigher());
 
   ~LRUClockCache() noexcept { clear(); }
 
@@ -45,54 +188,339 @@ public:
 
   typename HashMap::size_type size() const { return hash_map_.size(); }
   constexpr size_t capacity() const noexcept { return capacity_; }
+  size_t weight() const noexcept { return weight_.load(std::memory_order_relaxed); }
+
+  /**
+   * stats returns a snapshot of the operation counters of TStats, all zero with NoStats.
+   *
+   */
+  CacheStats stats() const { return stats_.snapshot(); }
+
+  /**
+   * latency returns the sampled find/insert/erase/eviction latency histograms of TStats, empty
+   * unless TStats is LatencyStats.
+   *
+   */
+  LatencySnapshot latency() const { return stats_.latency(); }
 
   void clear() noexcept;
   size_t erase(const TKey& key);
   Optional find(const TKey& key);
+
+  /**
+   * contains returns true if key is found, peek returns a copy of its value like find.
+   * Neither marks the slot as recently used.
+   *
+   */
+  bool contains(const TKey& key);
+  Optional peek(const TKey& key);
+
+  /**
+   * erase, find, contains and peek taking a key-like type, enabled if THash and TKeyEqual are
+   * transparent (see IsTransparent).
+   *
+   */
+  template <typename TKeyLike, typename = EnableIfKeyLike<TKeyLike, THash, TKeyEqual>>
+  size_t erase(const TKeyLike& key);
+
+  template <typename TKeyLike, typename = EnableIfKeyLike<TKeyLike, THash, TKeyEqual>>
+  Optional find(const TKeyLike& key);
+
+  template <typename TKeyLike, typename = EnableIfKeyLike<TKeyLike, THash, TKeyEqual>>
+  bool contains(const TKeyLike& key);
+
+  template <typename TKeyLike, typename = EnableIfKeyLike<TKeyLike, THash, TKeyEqual>>
+  Optional peek(const TKeyLike& key);
+
+  /**
+   * hashed_key returns the HashedKey of key hashed by THash, the overloads taking it below do not
+   * hash key again. key must outlive the handle.
+   *
+   */
+  static HashedKey<TKey> hashed_key(const TKey& key) { return HashedKey<TKey>(key, THash()(key)); }
+
+  size_t erase(const HashedKey<TKey>& key);
+  Optional find(const HashedKey<TKey>& key);
+  bool contains(const HashedKey<TKey>& key);
+  Optional peek(const HashedKey<TKey>& key);
+  bool insert(const HashedKey<TKey>& key, const TValue& value);
+  bool insert(const HashedKey<TKey>& key, TValue&& value);
   bool insert(const TKey& key, const TValue& value);
+  bool insert(const TKey& key, TValue&& value);
+  bool insert(TKey&& key, TValue&& value);
+
+  /**
+   * emplace/try_emplace construct the value from args only if key is absent.
+   * The slot value is move-assigned from the constructed value.
+   *
+   */
+  template <typename... TArgs>
+  bool emplace(const TKey& key, TArgs&&... args);
+
+  template <typename... TArgs>
+  bool emplace(TKey&& key, TArgs&&... args);
+
+  template <typename... TArgs>
+  bool try_emplace(const TKey& key, TArgs&&... args);
+
+  template <typename... TArgs>
+  bool try_emplace(TKey&& key, TArgs&&... args);
+
+  /**
+   * insert_or_assign inserts key/value if key is absent, otherwise assigns value to the existing
+   * slot and marks it as recently used.
+   * Return true if key is inserted, false if the existing value is assigned.
+   *
+   */
+  template <typename TValueArg>
+  bool insert_or_assign(const TKey& key, TValueArg&& value);
+
+  /**
+   * update invokes updater with the stored value as TValue& under the exclusive lock and
+   * marks it as recently used.
+   * Return true if key exist (updater invoked), otherwise false.
+   *
+   */
+  template <typename TUpdater>
+  bool update(const TKey& key, TUpdater&& updater);
+
+  /**
+   * set_removal_listener sets the listener notified of entries removed by the clock sweep,
+   * erase() and insert_or_assign(), see RemovalListener.
+   * Not thread-safe, set it before the cache is shared.
+   *
+   */
+  void set_removal_listener(RemovalListener<TKey, TValue> listener) { removalListener_ = std::move(listener); }
 };
 
-template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
-LRUClockCache<TKey, TValue, THash, TKeyEqual>::LRUClockCache(size_t size)
-    : surviveBuf_(size), capacity_(size), cur_idx_(0), evict_idx_(capacity_ / 2) {
-  hash_map_.reserve(capacity_);
-  keyBuf_.resize(capacity_);
-  valueBuf_.resize(capacity_);
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::LRUClockCache(size_t size,
+                                                                               size_t slotCount,
+                                                                               const TWeigher& weigher)
+    : hasher_(),
+      keyEqual_(),
+      surviveBuf_(slotCount > 0 ? slotCount : size),
+      weightBuf_(surviveBuf_.size(), 0),
+      weigher_(weigher),
+      capacity_(size),
+      slotCount_(surviveBuf_.size()),
+      weight_(0),
+      cur_idx_(0),
+      evict_idx_(slotCount_ / 2),
+      removalListener_(),
+      removed_(),
+      stats_() {
+  hash_map_.reserve(slotCount_);
+  keyBuf_.resize(slotCount_);
+  valueBuf_.resize(slotCount_);
 }
 
-template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
-void LRUClockCache<TKey, TValue, THash, TKeyEqual>::clear() noexcept {
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+void LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::clear() noexcept {
   hash_map_.clear();
+  std::fill(weightBuf_.begin(), weightBuf_.end(), 0);
+  weight_ = 0;
 }
 
-template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
-size_t LRUClockCache<TKey, TValue, THash, TKeyEqual>::erase(const TKey& key) {
-  std::unique_lock lock(mutex_);
-  return hash_map_.erase(key);
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+size_t LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::weigh(const TKey& key,
+                                                                              const TValue& value) const {
+  if constexpr (IsUnitWeigher<TWeigher>::value) {
+    return 1;
+  } else {
+    return static_cast<size_t>(clampWeight(weigher_(key, value)));
+  }
 }
 
-template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
-typename LRUClockCache<TKey, TValue, THash, TKeyEqual>::Optional LRUClockCache<TKey, TValue, THash, TKeyEqual>::find(
-    const TKey& key) {
-  std::shared_lock lock(mutex_);
-  if (auto it = hash_map_.find(key); it != hash_map_.end()) {
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+std::unique_lock<typename LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::Mutex>
+LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::lockExclusive() {
+  std::unique_lock<Mutex> lock(mutex_, std::defer_lock);
+  lockCounted(lock, stats_);
+
+  return lock;
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+std::shared_lock<typename LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::Mutex>
+LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::lockShared() {
+  std::shared_lock<Mutex> lock(mutex_, std::defer_lock);
+  lockCounted(lock, stats_);
+
+  return lock;
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+template <typename TKeyLike>
+typename LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::HashMap::iterator
+LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::locate(const HashedKey<TKeyLike>& key) {
+  auto [it, last] = hash_map_.equal_range(key.hash());
+  for (; it != last; ++it) {
+    if (keyEqual_(keyBuf_[it->second], key.key())) {
+      return it;
+    }
+  }
+
+  return hash_map_.end();
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+size_t LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::erase(const TKey& key) {
+  return eraseImpl(hashed_key(key));
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+template <typename TKeyLike, typename>
+size_t LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::erase(const TKeyLike& key) {
+  return eraseImpl(HashedKey<TKeyLike>(key, hasher_(key)));
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+size_t LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::erase(const HashedKey<TKey>& key) {
+  return eraseImpl(key);
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+template <typename TKeyLike>
+size_t LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::eraseImpl(const HashedKey<TKeyLike>& key) {
+  [[maybe_unused]] auto timer = stats_.time(LatencyOp::Erase);
+  std::unique_lock<Mutex> lock = lockExclusive();
+
+  auto it = locate(key);
+  if (it == hash_map_.end()) {
+    return 0;
+  }
+
+  // the slot key stays stale, the clock reuses the slot later.
+  recordRemoval(keyBuf_[it->second], std::move(valueBuf_[it->second]), RemovalCause::Explicit);
+  weight_ -= weightBuf_[it->second];
+  weightBuf_[it->second] = 0;
+  hash_map_.erase(it);
+
+  notifyRemoval(lock);
+
+  return 1;
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+typename LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::Optional
+LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::find(const TKey& key) {
+  return findImpl(hashed_key(key));
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+template <typename TKeyLike, typename>
+typename LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::Optional
+LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::find(const TKeyLike& key) {
+  return findImpl(HashedKey<TKeyLike>(key, hasher_(key)));
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+typename LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::Optional
+LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::find(const HashedKey<TKey>& key) {
+  return findImpl(key);
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+bool LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::contains(const TKey& key) {
+  return containsImpl(hashed_key(key));
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+template <typename TKeyLike, typename>
+bool LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::contains(const TKeyLike& key) {
+  return containsImpl(HashedKey<TKeyLike>(key, hasher_(key)));
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+bool LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::contains(const HashedKey<TKey>& key) {
+  return containsImpl(key);
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+template <typename TKeyLike>
+bool LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::containsImpl(const HashedKey<TKeyLike>& key) {
+  std::shared_lock<Mutex> lock = lockShared();
+  return locate(key) != hash_map_.end();
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+typename LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::Optional
+LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::peek(const TKey& key) {
+  return peekImpl(hashed_key(key));
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+template <typename TKeyLike, typename>
+typename LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::Optional
+LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::peek(const TKeyLike& key) {
+  return peekImpl(HashedKey<TKeyLike>(key, hasher_(key)));
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+typename LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::Optional
+LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::peek(const HashedKey<TKey>& key) {
+  return peekImpl(key);
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+template <typename TKeyLike>
+typename LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::Optional
+LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::peekImpl(const HashedKey<TKeyLike>& key) {
+  std::shared_lock<Mutex> lock = lockShared();
+  // the survive bit is left as is, the clock sees no access.
+  if (auto it = locate(key); it != hash_map_.end()) {
+    return valueBuf_[it->second];
+  }
+
+  return {};
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+template <typename TKeyLike>
+typename LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::Optional
+LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::findImpl(const HashedKey<TKeyLike>& key) {
+  [[maybe_unused]] auto timer = stats_.time(LatencyOp::Find);
+  std::shared_lock<Mutex> lock = lockShared();
+  if (auto it = locate(key); it != hash_map_.end()) {
     surviveBuf_[it->second] = 1;
+    stats_.record(StatsCounter::Hit);
     return valueBuf_[it->second];
   } else {
+    stats_.record(StatsCounter::Miss);
     return {};
   }
 }
 
-template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
-bool LRUClockCache<TKey, TValue, THash, TKeyEqual>::insert(const TKey& key, const TValue& value) {
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+template <typename TKeyArg, typename TMakeValue>
+bool LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::insertImpl(size_t hash,
+                                                                                 TKeyArg&& key,
+                                                                                 TMakeValue&& makeValue) {
+  [[maybe_unused]] auto timer = stats_.time(LatencyOp::Insert);
+  const HashedKey<TKey> hashed(key, hash);
+
   {
-    std::shared_lock lock(mutex_);
-    if (auto it = hash_map_.find(key); it != hash_map_.end()) {
+    std::shared_lock<Mutex> lock = lockShared();
+    if (locate(hashed) != hash_map_.end()) {
       return false;
     }
   }
 
-  std::unique_lock lock(mutex_);
+  std::unique_lock<Mutex> lock = lockExclusive();
+  // another writer could have inserted key between the locks.
+  if (locate(hashed) != hash_map_.end()) {
+    return false;
+  }
+
+  insertLocked(hash, std::forward<TKeyArg>(key), std::forward<TMakeValue>(makeValue));
+  notifyRemoval(lock);
+
+  return true;
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+size_t LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::sweep() {
   // signed; use -1
   long long victim_idx = -1;
 
@@ -102,7 +530,7 @@ bool LRUClockCache<TKey, TValue, THash, TKeyEqual>::insert(const TKey& key, cons
     }
 
     cur_idx_++;
-    if (cur_idx_ >= capacity_) {
+    if (cur_idx_ >= slotCount_) {
       cur_idx_ = 0;
     }
 
@@ -111,19 +539,194 @@ bool LRUClockCache<TKey, TValue, THash, TKeyEqual>::insert(const TKey& key, cons
     }
 
     evict_idx_++;
-    if (evict_idx_ >= capacity_) {
+    if (evict_idx_ >= slotCount_) {
       evict_idx_ = 0;
     }
   }
 
-  hash_map_.erase(keyBuf_[static_cast<size_t>(victim_idx)]);
+  return static_cast<size_t>(victim_idx);
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+void LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::evictSlot(size_t idx) {
+  [[maybe_unused]] auto timer = stats_.time(LatencyOp::Eviction);
+  // the slot key is stale if it was erased (and maybe re-inserted into another slot).
+  auto [it, last] = hash_map_.equal_range(hasher_(keyBuf_[idx]));
+  for (; it != last; ++it) {
+    if (it->second == idx) {
+      hash_map_.erase(it);
+      weight_ -= weightBuf_[idx];
+      recordRemoval(keyBuf_[idx], std::move(valueBuf_[idx]), RemovalCause::Size);
+      stats_.record(StatsCounter::Eviction);
+      break;
+    }
+  }
+
+  weightBuf_[idx] = 0;
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+template <typename TKeyArg, typename TValueArg>
+void LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::recordRemoval(TKeyArg&& key,
+                                                                                    TValueArg&& value,
+                                                                                    RemovalCause cause) {
+  if (removalListener_) {
+    removed_.push_back({std::forward<TKeyArg>(key), std::forward<TValueArg>(value), cause});
+  }
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+void LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::notifyRemoval(std::unique_lock<Mutex>& lock) {
+  if (removed_.empty()) {
+    return;
+  }
+
+  Notifications removed;
+  removed.swap(removed_);
+  lock.unlock();
+
+  removalListener_(removed);
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+void LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::reweighSlot(size_t idx) {
+  if constexpr (!IsUnitWeigher<TWeigher>::value) {
+    const size_t weight = weigh(keyBuf_[idx], valueBuf_[idx]);
+    weight_ += weight - weightBuf_[idx];
+    weightBuf_[idx] = weight;
+
+    // the grown entry may be swept as well, it only has its survive bit for a second chance.
+    while (weight_ > capacity_) {
+      evictSlot(sweep());
+    }
+  }
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+template <typename TKeyArg, typename TMakeValue>
+void LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::insertLocked(size_t hash,
+                                                                                   TKeyArg&& key,
+                                                                                   TMakeValue&& makeValue) {
+  // the value is made before sweeping, thus the sweep knows how much weight to free.
+  decltype(auto) value = std::forward<TMakeValue>(makeValue)();
+  const size_t weight = weigh(key, value);
+
+  if (weight > capacity_) {
+    // heavier than the whole cache, not stored instead of flushing all other entries.
+    recordRemoval(key, std::forward<decltype(value)>(value), RemovalCause::Size);
+    stats_.record(StatsCounter::Eviction);
+    return;
+  }
+
+  const size_t victim = sweep();
+  evictSlot(victim);
+
+  // the victim slot holds the new entry, the following victims only free weight.
+  while (weight_ + weight > capacity_) {
+    evictSlot(sweep());
+  }
+
+  valueBuf_[victim] = std::forward<decltype(value)>(value);
+  keyBuf_[victim] = std::forward<TKeyArg>(key);
+  surviveBuf_[victim] = 0;
+  weightBuf_[victim] = weight;
+  weight_ += weight;
+  hash_map_.emplace(hash, victim);
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+bool LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::insert(const TKey& key, const TValue& value) {
+  return insertImpl(hasher_(key), key, [&value]() -> const TValue& { return value; });
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+bool LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::insert(const TKey& key, TValue&& value) {
+  return insertImpl(hasher_(key), key, [&value]() -> TValue&& { return std::move(value); });
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+bool LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::insert(const HashedKey<TKey>& key,
+                                                                             const TValue& value) {
+  return insertImpl(key.hash(), key.key(), [&value]() -> const TValue& { return value; });
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+bool LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::insert(const HashedKey<TKey>& key,
+                                                                             TValue&& value) {
+  return insertImpl(key.hash(), key.key(), [&value]() -> TValue&& { return std::move(value); });
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+bool LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::insert(TKey&& key, TValue&& value) {
+  const size_t hash = hasher_(key);
+  return insertImpl(hash, std::move(key), [&value]() -> TValue&& { return std::move(value); });
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+template <typename... TArgs>
+bool LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::emplace(const TKey& key, TArgs&&... args) {
+  return try_emplace(key, std::forward<TArgs>(args)...);
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+template <typename... TArgs>
+bool LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::emplace(TKey&& key, TArgs&&... args) {
+  return try_emplace(std::move(key), std::forward<TArgs>(args)...);
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+template <typename... TArgs>
+bool LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::try_emplace(const TKey& key, TArgs&&... args) {
+  return insertImpl(hasher_(key), key, [&args...] { return TValue(std::forward<TArgs>(args)...); });
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+template <typename... TArgs>
+bool LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::try_emplace(TKey&& key, TArgs&&... args) {
+  const size_t hash = hasher_(key);
+  return insertImpl(hash, std::move(key), [&args...] { return TValue(std::forward<TArgs>(args)...); });
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+template <typename TValueArg>
+bool LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::insert_or_assign(const TKey& key,
+                                                                                       TValueArg&& value) {
+  [[maybe_unused]] auto timer = stats_.time(LatencyOp::Insert);
+  const size_t hash = hasher_(key);
+  std::unique_lock<Mutex> lock = lockExclusive();
 
-  keyBuf_[static_cast<size_t>(victim_idx)] = key;
-  valueBuf_[static_cast<size_t>(victim_idx)] = value;
-  surviveBuf_[static_cast<size_t>(victim_idx)] = 0;
-  hash_map_.emplace(key, static_cast<size_t>(victim_idx));
+  if (auto it = locate(HashedKey<TKey>(key, hash)); it != hash_map_.end()) {
+    const size_t idx = it->second;
+    recordRemoval(key, std::move(valueBuf_[idx]), RemovalCause::Replaced);
+    valueBuf_[idx] = std::forward<TValueArg>(value);
+    surviveBuf_[idx] = 1;
+    reweighSlot(idx);
+    notifyRemoval(lock);
+    return false;
+  }
+
+  insertLocked(hash, key, [&value]() -> TValueArg&& { return std::forward<TValueArg>(value); });
+  notifyRemoval(lock);
 
   return true;
 }
 
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual, typename TWeigher, typename TStats>
+template <typename TUpdater>
+bool LRUClockCache<TKey, TValue, THash, TKeyEqual, TWeigher, TStats>::update(const TKey& key, TUpdater&& updater) {
+  // exclusive lock, find() copies values under the shared lock.
+  std::unique_lock<Mutex> lock = lockExclusive();
+
+  if (auto it = locate(hashed_key(key)); it != hash_map_.end()) {
+    const size_t idx = it->second;
+    std::forward<TUpdater>(updater)(valueBuf_[idx]);
+    surviveBuf_[idx] = 1;
+    reweighSlot(idx);
+    notifyRemoval(lock);
+    return true;
+  }
+
+  return false;
+}
+
 }  // namespace LRUC
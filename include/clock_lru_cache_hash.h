@@ -24,27 +24,44 @@ constexpr uint64_t twang_mix64(uint64_t key) noexcept {
 }  // namespace
 
 namespace std {
+/**
+ * hash and equal_to of IpAddress are transparent, lookups take an IPv4 address (u_int32_t,
+ * network order) or an in6_addr as well.
+ */
 template <>
 struct hash<AtsPluginUtils::IpAddress> {
-  std::size_t operator()(AtsPluginUtils::IpAddress const& ip) const noexcept {
-    size_t seed = twang_mix64(ip.base.sa_family);
+  using is_transparent = void;
 
+  std::size_t operator()(AtsPluginUtils::IpAddress const& ip) const noexcept {
     switch (ip.base.sa_family) {
       case AF_INET:
-        boost::hash_combine(seed, twang_mix64(ip.v4.sin_addr.s_addr));
-        break;
-      case AF_INET6: {
-        // The IPv6 address is 16 bytes long.
-        // Combine it in blocks of sizeof(size_t) bytes each.
-        static_assert(sizeof(struct in6_addr) % sizeof(size_t) == 0);
-
-        const size_t* p = reinterpret_cast<const size_t*>(ip.v6.sin6_addr.s6_addr);
-        constexpr auto in6_addr_size = sizeof(struct in6_addr);
-
-        for (auto amtHashed = 0UL; amtHashed < in6_addr_size; amtHashed += sizeof(*p), ++p) {
-          boost::hash_combine(seed, twang_mix64(*p));
-        }
-      }
+        return (*this)(ip.v4.sin_addr.s_addr);
+      case AF_INET6:
+        return (*this)(ip.v6.sin6_addr);
+      default:
+        return twang_mix64(ip.base.sa_family);
+    }
+  }
+
+  std::size_t operator()(u_int32_t ip) const noexcept {
+    size_t seed = twang_mix64(AF_INET);
+    boost::hash_combine(seed, twang_mix64(ip));
+
+    return seed;
+  }
+
+  std::size_t operator()(const in6_addr& ip) const noexcept {
+    size_t seed = twang_mix64(AF_INET6);
+
+    // The IPv6 address is 16 bytes long.
+    // Combine it in blocks of sizeof(size_t) bytes each.
+    static_assert(sizeof(struct in6_addr) % sizeof(size_t) == 0);
+
+    const size_t* p = reinterpret_cast<const size_t*>(ip.s6_addr);
+    constexpr auto in6_addr_size = sizeof(struct in6_addr);
+
+    for (auto amtHashed = 0UL; amtHashed < in6_addr_size; amtHashed += sizeof(*p), ++p) {
+      boost::hash_combine(seed, twang_mix64(*p));
     }
 
     return seed;
@@ -53,9 +70,19 @@ struct hash<AtsPluginUtils::IpAddress> {
 
 template <>
 struct equal_to<AtsPluginUtils::IpAddress> {
+  using is_transparent = void;
+
   bool operator()(const AtsPluginUtils::IpAddress& lhs, const AtsPluginUtils::IpAddress& rhs) const {
     return lhs == rhs;
   }
+
+  bool operator()(const AtsPluginUtils::IpAddress& lhs, u_int32_t rhs) const {
+    return lhs.base.sa_family == AF_INET && lhs.v4.sin_addr.s_addr == rhs;
+  }
+
+  bool operator()(const AtsPluginUtils::IpAddress& lhs, const in6_addr& rhs) const {
+    return lhs.base.sa_family == AF_INET6 && memcmp(&lhs.v6.sin6_addr, &rhs, sizeof(rhs)) == 0;
+  }
 };
 
 }  // namespace std
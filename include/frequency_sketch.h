@@ -0,0 +1,127 @@
+/**
+ * @author shchang
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace LRUC {
+
+/**
+ * FrequencySketch is a count-min sketch of 4-bit counters estimating how often a key hash was
+ * seen recently, used by TinyLFU admission.
+ *
+ * Each 64-bit word of the table holds 16 counters, a hash maps to one counter in each of Depth
+ * words. increment() adds to the Depth counters saturating at 15, frequency() returns their
+ * minimum. Once sampleSize increments were counted all counters are halved (aging), thus the
+ * sketch follows changes of popularity.
+ *
+ * Not thread-safe. Caller is responsible for a lock.
+ */
+class FrequencySketch final {
+ public:
+  static constexpr int MaxFrequency = 15;
+
+  /**
+   * capacity: number of entries of the cache, the table has about one word per entry and ages
+   * every 10 * capacity increments.
+   *
+   */
+  explicit FrequencySketch(size_t capacity);
+
+  void increment(uint64_t hash);
+  int frequency(uint64_t hash) const;
+  void clear();
+
+ private:
+  static constexpr int Depth = 4;
+  static constexpr std::array<uint64_t, Depth> Seeds = {
+    0xc3a5c85c97cb3127ull, 0xb492b66fbe98f273ull, 0x9ae16a3b2f90404full, 0xcbf29ce484222325ull};
+
+  /**
+   * Returns the table index in the upper bits and the counter index in the lower 4 bits, of
+   * the counter of hash in row i.
+   *
+   */
+  uint64_t locate(uint64_t hash, int i) const;
+
+  /**
+   * Halve all counters.
+   *
+   */
+  void age();
+
+  std::vector<uint64_t> table_;
+  size_t mask_;
+  size_t sampleSize_;
+  size_t additions_;
+};
+
+inline FrequencySketch::FrequencySketch(size_t capacity)
+  : table_(), mask_(0), sampleSize_(std::max<size_t>(capacity, 1) * 10), additions_(0) {
+  size_t words = 8;
+  while (words < capacity) {
+    words <<= 1;
+  }
+
+  table_.assign(words, 0);
+  mask_ = words - 1;
+}
+
+inline uint64_t FrequencySketch::locate(uint64_t hash, int i) const {
+  uint64_t h = (hash + Seeds[static_cast<size_t>(i)]) * Seeds[static_cast<size_t>(i)];
+  h ^= h >> 32;
+
+  return ((h >> 8) & mask_) << 4 | (h & 15);
+}
+
+inline void FrequencySketch::increment(uint64_t hash) {
+  bool added = false;
+
+  for (int i = 0; i < Depth; i++) {
+    const uint64_t location = locate(hash, i);
+    uint64_t& word = table_[location >> 4];
+    const uint64_t shift = (location & 15) << 2;
+
+    if (((word >> shift) & 15) < MaxFrequency) {
+      word += uint64_t{1} << shift;
+      added = true;
+    }
+  }
+
+  if (added && ++additions_ >= sampleSize_) {
+    age();
+  }
+}
+
+inline int FrequencySketch::frequency(uint64_t hash) const {
+  int frequency = MaxFrequency;
+
+  for (int i = 0; i < Depth; i++) {
+    const uint64_t location = locate(hash, i);
+    const uint64_t shift = (location & 15) << 2;
+    frequency = std::min(frequency, static_cast<int>((table_[location >> 4] >> shift) & 15));
+  }
+
+  return frequency;
+}
+
+inline void FrequencySketch::age() {
+  for (uint64_t& word : table_) {
+    word = (word >> 1) & 0x7777777777777777ull;
+  }
+
+  additions_ /= 2;
+}
+
+inline void FrequencySketch::clear() {
+  std::fill(table_.begin(), table_.end(), 0);
+  additions_ = 0;
+}
+
+}  // namespace LRUC
@@ -0,0 +1,45 @@
+/**
+ * @author shchang
+ */
+
+#pragma once
+
+#include "open_hash_map.h"
+
+#include <tbb/concurrent_hash_map.h>
+
+namespace LRUC {
+
+/**
+ * Hash-index policies select the concurrent hash map LRUCache stores its elements in.
+ * A policy provides Map<TKey, TValue, THashCompare, TAllocator>, a map with the accessor
+ * interface of tbb::concurrent_hash_map (find/insert/emplace with const_accessor/accessor,
+ * erase(accessor&), clear()).
+ */
+
+/**
+ * TbbHashIndex is tbb::concurrent_hash_map: chained buckets with per-bucket locks.
+ * Key-like lookups of a transparent hash-compare need oneTBB's concurrent_hash_map.
+ */
+struct TbbHashIndex final {
+  template <typename TKey, typename TValue, typename THashCompare, typename TAllocator>
+  using Map = tbb::concurrent_hash_map<TKey, TValue, THashCompare, TAllocator>;
+};
+
+/**
+ * OpenHashIndex is OpenHashMap: segmented open addressing with optimistic, version-checked probes.
+ */
+struct OpenHashIndex final {
+  template <typename TKey, typename TValue, typename THashCompare, typename TAllocator>
+  using Map = OpenHashMap<TKey, TValue, THashCompare, TAllocator>;
+};
+
+}  // namespace LRUC
+
+/**
+ * LRUC_DEFAULT_HASH_INDEX is the default hash-index policy of LRUCache, a build may define it
+ * (e.g. -DLRUC_DEFAULT_HASH_INDEX=LRUC::OpenHashIndex) to switch all caches not naming a policy.
+ */
+#ifndef LRUC_DEFAULT_HASH_INDEX
+#define LRUC_DEFAULT_HASH_INDEX ::LRUC::TbbHashIndex
+#endif
@@ -0,0 +1,197 @@
+/**
+ * @author shchang
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace LRUC {
+
+/**
+ * LatencyOp enumerates the timed cache operations.
+ *
+ * Find: find() and find_visit().
+ * Insert: insert(), emplace(), try_emplace() and insert_or_assign(), including the inline eviction.
+ * Erase: erase().
+ * Eviction: removing one entry for the capacity.
+ */
+enum class LatencyOp : size_t { Find, Insert, Erase, Eviction, Count };
+
+/**
+ * LatencyHistogram is a log-linear (HDR style) histogram of nanosecond latencies: values below
+ * SubBuckets have a bucket each, above each power of 2 is split into SubBuckets linear buckets,
+ * thus a bucket bounds its values within 1 / SubBuckets (12.5%). Values from 2^MaxMagnitude ns
+ * (about 9 minutes) on share the last bucket.
+ *
+ * A histogram is a plain value, histograms of several threads or caches merge with +=.
+ * percentile() and max() report the upper bound of the bucket.
+ */
+class LatencyHistogram final {
+ public:
+  static constexpr size_t SubBucketBits = 3;
+  static constexpr size_t SubBuckets = size_t{1} << SubBucketBits;
+  static constexpr size_t MaxMagnitude = 39;
+  static constexpr size_t BucketCount = SubBuckets + (MaxMagnitude - SubBucketBits + 1) * SubBuckets;
+
+  /**
+   * bucketOf returns the bucket of ns.
+   */
+  static size_t bucketOf(uint64_t ns) noexcept;
+
+  /**
+   * bucketHigh returns the largest value of bucket.
+   */
+  static uint64_t bucketHigh(size_t bucket) noexcept;
+
+  void record(uint64_t ns, uint64_t count = 1) noexcept {
+    addBucket(bucketOf(ns), count);
+  }
+
+  void addBucket(size_t bucket, uint64_t count) noexcept {
+    counts_[bucket] += count;
+    total_ += count;
+  }
+
+  LatencyHistogram& operator+=(const LatencyHistogram& other) noexcept;
+
+  uint64_t count() const noexcept {
+    return total_;
+  }
+
+  uint64_t bucketCount(size_t bucket) const noexcept {
+    return counts_[bucket];
+  }
+
+  /**
+   * percentile returns the upper bound of the bucket holding the p-th percentile (0 < p <= 100),
+   * 0 if empty.
+   */
+  uint64_t percentile(double p) const noexcept;
+
+  /**
+   * max returns the upper bound of the highest non-empty bucket, 0 if empty.
+   */
+  uint64_t max() const noexcept;
+
+  /**
+   * to_json returns the count and the p50/p90/p99/p999/max nanoseconds as a JSON object.
+   */
+  std::string to_json() const;
+
+ private:
+  std::array<uint64_t, BucketCount> counts_{};
+  uint64_t total_{0};
+};
+
+/**
+ * LatencySnapshot holds a LatencyHistogram per LatencyOp, see latency() of the caches.
+ */
+struct LatencySnapshot final {
+  std::array<LatencyHistogram, static_cast<size_t>(LatencyOp::Count)> ops{};
+
+  LatencyHistogram& operator[](LatencyOp op) noexcept {
+    return ops[static_cast<size_t>(op)];
+  }
+
+  const LatencyHistogram& operator[](LatencyOp op) const noexcept {
+    return ops[static_cast<size_t>(op)];
+  }
+
+  LatencySnapshot& operator+=(const LatencySnapshot& other) noexcept;
+
+  /**
+   * to_json returns {"find":{...},"insert":{...},"erase":{...},"eviction":{...}}, see
+   * LatencyHistogram::to_json.
+   */
+  std::string to_json() const;
+};
+
+inline size_t LatencyHistogram::bucketOf(uint64_t ns) noexcept {
+  if (ns < SubBuckets) {
+    return static_cast<size_t>(ns);
+  }
+
+  const size_t magnitude = 63 - static_cast<size_t>(__builtin_clzll(ns));
+  if (magnitude > MaxMagnitude) {
+    return BucketCount - 1;
+  }
+
+  const size_t shift = magnitude - SubBucketBits;
+  const size_t sub = static_cast<size_t>(ns >> shift) - SubBuckets;
+
+  return SubBuckets + shift * SubBuckets + sub;
+}
+
+inline uint64_t LatencyHistogram::bucketHigh(size_t bucket) noexcept {
+  if (bucket < SubBuckets) {
+    return bucket;
+  }
+
+  const size_t shift = (bucket - SubBuckets) / SubBuckets;
+  const uint64_t sub = (bucket - SubBuckets) % SubBuckets;
+
+  return ((SubBuckets + sub + 1) << shift) - 1;
+}
+
+inline LatencyHistogram& LatencyHistogram::operator+=(const LatencyHistogram& other) noexcept {
+  for (size_t i = 0; i < BucketCount; i++) {
+    counts_[i] += other.counts_[i];
+  }
+  total_ += other.total_;
+
+  return *this;
+}
+
+inline uint64_t LatencyHistogram::percentile(double p) const noexcept {
+  if (total_ == 0) {
+    return 0;
+  }
+
+  // rank of the percentile, at least the first value.
+  const auto rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(total_) + 0.5);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < BucketCount; i++) {
+    seen += counts_[i];
+    if (seen >= rank && seen > 0) {
+      return bucketHigh(i);
+    }
+  }
+
+  return max();
+}
+
+inline uint64_t LatencyHistogram::max() const noexcept {
+  for (size_t i = BucketCount; i > 0; i--) {
+    if (counts_[i - 1] > 0) {
+      return bucketHigh(i - 1);
+    }
+  }
+
+  return 0;
+}
+
+inline std::string LatencyHistogram::to_json() const {
+  return "{\"count\":" + std::to_string(total_) + ",\"p50\":" + std::to_string(percentile(50)) +
+         ",\"p90\":" + std::to_string(percentile(90)) + ",\"p99\":" + std::to_string(percentile(99)) +
+         ",\"p999\":" + std::to_string(percentile(99.9)) + ",\"max\":" + std::to_string(max()) + "}";
+}
+
+inline LatencySnapshot& LatencySnapshot::operator+=(const LatencySnapshot& other) noexcept {
+  for (size_t i = 0; i < ops.size(); i++) {
+    ops[i] += other.ops[i];
+  }
+
+  return *this;
+}
+
+inline std::string LatencySnapshot::to_json() const {
+  return "{\"find\":" + (*this)[LatencyOp::Find].to_json() + ",\"insert\":" + (*this)[LatencyOp::Insert].to_json() +
+         ",\"erase\":" + (*this)[LatencyOp::Erase].to_json() +
+         ",\"eviction\":" + (*this)[LatencyOp::Eviction].to_json() + "}";
+}
+
+}  // namespace LRUC
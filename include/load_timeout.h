@@ -0,0 +1,24 @@
+/**
+ * @author shchang
+ */
+
+#pragma once
+
+#include <stdexcept>
+
+namespace LRUC {
+
+/**
+ * LoadTimeoutError is thrown by get_or_compute() in a thread which waited longer than its timeout
+ * for the load of the same key running in another thread.
+ *
+ * It is an exception rather than std::nullopt, thus a caller tells a wait giving up apart from a
+ * negative result of the loader. The load itself goes on in the loading thread, its result is
+ * cached as usual.
+ */
+class LoadTimeoutError final : public std::runtime_error {
+ public:
+  LoadTimeoutError() : std::runtime_error("timed out waiting for the load of another thread") {}
+};
+
+}  // namespace LRUC
@@ -4,12 +4,32 @@
 
 #pragma once
 
+#include "cache_line.h"
+#include "cache_stats.h"
+#include "hash_index.h"
+#include "load_timeout.h"
+#include "promotion_throttle.h"
+#include "removal_listener.h"
+#include "slab_allocator.h"
+#include "transparent_hash.h"
+#include "weigher.h"
+
 #include <tbb/concurrent_hash_map.h>
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <iterator>
 #include <memory>
 #include <mutex>
 #include <new>
+#include <optional>
 #include <thread>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 namespace LRUC {
@@ -22,23 +42,82 @@ namespace LRUC {
  * the cache.
  *
  * find() takes LRUCache::ConstAccessor as argument which stores the found value inside the
- * cache with specified key.
+ * cache with specified key. By default a hit is recorded into a striped read buffer and replayed
+ * into the LRU list in batches, see LRUCache::Promotion. set_promotion_throttle() skips the
+ * promotion of hits on entries used recently already, see PromotionThrottle.
+ *
+ * find_visit() takes a callable which is invoked on the value stored inside the cache,
+ * no copy of the value is made.
+ *
+ * insert() takes key and value to insert into the cache, rvalue arguments are moved.
+ * insert() with a ttl inserts an entry which expires after ttl; expired entries read as absent
+ * and are evicted before any live entry, driven by a hierarchical timing wheel.
+ *
+ * emplace() and try_emplace() construct the value inside the cache from arguments.
  *
- * insert() takes key and value to insert into the cache.
+ * insert_or_assign() inserts key/value or overwrites the value of an existing key in place.
+ *
+ * update() invokes a callable to modify the value of an existing key in place.
+ *
+ * get_or_compute() returns the cached value or loads it with a callable; concurrent misses of
+ * the same key share one load, a waiter giving up throws LoadTimeoutError.
+ *
+ * multi_find() / multi_insert() process a batch of keys with one linked-list lock hold per batch.
  *
  * erase() takes key to remove the entry from the cache.
  *
+ * contains() tells if key is cached and peek() copies its value, both without updating its access
+ * frequency or taking the linked-list lock; neither counts as a hit or miss in stats().
+ *
+ * find(), erase(), contains() and peek() take key-like types (e.g. std::string_view for std::string keys)
+ * if THash is transparent, see transparent_hash.h; no TKey is constructed for the lookup.
+ *
+ * hashed_key() hashes a key once, find(), insert(), erase(), contains() and peek() taking the HashedKey
+ * do not hash it again.
+ *
  * clear() clear the cache. Not thread safe.
  *
- * size() returns the current cache size.
+ * size() returns the current cache size from a striped counter, without locking; size_exact()
+ * counts under the list lock.
  *
  * capacity() returns the defined capacity.
  *
+ * weight() returns the total weight of the cached entries.
+ *
+ * set_capacity() changes the capacity at run-time, shrinking evicts in bounded chunks.
+ *
+ * start_maintenance() moves eviction off the insert path to a maintenance thread, the cache
+ * may overshoot its capacity by a bounded amount until the thread catches up.
+ *
  * Internal double-linked list is guarded with mutex for modifying the list.
+ * The list lock and the fields its holder writes sit on other cache lines than the settings read
+ * by every operation, see CacheLineSize.
+ * List nodes are owned by a per-cache node pool and referenced from the hash-table value,
+ * thus insert() does no per-entry node allocation and find() does no reference counting.
+ *
+ * TAllocator allocates the hash-table elements and the list node storage, it is rebound to the
+ * internal types. The default (unbound) SlabAllocator is bound to a slab pool owned by the cache,
+ * thus steady-state insert and eviction do not call the global allocator.
+ *
+ * TWeigher weighs each entry (see UnitWeigher), the capacity is enforced on the total weight: an
+ * insert evicts least-recently used entries until enough weight is freed for the new entry.
+ * insert_or_assign() and update() re-weigh the modified value. An entry heavier than the
+ * capacity is evicted right away. Weights and the capacity are int64_t, a weigher result is
+ * clamped to [0, MaxWeight] (see clampWeight), not truncated.
+ *
+ * TIndex selects the concurrent hash map holding the elements (see hash_index.h): TbbHashIndex
+ * (tbb::concurrent_hash_map, the default) or OpenHashIndex (open addressing with optimistic reads).
+ *
+ * TStats selects the stats policy (see cache_stats.h): NoStats (the default) counts nothing,
+ * ThreadStats counts hits, misses, evictions, skipped promotions and list lock waits into
+ * per-thread cells, stats() returns their sum.
  *
  * Type concepts:
  * TKey type requires TBB::HashCompare concept.
- * TValue type requires CopyInsertable concept.
+ * TValue type requires CopyInsertable concept for insert(const TKey&, const TValue&),
+ *  MoveInsertable for the rvalue insert() and EmplaceConstructible for emplace()/try_emplace().
+ * TValue type requires DefaultConstructible and Assignable concepts for insert_or_assign().
+ * TAllocator type requires Allocator concept, value_type is ignored.
  *
  * Good performance depends on having good pseudo-randomness in the low-order bits of the hash code.
  * When keys are pointers, simply casting the pointer to a hash code may cause poor performance because the low-order
@@ -62,41 +141,111 @@ namespace LRUC {
  *
  */
 
-template <typename TKey, typename TValue, typename THash = tbb::tbb_hash_compare<TKey>>
+template <typename TKey,
+          typename TValue,
+          typename THash = tbb::tbb_hash_compare<TKey>,
+          typename TAllocator = SlabAllocator<std::pair<const TKey, TValue>>,
+          typename TWeigher = UnitWeigher,
+          typename TIndex = LRUC_DEFAULT_HASH_INDEX,
+          typename TStats = LRUC_DEFAULT_STATS>
 class LRUCache final {
+ public:
+  /**
+   * Promotion defines how find() updates the LRU order of the found key.
+   *
+   * TryLock: relink the node only if the list lock is free, otherwise skip the update.
+   * Buffered: record the hit into a lossy per-thread read buffer without locking, the buffer
+   *   is replayed into the list in batches under a single list lock acquisition.
+   *
+   */
+  enum class Promotion { TryLock, Buffered };
+
  private:
   // forward declaration
   struct Value;
+  struct TimerLink;
   struct ListNode;
+  struct Flight;
 
   // type defs
-  using HashMap = tbb::concurrent_hash_map<TKey, Value, THash>;
+  using AllocatorTraits = std::allocator_traits<TAllocator>;
+  using HashMapAllocator = typename AllocatorTraits::template rebind_alloc<std::pair<const TKey, Value>>;
+  using NodeAllocator = typename AllocatorTraits::template rebind_alloc<ListNode>;
+  using NodeAllocatorTraits = std::allocator_traits<NodeAllocator>;
+  // PreHashed: a HashedKey is looked up by its stored hash.
+  using HashMap = typename TIndex::template Map<TKey, Value, PreHashed<THash>, HashMapAllocator>;
   using HashMapConstAccessor = typename HashMap::const_accessor;
   using HashMapAccessor = typename HashMap::accessor;
   using HashMapValuePair = typename HashMap::value_type;
   using ListMutex = std::mutex;
+  using FlightMap = tbb::concurrent_hash_map<TKey, std::shared_ptr<Flight>, THash>;
+  using FlightMapAccessor = typename FlightMap::accessor;
+  using Notifications = std::vector<RemovalNotification<TKey, TValue>>;
 
  private:
   // static data members
   // used for judging a node exist inside the double-linked list.
   static ListNode* const NullNodePtr;
 
+  // expiresAt_ of an entry without TTL.
+  static constexpr int64_t NoExpiry = 0;
+
  private:
+  /**
+   * TimerLink links the nodes of a TimerWheel bucket, a bucket head is a bare TimerLink.
+   * timerNext_ is nullptr if the node is not scheduled.
+   *
+   */
+  struct TimerLink {
+    TimerLink* timerPrev_{nullptr};
+    TimerLink* timerNext_{nullptr};
+  };
+
   /**
    * ListNode is the element type forms the internal double-linked list,
    * which serves as the LRU cache eviction manipulator.
    *
+   * key_ points to the key stored inside the hash-table element, it is valid as long as
+   * the node is linked; the element is only erased by the thread which unlinked the node.
+   *
+   * expiresAt_ is a copy of the element expiry for the TimerWheel.
+   *
+   * appendedMs_ and appendSeq_ stamp the last append of the node for the PromotionThrottle,
+   * written under listMutex_ and read by the lookups without it, thus a recycled node is reset by
+   * recycle() instead of being constructed again.
+   *
    */
-  struct ListNode final {
+  struct ListNode final : TimerLink {
     ListNode* prev_;
     ListNode* next_;
-    TKey key_;
-
-    constexpr ListNode() : prev_(NullNodePtr), next_(nullptr) {}
-
-    // explicit to avoid unintended conversions with UDT.
-    // https://isocpp.github.io/CppCoreGuidelines/CppCoreGuidelines#Rc-explicit
-    explicit constexpr ListNode(const TKey& key) : prev_(NullNodePtr), next_(nullptr), key_(key) {}
+    const TKey* key_;
+    int64_t weight_;
+    std::atomic<uint32_t> appendedMs_;
+    int64_t expiresAt_;
+    std::atomic<uint64_t> appendSeq_;
+
+    constexpr ListNode()
+      : TimerLink(),
+        prev_(NullNodePtr),
+        next_(nullptr),
+        key_(nullptr),
+        weight_(0),
+        appendedMs_(0),
+        expiresAt_(NoExpiry),
+        appendSeq_(0) {}
+
+    // same state as constructed, the stamps are stored atomically.
+    void recycle() noexcept {
+      this->timerPrev_ = nullptr;
+      this->timerNext_ = nullptr;
+      prev_ = NullNodePtr;
+      next_ = nullptr;
+      key_ = nullptr;
+      weight_ = 0;
+      appendedMs_.store(0, std::memory_order_relaxed);
+      expiresAt_ = NoExpiry;
+      appendSeq_.store(0, std::memory_order_relaxed);
+    }
 
     // false if node is not in cache's double-linked list.
     constexpr bool inList() const {
@@ -104,24 +253,192 @@ class LRUCache final {
     }
   };
 
+  /**
+   * NodePool owns the memory of all ListNodes of the cache.
+   * Released nodes are recycled for later inserts but never returned to the system before
+   * the pool is cleared, thus a ListNode pointer read from the hash-table stays dereferenceable
+   * after the hash-table accessor is released. A recycled node may belong to another entry,
+   * caller has to check the node under listMutex_ before modifying the list.
+   *
+   * Chunks of nodes are allocated with NodeAllocator.
+   *
+   * Not thread-safe. Caller is responsible for a lock.
+   *
+   */
+  class NodePool final {
+   public:
+    explicit NodePool(const NodeAllocator& allocator) : allocator_(allocator) {}
+
+    ~NodePool() noexcept {
+      clear();
+    }
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    ListNode* allocate();
+    void release(ListNode* node);
+    void clear() noexcept;
+
+   private:
+    static constexpr size_t ChunkSize = 1024;
+
+    NodeAllocator allocator_;
+    std::vector<ListNode*> chunks_{};
+    ListNode* freeList_{nullptr};
+    size_t chunkUsed_{ChunkSize};
+  };
+
+  /**
+   * TimerWheel indexes the nodes of entries with a TTL by expiry, as a hierarchical timing wheel:
+   * Levels of Buckets buckets with tick spans of 1ms, 64ms, 4.1s and 4.4min, entries beyond the
+   * top level span wait in the overflow bucket.
+   *
+   * A node is scheduled into the bucket of the lowest level covering its remaining time.
+   * advance() visits only the buckets the clock passed on each level; due nodes are handed to the
+   * caller, the others are rescheduled to a lower level. A node thus moves at most once per level,
+   * schedule and expiry are O(1) amortized.
+   *
+   * Times are steady clock milliseconds, see nowTick().
+   * Not thread-safe. Caller is responsible for a lock.
+   *
+   */
+  class TimerWheel final {
+   public:
+    TimerWheel();
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // node->expiresAt_ must be set.
+    void schedule(ListNode* node);
+
+    // no-op if node is not scheduled.
+    void unschedule(ListNode* node);
+
+    bool empty() const {
+      return count_ == 0;
+    }
+
+    /**
+     * Move the wheel to now and invoke expire with each node due by now, the node is
+     * unscheduled before.
+     */
+    template <typename TExpire>
+    void advance(int64_t now, TExpire&& expire);
+
+    void clear() noexcept;
+
+   private:
+    static constexpr size_t Levels = 4;
+    static constexpr size_t BucketBits = 6;
+    static constexpr size_t Buckets = size_t{1} << BucketBits;
+
+    TimerLink& bucketFor(int64_t expiresAt);
+
+    template <typename TExpire>
+    void expireBucket(TimerLink& bucket, TExpire& expire);
+
+    std::array<std::array<TimerLink, Buckets>, Levels> wheel_;
+    TimerLink overflow_;
+    int64_t currentTick_;
+    size_t count_;
+  };
+
+  /**
+   * ReadBuffer records the nodes found by find() without taking listMutex_.
+   *
+   * The buffer is striped by thread, each stripe is a bounded ring. When a stripe is full
+   * record() drops the access (lossy) and reports it, thus the caller could drain the buffer.
+   * drain() must be called with listMutex_ held, it replays all stripes in recorded order.
+   *
+   * Recorded nodes may be released by the time they are drained, the visitor has to
+   * check the node state as find() does.
+   *
+   */
+  class ReadBuffer final {
+   public:
+    explicit ReadBuffer(size_t stripeCount);
+
+    // returns false if the stripe of the calling thread is full.
+    bool record(ListNode* node);
+
+    template <typename TVisitor>
+    void drain(TVisitor&& visitor);
+
+    // Not thread-safe.
+    void clear() noexcept;
+
+   private:
+    static constexpr size_t StripeSize = 16;
+
+    // aligned to a cache line to avoid false sharing between stripes.
+    struct alignas(CacheLineSize) Stripe final {
+      std::atomic<size_t> readCnt_{0};
+      std::atomic<size_t> writeCnt_{0};
+      std::array<std::atomic<ListNode*>, StripeSize> slots_{};
+    };
+
+    std::unique_ptr<Stripe[]> stripes_;
+    const size_t mask_;
+  };
+
+  /**
+   * Flight is an in-progress get_or_compute() load of a key, shared by the loading thread
+   * and the threads waiting for its result.
+   *
+   */
+  struct Flight final {
+    std::mutex mutex_{};
+    std::condition_variable doneCv_{};
+    bool done_{false};
+    std::optional<TValue> value_{};
+    std::exception_ptr error_{};
+  };
+
   /**
    * Value is the value stored in the hash-table.
    * listNode_ as back-reference to node to the double-linked list,
-   * which contains hash-table key.
+   * which points back to the hash-table key.
+   * expiresAt_ is the expiry tick (see nowTick()) or NoExpiry, guarded by the element lock.
    *
    */
   struct Value final {
-    std::shared_ptr<ListNode> listNode_;
+    ListNode* listNode_;
+    int64_t expiresAt_;
     TValue value_;
 
-    Value() = default;
-    Value(const TValue& value, std::shared_ptr<ListNode> node) : listNode_(node), value_(value) {}
+    Value() : listNode_(nullptr), expiresAt_(NoExpiry), value_() {}
+
+    template <typename... TArgs>
+    explicit Value(std::in_place_t, TArgs&&... args)
+      : listNode_(nullptr), expiresAt_(NoExpiry), value_(std::forward<TArgs>(args)...) {}
   };
 
  private:
   // data members
-  // consider padding and false sharing
-  ListMutex listMutex_;
+  // grouped by access pattern, each group starts a cache line (see CacheLineSize): the hash
+  // index, the list lock with the fields its holder writes, the settings every operation reads
+  // outside the lock, and the maintenance signal written by inserts.
+
+  /**
+   * Slab pool owned by the cache if TAllocator is an unbound SlabAllocator, otherwise nullptr.
+   * Declared before the containers allocating from it.
+   *
+   */
+  std::unique_ptr<SlabPool> slabPool_;
+
+  /**
+   * hash index, see TIndex.
+   *
+   */
+  alignas(CacheLineSize) HashMap hash_map_;
+
+  /**
+   * get_or_compute() loads in progress.
+   *
+   */
+  FlightMap flights_;
 
   /**
    * head_ is the least-recently used node.
@@ -129,339 +446,2323 @@ class LRUCache final {
    * listMutex should be held during list modification.
    *
    */
+  alignas(CacheLineSize) ListMutex listMutex_;
   ListNode head_;
   ListNode tail_;
 
   /**
-   * oneTBB concurrent_hash_map
+   * count of the linked nodes, modified under listMutex_, see size_exact(); read without it by
+   * the promotion throttle.
    *
    */
-  HashMap hash_map_;
+  std::atomic<int> current_size_;
 
   /**
-   * cache size.
+   * count of the appends to the list, the stamp of the last appended node. Modified under
+   * listMutex_, read without it by the promotion throttle.
    *
    */
-  std::atomic<int> current_size_;
+  std::atomic<uint64_t> appendSeq_;
 
   /**
-   * cache capacity
+   * total weight of the linked entries, equals current_size_ with UnitWeigher.
+   * Only modified under listMutex_.
    *
    */
-  const int capacity_;
+  std::atomic<int64_t> weight_;
 
- private:
   /**
-   * Append a node to the double-linked list as the most-recently used.
-   * Not thread-safe. Caller is responsible for a lock.
+   * ListNode storage, guarded by listMutex_.
    *
    */
-  void append(ListNode* node);
+  NodePool nodePool_;
 
   /**
-   * Unlink a node from the list.
-   * Not thread-safe. Caller is responsible for a lock.
+   * expiry index of the linked nodes with a TTL, guarded by listMutex_.
    *
    */
-  void unlink(ListNode* node);
+  TimerWheel timerWheel_;
 
   /**
-   * Remove the least-recently used value from the LRUCache.
-   * Thread-safe.
+   * cache capacity in weight units, changed by set_capacity().
    *
    */
-  void popFront();
+  alignas(CacheLineSize) std::atomic<int64_t> capacity_;
 
- public:
   /**
-   * ConstAccessor is a helper type wraped over tbb::concurrent_hash_map::const_accessor with
-   * operator overloaded to retrieve value stored in the hash-table based on key.
+   * Background eviction, see start_maintenance().
+   * overshoot_ is negative while eviction is inline.
    *
    */
-  struct ConstAccessor final {
-    constexpr ConstAccessor() = default;
-    constexpr ConstAccessor(const ConstAccessor&) = delete;
-
-    constexpr const TValue& operator*() const {
-      return *get();
-    }
+  std::atomic<int64_t> overshoot_;
+  std::atomic<int64_t> slack_;
 
-    constexpr const TValue* operator->() const {
-      return get();
-    }
+  /**
+   * expiring_ is set once an entry with a TTL is inserted, until clear().
+   *
+   */
+  std::atomic<bool> expiring_;
 
-    constexpr bool empty() const {
-      return constAccessor_.empty();
-    }
+  /**
+   * find() LRU update strategy.
+   *
+   */
+  const Promotion promotion_;
 
-    constexpr const TValue* get() const {
-      return &value_;
-    }
+  /**
+   * promotion throttle bounds, see set_promotion_throttle(); zero is disabled.
+   *
+   */
+  double throttleFraction_;
+  uint32_t throttleWindowMs_;
 
-    constexpr void release() {
-      constAccessor_.release();
-    }
+  const TWeigher weigher_;
 
-   private:
-    /**
-     * copy TValue from concurrent_hash_map thus caller could release read lock early.
-     *
-     */
-    void setValue() {
-      value_ = constAccessor_->second.value_;
-    }
+  /**
+   * notified of removed entries, see set_removal_listener().
+   *
+   */
+  RemovalListener<TKey, TValue> removalListener_;
 
-   private:
-    friend class LRUCache;  // for LRUCache member function to access tbb::concurrent_hash_map::const_accessor
-    HashMapConstAccessor constAccessor_;
-    TValue value_;
-  };
+  /**
+   * find() hits pending to be replayed into the double-linked list, the stripes are cache-line
+   * aligned allocations of their own.
+   *
+   */
+  ReadBuffer readBuffer_;
 
   /**
-   * size: initial size for the cache.
-   * The size should be tunable at run-time TODO(shchang)
+   * count of the cached entries, added to by the inserting threads outside listMutex_ once the
+   * element has a node, and subtracted from by the thread unlinking (or dropping) the node, see
+   * size().
    *
-   * bucketCount: used for initial setup the tbb:concurrent_hash_map, the bucket size
-   * will grow depends on internal oneTBB algorithm.
    */
-  explicit LRUCache(int size, size_t bucketCount = std::thread::hardware_concurrency() * 8);
+  StripedCounter size_;
 
-  ~LRUCache() noexcept {
-    clear();
-  }
+  /**
+   * operation counters, see stats(); the ThreadStats cells are allocations of their own.
+   *
+   */
+  TStats stats_;
 
-  LRUCache(const LRUCache& other) = delete;
-  LRUCache& operator=(const LRUCache&) = delete;
+  alignas(CacheLineSize) std::atomic<bool> maintenancePending_;
+  bool maintenanceStop_;
+  std::mutex maintenanceMutex_;
+  std::condition_variable maintenanceCv_;
 
   /**
-   * erase removes key from LRUCache along with its value.
-   * returns number of elements removed (0 or 1).
+   * Held by the maintenance thread for an eviction cycle, serializes it with clear().
    *
    */
-  size_t erase(const TKey& key);
+  std::mutex maintenanceCycleMutex_;
+  std::thread maintenanceThread_;
 
+ private:
   /**
-   * find finds data inside hash-table through provided key.
-   * ConstAccessor stores a copy of the found result.
-   * Return true if key exist, otherwise false.
-   *
-   * find updates key access frequency.
+   * Append a node to the double-linked list as the most-recently used.
+   * Not thread-safe. Caller is responsible for a lock.
    *
    */
-  bool find(ConstAccessor& ac, const TKey& key);
+  void append(ListNode* node);
 
   /**
-   * insert key/value into cache. Both key and value is copied into the cache.
-   * insert updates key access frequency.
-   *
-   * If key already exists in the cache, the value will not be updated and return
-   * false. Otherwise return true.
+   * Unlink a node from the list.
+   * Not thread-safe. Caller is responsible for a lock.
    *
    */
-  bool insert(const TKey& key, const TValue& value);
+  void unlink(ListNode* node);
 
   /**
-   * clear erases all elements from the container.
-   * After this call, size() returns zero.
-   * Not thread-safe.
+   * Returns true if node is linked and still belongs to the hash-table element with key.
+   * Not thread-safe. Caller is responsible for a lock.
    *
    */
-  void clear() noexcept;
+  bool owns(const ListNode* node, const TKey& key) const {
+    return node->inList() && node->key_ == &key;
+  }
 
   /**
-   * size returns the current cache size.
+   * Move a found node to the most-recently used position if it is still in the list.
+   * Not thread-safe. Caller is responsible for a lock.
    *
    */
-  int size() const {
-    return current_size_.load();
-  }
+  void promote(ListNode* node);
 
   /**
-   * capacity returns the cache capacity.
+   * Returns true if a hit on node is not promoted, see PromotionThrottle.
+   * Thread-safe.
    *
    */
-  constexpr int capacity() const {
-    return capacity_;
-  }
-};
+  bool throttled(const ListNode* node) const;
 
-template <class TKey, class TValue, class THash>
-typename LRUCache<TKey, TValue, THash>::ListNode* const LRUCache<TKey, TValue, THash>::NullNodePtr =
-  reinterpret_cast<ListNode*>(-1);
+  /**
+   * Replay the read buffer into the double-linked list.
+   * Not thread-safe. Caller is responsible for a lock.
+   *
+   */
+  void drainReadBuffer();
 
-// ---- private member functions ----
-template <class TKey, class TValue, class THash>
-void LRUCache<TKey, TValue, THash>::unlink(ListNode* node) {
-  ListNode* prev = node->prev_;
-  ListNode* next = node->next_;
-  prev->next_ = next;
-  next->prev_ = prev;
+  /**
+   * Lock listMutex_, recording a LockWait into stats_ if the lock has to block.
+   *
+   */
+  std::unique_lock<ListMutex> lockList();
 
-  // assign to NullNodePtr as indicator that this node is no longer in the double-linked list.
-  node->prev_ = NullNodePtr;
-}
+  /**
+   * Update the LRU order for a node found by a lookup, based on promotion_.
+   * Thread-safe. Caller must not hold the hash-table accessor.
+   *
+   */
+  void recordAccess(ListNode* node);
 
-template <class TKey, class TValue, class THash>
-void LRUCache<TKey, TValue, THash>::append(ListNode* node) {
-  ListNode* prevLatestNode = tail_.prev_;
+  /**
+   * Update the LRU order for the nodes found by a batch lookup in one lock hold.
+   * Thread-safe. Caller must not hold the hash-table accessor.
+   *
+   */
+  void recordAccesses(const std::vector<ListNode*>& nodes);
 
-  node->next_ = &tail_;
-  node->prev_ = prevLatestNode;
+  /**
+   * find_visit() without counting the lookup into stats_, get_or_compute() rechecks a missed key
+   * with it.
+   * Thread-safe.
+   *
+   */
+  template <typename TVisitor>
+  bool visitImpl(const TKey& key, TVisitor&& visitor);
 
-  tail_.prev_ = node;
-  prevLatestNode->next_ = node;
-}
+  /**
+   * Remove the least-recently used value from the LRUCache if the weight is above limit.
+   * Returns false if nothing was evicted.
+   * Thread-safe.
+   *
+   */
+  bool popFront(int64_t limit, Notifications& removed);
 
-template <class TKey, class TValue, class THash>
-void LRUCache<TKey, TValue, THash>::popFront() {
-  ListNode* candidate{nullptr};
+  /**
+   * Unlink node from the list and the timer wheel, release it and return its key.
+   * The caller owns the erasure of the hash-table element, see eraseVictims().
+   * Not thread-safe. Caller is responsible for a lock.
+   *
+   */
+  const TKey* detach(ListNode* node);
 
-  {
-    std::unique_lock<ListMutex> lock(listMutex_);
-    candidate = head_.next_;
+  /**
+   * Detach the nodes expired by now, their keys are appended to victims.
+   * Not thread-safe. Caller is responsible for a lock.
+   *
+   */
+  void expireEntries(std::vector<const TKey*>& victims);
 
-    if (candidate == &tail_) {
-      return;
-    }
+  /**
+   * Returns the current steady clock tick in milliseconds.
+   *
+   */
+  static int64_t nowTick();
 
-    unlink(candidate);
+  /**
+   * Returns true if the element value has a TTL which passed.
+   *
+   */
+  static bool expired(const Value& value) {
+    return value.expiresAt_ != NoExpiry && value.expiresAt_ <= nowTick();
   }
 
+  /**
+   * Unlink the node of the element held by accessor and erase the element, unless an eviction
+   * unlinked the node before and owns the erasure.
+   * Thread-safe. Caller must not hold listMutex_.
+   *
+   */
+  void eraseElement(HashMapAccessor& accessor, RemovalCause cause, Notifications& removed);
+
+  /**
+   * Erase the element of key if it is expired, thus it could be inserted again.
+   * Thread-safe. Caller must not hold the hash-table accessor.
+   *
+   */
+  template <typename TKeyLike>
+  void purgeExpired(const TKeyLike& key, Notifications& removed);
+
+  /**
+   * Unlink the least-recently used node and return its key, nullptr if the list is empty.
+   * The caller owns the erasure of the hash-table element, see eraseVictims().
+   * Not thread-safe. Caller is responsible for a lock.
+   *
+   */
+  const TKey* unlinkFront();
+
+  /**
+   * Returns the weight of key/value, the weigher result clamped to [0, MaxWeight].
+   *
+   */
+  int64_t weigh(const TKey& key, const TValue& value) const;
+
+  /**
+   * Re-weigh the value of the element held by accessor after it was modified in place.
+   * Thread-safe.
+   *
+   */
+  void reweigh(HashMapAccessor& accessor);
+
+  /**
+   * Evict until the weight is within the capacity, or within the high watermark and wake up
+   * the maintenance thread if background eviction is enabled.
+   * Thread-safe. Caller must not hold the hash-table accessor.
+   *
+   */
+  void enforceCapacity(Notifications& removed);
+
+  /**
+   * Construct key/value in the hash-table if key is absent (or expired) and admit it into the
+   * LRU list. expiresAt is the expiry tick or NoExpiry, key is a TKey or a HashedKey.
+   * Returns false if key already exists.
+   * Thread-safe.
+   *
+   */
+  template <typename TKeyArg, typename... TArgs>
+  bool emplaceImpl(int64_t expiresAt, TKeyArg&& key, TArgs&&... args);
+
+  /**
+   * Link a newly inserted node as the most-recently used and evict until enough weight is freed
+   * for it.
+   * Thread-safe.
+   *
+   */
+  void admit(ListNode* node, Notifications& removed);
+
+  /**
+   * Allocate the list node for the newly inserted hash-table element held by accessor.
+   * The node is linked later by admit().
+   * Thread-safe.
+   *
+   */
+  ListNode* attachNode(HashMapAccessor& accessor);
+
+  /**
+   * Link the nodes attached by multi_insert(), return the unused pre-allocated nodes to the pool
+   * and evict to keep the capacity, in one linked-list lock hold.
+   * Thread-safe. Caller must not hold the hash-table accessor.
+   *
+   */
+  void admitBatch(const std::vector<ListNode*>& attached,
+                  const std::vector<ListNode*>& spare,
+                  Notifications& removed);
+
+  /**
+   * Unlink the expired nodes, then up to maxCount least-recently used nodes while the weight is
+   * above limit. The keys of the unlinked nodes are appended to expiredKeys and victims for
+   * eraseVictims().
+   * Returns the number of unlinked nodes.
+   * Not thread-safe. Caller is responsible for a lock.
+   *
+   */
+  size_t evictOverflow(int64_t limit,
+                       size_t maxCount,
+                       std::vector<const TKey*>& expiredKeys,
+                       std::vector<const TKey*>& victims);
+
+  /**
+   * Erase the hash-table element of an unlinked node.
+   * Thread-safe. Caller must not hold listMutex_.
+   *
+   */
+  void eraseVictim(const TKey& key, RemovalCause cause, Notifications& removed);
+
+  /**
+   * Move key/value into removed if a removal listener is set.
+   *
+   */
+  void recordRemoval(const TKey& key, TValue& value, RemovalCause cause, Notifications& removed) const;
+
+  /**
+   * Deliver removed to the removal listener.
+   * Thread-safe. Caller must not hold any lock of the cache.
+   *
+   */
+  void notifyRemoval(Notifications& removed);
+
+  /**
+   * Evict the least-recently used entries until the weight is at most capacity - slack, in chunks of
+   * ShrinkChunkSize with the linked-list lock released between chunks.
+   * Thread-safe.
+   *
+   */
+  void trim(int64_t slack);
+
+  /**
+   * Wake up the maintenance thread, once per eviction cycle.
+   * Thread-safe.
+   *
+   */
+  void requestMaintenance();
+
+  /**
+   * Maintenance thread loop.
+   *
+   */
+  void maintain();
+
+  /**
+   * Stop and join the maintenance thread, no eviction runs afterwards.
+   * Not thread-safe.
+   *
+   */
+  void join_maintenance() noexcept;
+
+  /**
+   * Drop all entries and nodes, without serializing with the maintenance thread.
+   * Not thread-safe.
+   *
+   */
+  void reset() noexcept;
+
+  /**
+   * Erase the hash-table elements of the nodes unlinked by evictOverflow().
+   * Thread-safe. Caller must not hold listMutex_.
+   *
+   */
+  void eraseVictims(const std::vector<const TKey*>& victims, RemovalCause cause, Notifications& removed);
+
+  /**
+   * Publish the result of a get_or_compute() load to the waiting threads.
+   * Thread-safe.
+   *
+   */
+  void completeFlight(const TKey& key, Flight& flight, const std::optional<TValue>& value, std::exception_ptr error);
+
+  /**
+   * Returns allocator, bound to slabPool_ if it is an unbound SlabAllocator.
+   *
+   */
+  TAllocator bindAllocator(const TAllocator& allocator) const;
+
+ public:
+  /**
+   * ConstAccessor is a helper type wraped over the hash-index const_accessor with
+   * operator overloaded to retrieve value stored in the hash-table based on key.
+   *
+   */
+  struct ConstAccessor final {
+    constexpr ConstAccessor() = default;
+    constexpr ConstAccessor(const ConstAccessor&) = delete;
+
+    constexpr const TValue& operator*() const {
+      return *get();
+    }
+
+    constexpr const TValue* operator->() const {
+      return get();
+    }
+
+    constexpr bool empty() const {
+      return constAccessor_.empty();
+    }
+
+    constexpr const TValue* get() const {
+      return &value_;
+    }
+
+    constexpr void release() {
+      constAccessor_.release();
+    }
+
+   private:
+    /**
+     * copy TValue from concurrent_hash_map thus caller could release read lock early.
+     *
+     */
+    void setValue() {
+      value_ = constAccessor_->second.value_;
+    }
+
+   private:
+    friend class LRUCache;  // for LRUCache member function to access tbb::concurrent_hash_map::const_accessor
+    HashMapConstAccessor constAccessor_;
+    TValue value_;
+  };
+
+  /**
+   * size: initial capacity for the cache in weight units (entries with UnitWeigher), could be
+   * changed at run-time with set_capacity(). Clamped to MaxWeight.
+   *
+   * bucketCount: used for initial setup the tbb:concurrent_hash_map, the bucket size
+   * will grow depends on internal oneTBB algorithm.
+   *
+   * promotion: find() LRU update strategy.
+   *
+   * allocator: allocates the hash-table elements and list nodes, copies of it are rebound
+   * to the internal types.
+   *
+   * weigher: weighs the entries, size is then a budget in the weigher's units.
+   */
+  explicit LRUCache(int64_t size,
+                    size_t bucketCount = std::thread::hardware_concurrency() * 8,
+                    Promotion promotion = Promotion::Buffered,
+                    const TAllocator& allocator = TAllocator(),
+                    const TWeigher& weigher = TWeigher());
+
+  /**
+   * Entries still cached are dropped without notifying the removal listener.
+   *
+   */
+  ~LRUCache() noexcept {
+    join_maintenance();
+    reset();
+  }
+
+  LRUCache(const LRUCache& other) = delete;
+  LRUCache& operator=(const LRUCache&) = delete;
+
+  /**
+   * erase removes key from LRUCache along with its value.
+   * returns number of elements removed (0 or 1).
+   *
+   */
+  size_t erase(const TKey& key);
+
+  /**
+   * erase taking a key-like type, enabled if THash is transparent (see IsTransparent).
+   *
+   */
+  template <typename TKeyLike, typename = EnableIfKeyLike<TKeyLike, THash>>
+  size_t erase(const TKeyLike& key);
+
+  /**
+   * find finds data inside hash-table through provided key.
+   * ConstAccessor stores a copy of the found result.
+   * Return true if key exist, otherwise false.
+   *
+   * find updates key access frequency.
+   *
+   */
+  bool find(ConstAccessor& ac, const TKey& key);
+
+  /**
+   * find taking a key-like type, enabled if THash is transparent (see IsTransparent).
+   *
+   */
+  template <typename TKeyLike, typename = EnableIfKeyLike<TKeyLike, THash>>
+  bool find(ConstAccessor& ac, const TKeyLike& key);
+
+  /**
+   * contains returns true if key is found (and is not expired), peek copies its value into ac like
+   * find. Both take the hash-table read lock only, neither updates key access frequency.
+   *
+   */
+  bool contains(const TKey& key);
+  bool peek(ConstAccessor& ac, const TKey& key);
+
+  /**
+   * contains and peek taking a key-like type, enabled if THash is transparent (see IsTransparent).
+   *
+   */
+  template <typename TKeyLike, typename = EnableIfKeyLike<TKeyLike, THash>>
+  bool contains(const TKeyLike& key);
+
+  template <typename TKeyLike, typename = EnableIfKeyLike<TKeyLike, THash>>
+  bool peek(ConstAccessor& ac, const TKeyLike& key);
+
+  /**
+   * hashed_key returns the HashedKey of key hashed by THash, the overloads taking it below do not
+   * hash key again. key must outlive the handle.
+   *
+   */
+  static HashedKey<TKey> hashed_key(const TKey& key);
+
+  /**
+   * find, erase, contains, peek and insert taking a HashedKey, same semantics as taking the key.
+   * With TbbHashIndex insert hashes the key once more: tbb::concurrent_hash_map hashes the stored
+   * key on emplace.
+   *
+   */
+  bool find(ConstAccessor& ac, const HashedKey<TKey>& key);
+  size_t erase(const HashedKey<TKey>& key);
+  bool contains(const HashedKey<TKey>& key);
+  bool peek(ConstAccessor& ac, const HashedKey<TKey>& key);
+  bool insert(const HashedKey<TKey>& key, const TValue& value);
+  bool insert(const HashedKey<TKey>& key, TValue&& value);
+
+  /**
+   * find_visit finds data inside hash-table through provided key and invokes visitor
+   * with the stored value as const TValue&, without copying it.
+   * Return true if key exist (visitor invoked), otherwise false.
+   *
+   * visitor runs while the hash-table read lock of the key is held, keep it short and
+   * do not call back into the cache from it.
+   *
+   * find_visit updates key access frequency.
+   *
+   */
+  template <typename TVisitor>
+  bool find_visit(const TKey& key, TVisitor&& visitor);
+
+  /**
+   * insert key/value into cache. Both key and value is copied into the cache.
+   * insert updates key access frequency.
+   *
+   * If key already exists in the cache, the value will not be updated and return
+   * false. Otherwise return true.
+   *
+   */
+  bool insert(const TKey& key, const TValue& value);
+
+  /**
+   * insert key/value into cache, value is moved into the cache.
+   * Same semantics as insert(const TKey&, const TValue&).
+   *
+   */
+  bool insert(const TKey& key, TValue&& value);
+
+  /**
+   * insert key/value into cache, both key and value are moved into the cache.
+   * Same semantics as insert(const TKey&, const TValue&).
+   *
+   */
+  bool insert(TKey&& key, TValue&& value);
+
+  /**
+   * insert key/value with a time to live, same semantics as insert(const TKey&, const TValue&).
+   *
+   * Once ttl passed the entry is a miss for lookups and is erased by the expiry index, an expired
+   * entry is evicted before any live least-recently used entry. An expired key could be inserted
+   * again. Expiry has millisecond resolution.
+   *
+   */
+  bool insert(const TKey& key, const TValue& value, std::chrono::milliseconds ttl);
+  bool insert(TKey&& key, TValue&& value, std::chrono::milliseconds ttl);
+
+  /**
+   * emplace constructs the value in place from args and inserts it with key.
+   *
+   * If key already exists in the cache, the value will not be updated and return
+   * false. Otherwise return true. Like std::unordered_map::emplace, the value might be
+   * constructed even if key exists.
+   *
+   */
+  template <typename... TArgs>
+  bool emplace(const TKey& key, TArgs&&... args);
+
+  template <typename... TArgs>
+  bool emplace(TKey&& key, TArgs&&... args);
+
+  /**
+   * try_emplace constructs the value in place from args only if key is absent.
+   *
+   * If key already exists in the cache return false and args are left untouched.
+   * In the rare case of another thread inserting the same key concurrently, the value
+   * is constructed and dropped.
+   *
+   */
+  template <typename... TArgs>
+  bool try_emplace(const TKey& key, TArgs&&... args);
+
+  template <typename... TArgs>
+  bool try_emplace(TKey&& key, TArgs&&... args);
+
+  /**
+   * insert_or_assign inserts key/value if key is absent, otherwise assigns value to the
+   * existing entry in place under the hash-table write lock.
+   * insert_or_assign updates key access frequency.
+   * An expired entry is replaced as an absent one, a live entry keeps its expiry.
+   *
+   * Return true if key is inserted, false if the existing value is assigned.
+   *
+   */
+  template <typename TValueArg>
+  bool insert_or_assign(const TKey& key, TValueArg&& value);
+
+  /**
+   * update invokes updater with the stored value as TValue& under the hash-table write lock,
+   * thus the value is modified in place.
+   * update updates key access frequency.
+   *
+   * Return true if key exist (updater invoked), otherwise false.
+   *
+   * updater must not call back into the cache.
+   *
+   */
+  template <typename TUpdater>
+  bool update(const TKey& key, TUpdater&& updater);
+
+  /**
+   * DefaultLoadTimeout is the default time get_or_compute() waits for a load of another thread.
+   *
+   */
+  static constexpr std::chrono::milliseconds DefaultLoadTimeout{1000};
+
+  /**
+   * get_or_compute returns a copy of the value of key, on miss the value is loaded by loader
+   * and inserted into the cache.
+   *
+   * loader is invoked as loader(key) and returns std::optional<TValue>, std::nullopt is a
+   * negative result which is returned but not cached.
+   *
+   * Concurrent misses of the same key are deduplicated: only one thread runs its loader, the
+   * others wait up to timeout for its result. An exception thrown by loader is rethrown in the
+   * loading thread and in all waiting threads. A wait which times out throws LoadTimeoutError,
+   * thus std::nullopt is always a negative result of a loader.
+   *
+   * get_or_compute updates key access frequency.
+   *
+   */
+  template <typename TLoader>
+  std::optional<TValue> get_or_compute(const TKey& key,
+                                       TLoader&& loader,
+                                       std::chrono::milliseconds timeout = DefaultLoadTimeout);
+
+  /**
+   * multi_find looks up every key of [first, last) and writes a std::optional<TValue> copy of
+   * the value, or std::nullopt on miss, to out for each key in order.
+   * Returns the number of hits.
+   *
+   * The LRU order of all hits is updated in one linked-list lock hold; if the lock is contended
+   * the hits are recorded like find().
+   *
+   */
+  template <typename TKeyIterator, typename TOutputIterator>
+  size_t multi_find(TKeyIterator first, TKeyIterator last, TOutputIterator out);
+
+  /**
+   * multi_insert inserts every key/value pair of the forward range [first, last) whose key is
+   * absent. Elements are pair-like (std::get<0> key, std::get<1> value); rvalue elements, e.g.
+   * through std::move_iterator, are moved into the cache.
+   * Returns the number of inserted pairs.
+   *
+   * List nodes are allocated, linked and evicted with two linked-list lock holds per batch
+   * instead of up to three per insert().
+   *
+   */
+  template <typename TPairIterator>
+  size_t multi_insert(TPairIterator first, TPairIterator last);
+
+  /**
+   * clear erases all elements from the container, the removal listener is not notified.
+   * After this call, size() returns zero.
+   * Not thread-safe, and must not be called from the removal listener: the maintenance thread
+   * invokes it within an eviction cycle, which clear() waits for.
+   *
+   */
+  void clear() noexcept;
+
+  /**
+   * size returns the current cache size, summed from a striped counter without locking: exact
+   * once the running inserts/erases are done, approximate while they run.
+   *
+   */
+  int size() const {
+    return static_cast<int>(size_.load());
+  }
+
+  /**
+   * size_exact returns the count of entries linked in the LRU list at one point in time, it takes
+   * the list lock.
+   *
+   */
+  int size_exact();
+
+  /**
+   * stats returns a snapshot of the operation counters of TStats, all zero with NoStats.
+   * Counts racing with the snapshot could be missing from it.
+   *
+   */
+  CacheStats stats() const {
+    return stats_.snapshot();
+  }
+
+  /**
+   * latency returns the sampled find/insert/erase/eviction latency histograms of TStats, empty
+   * unless TStats is LatencyStats. multi_find() and multi_insert() are not timed.
+   *
+   */
+  LatencySnapshot latency() const {
+    return stats_.latency();
+  }
+
+  /**
+   * weight returns the total weight of the cached entries, equals size() with UnitWeigher.
+   *
+   */
+  int64_t weight() const {
+    return weight_.load();
+  }
+
+  /**
+   * capacity returns the cache capacity in weight units.
+   *
+   */
+  int64_t capacity() const {
+    return capacity_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * ShrinkChunkSize is the maximum number of entries set_capacity() and the maintenance thread
+   * evict in one linked-list lock hold.
+   *
+   */
+  static constexpr size_t ShrinkChunkSize = 256;
+
+  /**
+   * set_capacity changes the cache capacity, the new capacity applies to admission immediately.
+   *
+   * Shrinking evicts the least-recently used entries down to the new capacity in the calling
+   * thread, in chunks of ShrinkChunkSize; the linked-list lock is released between chunks, thus
+   * concurrent operations are not stalled for the whole shrink.
+   *
+   * capacity must be positive, it is clamped to MaxWeight.
+   * Thread-safe.
+   *
+   */
+  void set_capacity(int64_t capacity);
+
+  /**
+   * start_maintenance switches to background eviction: inserts only link the new entry and wake
+   * up a maintenance thread once the size is above capacity (high watermark), the thread evicts
+   * in chunks of ShrinkChunkSize down to capacity - slack (low watermark).
+   *
+   * Inserts still evict inline beyond capacity + overshoot, thus size() stays within about
+   * capacity + overshoot even if the maintenance thread falls behind.
+   *
+   * Calling it again while the maintenance thread runs changes overshoot and slack.
+   *
+   * overshoot and slack are clamped to [0, MaxWeight].
+   * Thread-safe, except against stop_maintenance().
+   *
+   */
+  void start_maintenance(int64_t overshoot, int64_t slack = 0);
+
+  /**
+   * stop_maintenance stops the maintenance thread, switches back to inline eviction and evicts
+   * down to the capacity.
+   * Thread-safe, except against start_maintenance().
+   *
+   */
+  void stop_maintenance();
+
+  /**
+   * set_removal_listener sets the listener notified of entries removed by eviction, expiry,
+   * erase() and insert_or_assign(), see RemovalListener. An empty listener disables
+   * notifications, no value is moved out of the cache then.
+   * The listener must not throw.
+   * Not thread-safe, set it before the cache is shared.
+   *
+   */
+  void set_removal_listener(RemovalListener<TKey, TValue> listener);
+
+  /**
+   * set_promotion_throttle sets the bounds under which a hit is not promoted, see
+   * PromotionThrottle. It applies to find(), find_visit(), get_or_compute() and multi_find(),
+   * with either Promotion.
+   * Not thread-safe, set it before the cache is shared.
+   *
+   */
+  void set_promotion_throttle(const PromotionThrottle& throttle);
+
+ private:
+  /**
+   * erase(), find(), contains() and peek() of TKey or a key-like type, declared after ConstAccessor.
+   * Thread-safe.
+   *
+   */
+  template <typename TKeyLike>
+  size_t eraseImpl(const TKeyLike& key);
+
+  template <typename TKeyLike>
+  bool findImpl(ConstAccessor& caccessor, const TKeyLike& key);
+
+  template <typename TKeyLike>
+  bool containsImpl(const TKeyLike& key);
+
+  template <typename TKeyLike>
+  bool peekImpl(ConstAccessor& caccessor, const TKeyLike& key);
+};
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+typename LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::ListNode* const
+  LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::NullNodePtr = reinterpret_cast<ListNode*>(-1);
+
+// ---- private member functions ----
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::unlink(ListNode* node) {
+  ListNode* prev = node->prev_;
+  ListNode* next = node->next_;
+  prev->next_ = next;
+  next->prev_ = prev;
+
+  // assign to NullNodePtr as indicator that this node is no longer in the double-linked list.
+  node->prev_ = NullNodePtr;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::append(ListNode* node) {
+  ListNode* prevLatestNode = tail_.prev_;
+
+  // stamped for the promotion throttle, the clock is only read for a window.
+  const uint64_t seq = appendSeq_.load(std::memory_order_relaxed) + 1;
+  appendSeq_.store(seq, std::memory_order_relaxed);
+  node->appendSeq_.store(seq, std::memory_order_relaxed);
+  if (throttleWindowMs_ > 0) {
+    node->appendedMs_.store(static_cast<uint32_t>(nowTick()), std::memory_order_relaxed);
+  }
+
+  node->next_ = &tail_;
+  node->prev_ = prevLatestNode;
+
+  tail_.prev_ = node;
+  prevLatestNode->next_ = node;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+typename LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::ListNode*
+LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::NodePool::allocate() {
+  ListNode* node = freeList_;
+
+  if (node != nullptr) {
+    // lookups holding a stale pointer still read the stamps, a constructor would race with them.
+    freeList_ = node->next_;
+    node->recycle();
+
+    return node;
+  }
+
+  if (chunkUsed_ == ChunkSize) {
+    chunks_.reserve(chunks_.size() + 1);
+    // ListNode is trivially destructible, nodes are constructed on allocate below.
+    chunks_.push_back(NodeAllocatorTraits::allocate(allocator_, ChunkSize));
+    chunkUsed_ = 0;
+  }
+
+  node = chunks_.back() + chunkUsed_++;
+
+  return ::new (static_cast<void*>(node)) ListNode();
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::NodePool::release(ListNode* node) {
+  // prev_ stays NullNodePtr thus a stale reference reads the node as not in list.
+  node->prev_ = NullNodePtr;
+  node->key_ = nullptr;
+  node->next_ = freeList_;
+  freeList_ = node;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::NodePool::clear() noexcept {
+  for (ListNode* chunk : chunks_) {
+    NodeAllocatorTraits::deallocate(allocator_, chunk, ChunkSize);
+  }
+
+  chunks_.clear();
+  freeList_ = nullptr;
+  chunkUsed_ = ChunkSize;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::TimerWheel::TimerWheel()
+  : wheel_(), overflow_(), currentTick_(nowTick()), count_(0) {
+  clear();
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::TimerWheel::clear() noexcept {
+  // buckets are circular lists, an empty bucket links to itself.
+  for (auto& level : wheel_) {
+    for (TimerLink& bucket : level) {
+      bucket.timerPrev_ = &bucket;
+      bucket.timerNext_ = &bucket;
+    }
+  }
+
+  overflow_.timerPrev_ = &overflow_;
+  overflow_.timerNext_ = &overflow_;
+  count_ = 0;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+typename LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::TimerLink&
+  LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::TimerWheel::bucketFor(int64_t expiresAt) {
+  const int64_t remaining = expiresAt - currentTick_;
+
+  for (size_t level = 0; level < Levels; level++) {
+    // a level covers Buckets ticks of its span, the next level has Buckets times the span.
+    if (remaining < (int64_t{1} << (BucketBits * (level + 1)))) {
+      return wheel_[level][(expiresAt >> (BucketBits * level)) & (Buckets - 1)];
+    }
+  }
+
+  return overflow_;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::TimerWheel::schedule(ListNode* node) {
+  TimerLink& bucket = bucketFor(node->expiresAt_);
+
+  node->timerNext_ = &bucket;
+  node->timerPrev_ = bucket.timerPrev_;
+  bucket.timerPrev_->timerNext_ = node;
+  bucket.timerPrev_ = node;
+  count_++;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::TimerWheel::unschedule(ListNode* node) {
+  if (node->timerNext_ == nullptr) {
+    return;
+  }
+
+  node->timerPrev_->timerNext_ = node->timerNext_;
+  node->timerNext_->timerPrev_ = node->timerPrev_;
+  node->timerPrev_ = nullptr;
+  node->timerNext_ = nullptr;
+  count_--;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename TExpire>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::TimerWheel::advance(int64_t now,
+                                                                                              TExpire&& expire) {
+  const int64_t previous = currentTick_;
+  if (now <= previous) {
+    return;
+  }
+
+  currentTick_ = now;
+
+  for (size_t level = 0; level <= Levels; level++) {
+    const int64_t previousTicks = previous >> (BucketBits * level);
+    const int64_t delta = (now >> (BucketBits * level)) - previousTicks;
+
+    // higher levels only turn once the lower level wrapped.
+    if (delta <= 0) {
+      break;
+    }
+
+    if (level == Levels) {
+      expireBucket(overflow_, expire);
+      break;
+    }
+
+    // the buckets the clock passed on this level, at most one turn.
+    const size_t first = static_cast<size_t>(previousTicks) & (Buckets - 1);
+    const size_t count = static_cast<size_t>(std::min<int64_t>(delta, Buckets));
+    for (size_t i = 0; i < count; i++) {
+      expireBucket(wheel_[level][(first + i) & (Buckets - 1)], expire);
+    }
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename TExpire>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::TimerWheel::expireBucket(TimerLink& bucket,
+                                                                                                   TExpire& expire) {
+  // detach the whole bucket, nodes rescheduled into it are visited on its next turn.
+  TimerLink* link = bucket.timerNext_;
+  bucket.timerPrev_ = &bucket;
+  bucket.timerNext_ = &bucket;
+
+  while (link != &bucket) {
+    ListNode* node = static_cast<ListNode*>(link);
+    link = link->timerNext_;
+
+    node->timerPrev_ = nullptr;
+    node->timerNext_ = nullptr;
+    count_--;
+
+    if (node->expiresAt_ <= currentTick_) {
+      expire(node);
+    } else {
+      schedule(node);
+    }
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::ReadBuffer::ReadBuffer(size_t stripeCount)
+  : stripes_(), mask_(stripeMask(stripeCount)) {
+  stripes_ = std::make_unique<Stripe[]>(mask_ + 1);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::ReadBuffer::record(ListNode* node) {
+  Stripe& stripe = stripes_[threadProbe() & mask_];
+
+  size_t head = stripe.readCnt_.load(std::memory_order_acquire);
+  size_t tail = stripe.writeCnt_.load(std::memory_order_relaxed);
+
+  if (tail - head >= StripeSize) {
+    return false;
+  }
+
+  // losing the race against another thread of the same stripe drops the access.
+  if (stripe.writeCnt_.compare_exchange_strong(tail, tail + 1, std::memory_order_relaxed)) {
+    stripe.slots_[tail % StripeSize].store(node, std::memory_order_release);
+  }
+
+  return true;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename TVisitor>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::ReadBuffer::drain(TVisitor&& visitor) {
+  for (size_t i = 0; i <= mask_; i++) {
+    Stripe& stripe = stripes_[i];
+
+    size_t head = stripe.readCnt_.load(std::memory_order_relaxed);
+    const size_t tail = stripe.writeCnt_.load(std::memory_order_acquire);
+
+    for (; head != tail; ++head) {
+      ListNode* node = stripe.slots_[head % StripeSize].exchange(nullptr, std::memory_order_acquire);
+
+      // slot claimed but not yet published, continue from here on next drain.
+      if (node == nullptr) {
+        break;
+      }
+
+      visitor(node);
+    }
+
+    stripe.readCnt_.store(head, std::memory_order_release);
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::ReadBuffer::clear() noexcept {
+  for (size_t i = 0; i <= mask_; i++) {
+    Stripe& stripe = stripes_[i];
+
+    for (auto& slot : stripe.slots_) {
+      slot.store(nullptr, std::memory_order_relaxed);
+    }
+
+    stripe.readCnt_.store(0, std::memory_order_relaxed);
+    stripe.writeCnt_.store(0, std::memory_order_relaxed);
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::promote(ListNode* node) {
+  // If the node got recycled in the meantime this promotes another entry, which is harmless.
+  if (node->inList()) {
+    unlink(node);
+    append(node);
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::drainReadBuffer() {
+  readBuffer_.drain([this](ListNode* node) { promote(node); });
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+std::unique_lock<typename LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::ListMutex>
+  LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::lockList() {
+  std::unique_lock<ListMutex> lock{listMutex_, std::defer_lock};
+  lockCounted(lock, stats_);
+
+  return lock;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::throttled(const ListNode* node) const {
+  // a recycled node reads the stamps of its new entry, which only misjudges this one hit.
+  if (throttleFraction_ > 0) {
+    // at most appended nodes are ahead of node, thus it is among that many most-recently used.
+    const uint64_t appended =
+      appendSeq_.load(std::memory_order_relaxed) - node->appendSeq_.load(std::memory_order_relaxed);
+    if (static_cast<double>(appended) < throttleFraction_ * current_size_.load(std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+
+  if (throttleWindowMs_ > 0) {
+    // wraps around like the stamp, thus the age is right across the 32 bit overflow.
+    const uint32_t age = static_cast<uint32_t>(nowTick()) - node->appendedMs_.load(std::memory_order_relaxed);
+    if (age < throttleWindowMs_) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::recordAccess(ListNode* node) {
+  if (throttled(node)) {
+    stats_.record(StatsCounter::SkippedPromotion);
+    return;
+  }
+
+  // record the hit without locking; the read buffer is drained on eviction.
+  if (promotion_ == Promotion::Buffered && readBuffer_.record(node)) {
+    return;
+  }
+
+  // Update double-linked list with try lock, draining the full read buffer in the same lock hold.
+  // If lock can't be obtained, skip updating the LRU linked list.
+  std::unique_lock<ListMutex> lock{listMutex_, std::try_to_lock};
+  if (lock) {
+    if (promotion_ == Promotion::Buffered) {
+      drainReadBuffer();
+    }
+
+    promote(node);
+  } else {
+    stats_.record(StatsCounter::SkippedPromotion);
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::recordAccesses(
+  const std::vector<ListNode*>& nodes) {
+  if (nodes.empty()) {
+    return;
+  }
+
+  // no lock for a batch of throttled hits only, otherwise the batch is promoted as a whole.
+  if (std::all_of(nodes.begin(), nodes.end(), [this](const ListNode* node) { return throttled(node); })) {
+    stats_.record(StatsCounter::SkippedPromotion, nodes.size());
+    return;
+  }
+
+  std::unique_lock<ListMutex> lock{listMutex_, std::try_to_lock};
+  if (lock) {
+    if (promotion_ == Promotion::Buffered) {
+      drainReadBuffer();
+    }
+
+    for (ListNode* node : nodes) {
+      promote(node);
+    }
+  } else if (promotion_ == Promotion::Buffered) {
+    for (ListNode* node : nodes) {
+      if (!readBuffer_.record(node)) {
+        stats_.record(StatsCounter::SkippedPromotion);
+      }
+    }
+  } else {
+    stats_.record(StatsCounter::SkippedPromotion, nodes.size());
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::popFront(int64_t limit,
+                                                                                   Notifications& removed) {
+  const TKey* key{nullptr};
+  std::vector<const TKey*> expiredKeys;
+
+  {
+    std::unique_lock<ListMutex> lock = lockList();
+
+    // concurrent inserts evict as well, the weight is checked under the lock thus the cache is
+    // not shrunk below limit.
+    if (weight_.load(std::memory_order_relaxed) <= limit) {
+      return false;
+    }
+
+    // expired entries go before any live victim.
+    expireEntries(expiredKeys);
+
+    if (weight_.load(std::memory_order_relaxed) > limit) {
+      // apply pending hits first, thus the victim is the actual least-recently used node.
+      drainReadBuffer();
+      key = unlinkFront();
+    }
+  }
+
+  eraseVictims(expiredKeys, RemovalCause::Expired, removed);
+
+  if (key != nullptr) {
+    eraseVictim(*key, RemovalCause::Size, removed);
+  }
+
+  return key != nullptr || !expiredKeys.empty();
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+const TKey* LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::unlinkFront() {
+  ListNode* candidate = head_.next_;
+
+  if (candidate == &tail_) {
+    return nullptr;
+  }
+
+  return detach(candidate);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+const TKey* LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::detach(ListNode* node) {
+  unlink(node);
+  timerWheel_.unschedule(node);
+  current_size_--;
+  weight_ -= node->weight_;
+  size_.add(-1);
+
+  // unlinking makes this thread the owner of the hash-table element erasure,
+  // the key inside the element stays valid until it is erased.
+  const TKey* key = node->key_;
+  nodePool_.release(node);
+
+  return key;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::expireEntries(
+  std::vector<const TKey*>& victims) {
+  if (timerWheel_.empty()) {
+    return;
+  }
+
+  timerWheel_.advance(nowTick(), [this, &victims](ListNode* node) { victims.push_back(detach(node)); });
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+int64_t LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::nowTick() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+    .count();
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::eraseVictim(const TKey& key,
+                                                                                      RemovalCause cause,
+                                                                                      Notifications& removed) {
+  [[maybe_unused]] auto timer = stats_.time(LatencyOp::Eviction, cause == RemovalCause::Size);
+  // write lock, the value is moved out for the listener.
+  HashMapAccessor accessor;
+  if (!hash_map_.find(accessor, key)) {
+    return;
+  }
+
+  recordRemoval(accessor->first, accessor->second.value_, cause, removed);
+
+  // erase issues lock, do not call this API inside linked-list lock.
+  // https://github.com/jckarter/tbb/blob/0343100743d23f707a9001bc331988a31778c9f4/include/tbb/concurrent_hash_map.h#L1093
+  hash_map_.erase(accessor);
+
+  if (cause == RemovalCause::Size) {
+    stats_.record(StatsCounter::Eviction);
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::recordRemoval(const TKey& key,
+                                                                                        TValue& value,
+                                                                                        RemovalCause cause,
+                                                                                        Notifications& removed) const {
+  if (removalListener_) {
+    removed.push_back({key, std::move(value), cause});
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::notifyRemoval(Notifications& removed) {
+  if (!removed.empty()) {
+    removalListener_(removed);
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+int64_t LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::weigh(const TKey& key,
+                                                                                   const TValue& value) const {
+  if constexpr (IsUnitWeigher<TWeigher>::value) {
+    return 1;
+  } else {
+    return clampWeight(weigher_(key, value));
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::reweigh(HashMapAccessor& accessor) {
+  if constexpr (!IsUnitWeigher<TWeigher>::value) {
+    const int64_t weight = weigh(accessor->first, accessor->second.value_);
+    ListNode* node = accessor->second.listNode_;
+
+    std::unique_lock<ListMutex> lock = lockList();
+    // an evicted node no longer accounts for the element.
+    if (owns(node, accessor->first)) {
+      weight_ += weight - node->weight_;
+      node->weight_ = weight;
+    }
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::enforceCapacity(Notifications& removed) {
+  const int64_t capacity = capacity_.load(std::memory_order_relaxed);
+  const int64_t overshoot = overshoot_.load(std::memory_order_relaxed);
+  // with background eviction inserts only evict beyond the high watermark.
+  const int64_t limit = overshoot < 0 ? capacity : capacity + overshoot;
+
+  while (weight_.load() > limit && popFront(limit, removed)) {
+  }
+
+  if (overshoot >= 0 && weight_.load() > capacity) {
+    requestMaintenance();
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+TAllocator LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::bindAllocator(
+  const TAllocator& allocator) const {
+  if constexpr (IsSlabAllocator<TAllocator>::value) {
+    if (slabPool_) {
+      return TAllocator(*slabPool_);
+    }
+  }
+
+  return allocator;
+}
+
+// ---- private member functions end ----
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::LRUCache(int64_t size,
+                                                                              size_t bucketCount,
+                                                                              Promotion promotion,
+                                                                              const TAllocator& allocator,
+                                                                              const TWeigher& weigher)
+  : slabPool_([&allocator]() -> std::unique_ptr<SlabPool> {
+      if constexpr (IsSlabAllocator<TAllocator>::value) {
+        if (allocator.pool() == nullptr) {
+          return std::make_unique<SlabPool>();
+        }
+      }
+      return nullptr;
+    }()),
+    hash_map_(bucketCount, HashMapAllocator(bindAllocator(allocator))),
+    flights_(),
+    listMutex_(),
+    head_(),
+    tail_(),
+    current_size_(0),
+    appendSeq_(0),
+    weight_(0),
+    nodePool_(NodeAllocator(bindAllocator(allocator))),
+    timerWheel_(),
+    capacity_(std::min(size, MaxWeight)),
+    overshoot_(-1),
+    slack_(0),
+    expiring_(false),
+    promotion_(promotion),
+    throttleFraction_(0),
+    throttleWindowMs_(0),
+    weigher_(weigher),
+    removalListener_(),
+    readBuffer_(std::thread::hardware_concurrency()),
+    size_(),
+    stats_(),
+    maintenancePending_(false),
+    maintenanceStop_(false),
+    maintenanceMutex_(),
+    maintenanceCv_(),
+    maintenanceCycleMutex_(),
+    maintenanceThread_() {
+  head_.prev_ = nullptr;
+  head_.next_ = &tail_;
+  tail_.prev_ = &head_;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+size_t LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::erase(const TKey& key) {
+  return eraseImpl(key);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename TKeyLike, typename>
+size_t LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::erase(const TKeyLike& key) {
+  return eraseImpl(key);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename TKeyLike>
+size_t LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::eraseImpl(const TKeyLike& key) {
+  [[maybe_unused]] auto timer = stats_.time(LatencyOp::Erase);
+  Notifications removed;
+
+  {
+    // fine-grained write lock for hash_map, held until the element is erased.
+    HashMapAccessor accessor;
+    if (!hash_map_.find(accessor, key)) {
+      return 0;
+    }
+
+    eraseElement(accessor, expired(accessor->second) ? RemovalCause::Expired : RemovalCause::Explicit, removed);
+  }
+
+  notifyRemoval(removed);
+
+  return 1;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::eraseElement(HashMapAccessor& accessor,
+                                                                                       RemovalCause cause,
+                                                                                       Notifications& removed) {
+  bool marked = false;
+
+  {
+    ListNode* found_node = accessor->second.listNode_;
+
+    std::unique_lock<ListMutex> lock = lockList();
+    // node might have been unlinked (and recycled) by popFront, which then owns the erasure.
+    if (owns(found_node, accessor->first)) {
+      detach(found_node);
+      marked = true;
+    }
+  }
+
+  if (marked) {
+    recordRemoval(accessor->first, accessor->second.value_, cause, removed);
+
+    // erase issues lock, do not call this API inside linked-list lock.
+    // https://github.com/jckarter/tbb/blob/0343100743d23f707a9001bc331988a31778c9f4/include/tbb/concurrent_hash_map.h#L1093
+    hash_map_.erase(accessor);
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename TKeyLike>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::purgeExpired(const TKeyLike& key,
+                                                                                       Notifications& removed) {
+  HashMapAccessor accessor;
+  if (hash_map_.find(accessor, key) && expired(accessor->second)) {
+    eraseElement(accessor, RemovalCause::Expired, removed);
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::find(ConstAccessor& caccessor,
+                                                                               const TKey& key) {
+  return findImpl(caccessor, key);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename TKeyLike, typename>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::find(ConstAccessor& caccessor,
+                                                                               const TKeyLike& key) {
+  return findImpl(caccessor, key);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::contains(const TKey& key) {
+  return containsImpl(key);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename TKeyLike, typename>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::contains(const TKeyLike& key) {
+  return containsImpl(key);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::peek(ConstAccessor& caccessor,
+                                                                               const TKey& key) {
+  return peekImpl(caccessor, key);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename TKeyLike, typename>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::peek(ConstAccessor& caccessor,
+                                                                               const TKeyLike& key) {
+  return peekImpl(caccessor, key);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+HashedKey<TKey> LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::hashed_key(const TKey& key) {
+  return HashedKey<TKey>(key, THash().hash(key));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::find(ConstAccessor& caccessor,
+                                                                               const HashedKey<TKey>& key) {
+  return findImpl(caccessor, key);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+size_t LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::erase(const HashedKey<TKey>& key) {
+  return eraseImpl(key);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::contains(const HashedKey<TKey>& key) {
+  return containsImpl(key);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::peek(ConstAccessor& caccessor,
+                                                                               const HashedKey<TKey>& key) {
+  return peekImpl(caccessor, key);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::insert(const HashedKey<TKey>& key,
+                                                                                 const TValue& value) {
+  return emplaceImpl(NoExpiry, key, value);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::insert(const HashedKey<TKey>& key,
+                                                                                 TValue&& value) {
+  return emplaceImpl(NoExpiry, key, std::move(value));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename TKeyLike>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::containsImpl(const TKeyLike& key) {
   HashMapConstAccessor accessor;
-  if (!hash_map_.find(accessor, candidate->key_)) {
-    return;
+  return hash_map_.find(accessor, key) && !expired(accessor->second);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename TKeyLike>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::peekImpl(ConstAccessor& caccessor,
+                                                                                   const TKeyLike& key) {
+  // fine-grained read lock on hash_map, the list node is not touched.
+  const bool found = hash_map_.find(caccessor.constAccessor_, key) && !expired(caccessor.constAccessor_->second);
+  if (found) {
+    caccessor.setValue();
   }
+  caccessor.constAccessor_.release();  // manual release, reference object can't count on RAII
 
-  // erase issues lock, do not call this API inside linked-list lock.
-  // https://github.com/jckarter/tbb/blob/0343100743d23f707a9001bc331988a31778c9f4/include/tbb/concurrent_hash_map.h#L1093
-  hash_map_.erase(accessor);
+  return found;
 }
 
-// ---- private member functions end ----
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename TKeyLike>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::findImpl(ConstAccessor& caccessor,
+                                                                                   const TKeyLike& key) {
+  [[maybe_unused]] auto timer = stats_.time(LatencyOp::Find);
+  ListNode* found_node{nullptr};
 
-template <class TKey, class TValue, class THash>
-LRUCache<TKey, TValue, THash>::LRUCache(int size, size_t bucketCount)
-  : hash_map_(bucketCount), current_size_(0), capacity_(size) {
-  head_.prev_ = nullptr;
-  head_.next_ = &tail_;
-  tail_.prev_ = &head_;
+  {
+    // fine-grained read lock on hash_map
+    if (!hash_map_.find(caccessor.constAccessor_, key) || expired(caccessor.constAccessor_->second)) {
+      caccessor.constAccessor_.release();  // manual release, reference object can't count on RAII
+      stats_.record(StatsCounter::Miss);
+      return false;
+    } else {
+      // copy value from hash_map
+      caccessor.setValue();
+      // node memory is owned by nodePool_, it stays valid after the accessor is released.
+      found_node = caccessor.constAccessor_->second.listNode_;
+      caccessor.constAccessor_.release();  // manual release, reference object can't count on RAII
+    }
+  }
+
+  stats_.record(StatsCounter::Hit);
+  recordAccess(found_node);
+
+  return true;
 }
 
-template <class TKey, class TValue, class THash>
-size_t LRUCache<TKey, TValue, THash>::erase(const TKey& key) {
-  std::shared_ptr<ListNode> found_node;
-  bool marked = false;
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename TVisitor>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::find_visit(const TKey& key,
+                                                                                     TVisitor&& visitor) {
+  [[maybe_unused]] auto timer = stats_.time(LatencyOp::Find);
+  const bool found = visitImpl(key, std::forward<TVisitor>(visitor));
+  stats_.record(found ? StatsCounter::Hit : StatsCounter::Miss);
+
+  return found;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename TVisitor>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::visitImpl(const TKey& key,
+                                                                                    TVisitor&& visitor) {
+  ListNode* found_node{nullptr};
 
-  // fine-grained read lock for hash_map
   {
+    // fine-grained read lock on hash_map, visitor reads the value in place.
     HashMapConstAccessor accessor;
-    if (!hash_map_.find(accessor, key)) {
-      return 0;
+    if (!hash_map_.find(accessor, key) || expired(accessor->second)) {
+      return false;
+    }
+
+    std::forward<TVisitor>(visitor)(static_cast<const TValue&>(accessor->second.value_));
+    found_node = accessor->second.listNode_;
+  }
+
+  recordAccess(found_node);
+
+  return true;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename TKeyArg, typename... TArgs>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::emplaceImpl(int64_t expiresAt,
+                                                                                      TKeyArg&& key,
+                                                                                      TArgs&&... args) {
+  [[maybe_unused]] auto timer = stats_.time(LatencyOp::Insert);
+  ListNode* node{nullptr};
+  Notifications removed;
+
+  // an expired element would make the insert fail, the lookup is skipped for caches without TTL.
+  if (expiring_.load(std::memory_order_relaxed)) {
+    purgeExpired(key, removed);
+  }
+
+  {
+    // fine-grained write lock for hash_map, prevents other lock acquires hash_map
+    // key and value are constructed in the hash_map node.
+    HashMapAccessor accessor;
+    if (!hash_map_.emplace(accessor,
+                           std::piecewise_construct,
+                           std::forward_as_tuple(std::forward<TKeyArg>(key)),
+                           std::forward_as_tuple(std::in_place, std::forward<TArgs>(args)...))) {
+      accessor.release();
+      notifyRemoval(removed);
+      return false;
+    }
+
+    if (expiresAt != NoExpiry) {
+      accessor->second.expiresAt_ = expiresAt;
+      // stored once, the flag shares its line with the settings read by every operation.
+      if (!expiring_.load(std::memory_order_relaxed)) {
+        expiring_.store(true, std::memory_order_relaxed);
+      }
+    }
+
+    node = attachNode(accessor);
+  }
+
+  admit(node, removed);
+  notifyRemoval(removed);
+
+  return true;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+typename LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::ListNode*
+  LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::attachNode(HashMapAccessor& accessor) {
+  // the weigher is user code, call it outside the list lock.
+  const int64_t weight = weigh(accessor->first, accessor->second.value_);
+
+  // attach the node while holding the write lock, thus readers never observe an element without node.
+  std::unique_lock<ListMutex> lock = lockList();
+  ListNode* node = nodePool_.allocate();
+  node->key_ = &accessor->first;
+  node->weight_ = weight;
+  node->expiresAt_ = accessor->second.expiresAt_;
+  accessor->second.listNode_ = node;
+  lock.unlock();
+
+  size_.add(1);
+
+  return node;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::admit(ListNode* node,
+                                                                                Notifications& removed) {
+  const int64_t capacity = capacity_.load(std::memory_order_relaxed);
+  const int64_t overshoot = overshoot_.load(std::memory_order_relaxed);
+  const int64_t limit = overshoot < 0 ? capacity : capacity + overshoot;
+  const TKey* victim{nullptr};
+  std::vector<const TKey*> expiredKeys;
+
+  {
+    std::unique_lock<ListMutex> lock = lockList();
+
+    if (node->weight_ > capacity) {
+      // heavier than the whole cache, evicted right away instead of flushing all other entries.
+      victim = node->key_;
+      nodePool_.release(node);
+      size_.add(-1);
     } else {
-      found_node = accessor->second.listNode_;
+      // node is still owned by this entry, only a linked node can be released by others.
+      append(node);
+      current_size_++;
+      weight_ += node->weight_;
+
+      if (node->expiresAt_ != NoExpiry) {
+        timerWheel_.schedule(node);
+      }
+
+      // expired entries go before any live victim.
+      expireEntries(expiredKeys);
+
+      // the common case of one victim is evicted within the same lock hold.
+      if (weight_.load(std::memory_order_relaxed) > limit) {
+        // apply pending hits first, thus the victim is the actual least-recently used node.
+        drainReadBuffer();
+        victim = unlinkFront();
+      }
     }
   }
 
+  eraseVictims(expiredKeys, RemovalCause::Expired, removed);
+
+  if (victim != nullptr) {
+    eraseVictim(*victim, RemovalCause::Size, removed);
+  }
+
+  enforceCapacity(removed);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::admitBatch(
+  const std::vector<ListNode*>& attached, const std::vector<ListNode*>& spare, Notifications& removed) {
+  const int64_t capacity = capacity_.load(std::memory_order_relaxed);
+  const int64_t overshoot = overshoot_.load(std::memory_order_relaxed);
+  const int64_t limit = overshoot < 0 ? capacity : capacity + overshoot;
+
+  std::vector<const TKey*> expiredKeys;
+  std::vector<const TKey*> victims;
+
   {
-    if (found_node->inList()) {
-      std::unique_lock<ListMutex> lock(listMutex_);
-      if (found_node->inList()) {
-        unlink(found_node.get());
-        current_size_--;
-        marked = true;
+    std::unique_lock<ListMutex> lock = lockList();
+
+    for (ListNode* node : spare) {
+      nodePool_.release(node);
+    }
+
+    // summed until above limit, thus a large batch of heavy nodes does not overflow.
+    int64_t batchWeight = weight_.load(std::memory_order_relaxed);
+    for (auto it = attached.begin(); it != attached.end() && batchWeight <= limit; ++it) {
+      batchWeight += (*it)->weight_;
+    }
+
+    if (batchWeight > limit) {
+      // apply pending hits first, thus the victims are the actual least-recently used nodes.
+      drainReadBuffer();
+    }
+
+    // at most one live victim per node of the batch, see evictOverflow().
+    size_t budget = attached.size();
+    for (ListNode* node : attached) {
+      if (node->weight_ > capacity) {
+        // same as admit(), heavier than the whole cache.
+        victims.push_back(node->key_);
+        nodePool_.release(node);
+        size_.add(-1);
+        continue;
+      }
+
+      append(node);
+      current_size_++;
+      weight_ += node->weight_;
+
+      if (node->expiresAt_ != NoExpiry) {
+        timerWheel_.schedule(node);
+      }
+
+      // evicted while the batch is linked, thus the weight stays within limit + MaxWeight.
+      if (weight_.load(std::memory_order_relaxed) > limit) {
+        const size_t victimCount = victims.size();
+        evictOverflow(limit, budget, expiredKeys, victims);
+        budget -= victims.size() - victimCount;
       }
     }
+
+    evictOverflow(limit, budget, expiredKeys, victims);
   }
 
-  if (marked) {
-    // erase issues lock, do not call this API inside linked-list lock.
-    // https://github.com/jckarter/tbb/blob/0343100743d23f707a9001bc331988a31778c9f4/include/tbb/concurrent_hash_map.h#L1093
-    hash_map_.erase(key);
+  eraseVictims(expiredKeys, RemovalCause::Expired, removed);
+  eraseVictims(victims, RemovalCause::Size, removed);
+  enforceCapacity(removed);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+size_t LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::evictOverflow(
+  int64_t limit, size_t maxCount, std::vector<const TKey*>& expiredKeys, std::vector<const TKey*>& victims) {
+  const size_t victimCount = expiredKeys.size() + victims.size();
+
+  // expired entries go before any live victim, they are not counted against maxCount.
+  expireEntries(expiredKeys);
+
+  for (size_t evicted = 0; evicted < maxCount && weight_.load(std::memory_order_relaxed) > limit; evicted++) {
+    const TKey* key = unlinkFront();
+    if (key == nullptr) {
+      break;
+    }
+
+    victims.push_back(key);
   }
 
-  return 1;
+  return expiredKeys.size() + victims.size() - victimCount;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::eraseVictims(
+  const std::vector<const TKey*>& victims, RemovalCause cause, Notifications& removed) {
+  for (const TKey* key : victims) {
+    eraseVictim(*key, cause, removed);
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::insert(const TKey& key, const TValue& value) {
+  return emplaceImpl(NoExpiry, key, value);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::insert(const TKey& key, TValue&& value) {
+  return emplaceImpl(NoExpiry, key, std::move(value));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::insert(TKey&& key, TValue&& value) {
+  return emplaceImpl(NoExpiry, std::move(key), std::move(value));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::insert(const TKey& key,
+                                                                                 const TValue& value,
+                                                                                 std::chrono::milliseconds ttl) {
+  // NoExpiry is never a valid expiry tick.
+  return emplaceImpl(std::max<int64_t>(nowTick() + ttl.count(), NoExpiry + 1), key, value);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::insert(TKey&& key,
+                                                                                 TValue&& value,
+                                                                                 std::chrono::milliseconds ttl) {
+  return emplaceImpl(std::max<int64_t>(nowTick() + ttl.count(), NoExpiry + 1), std::move(key), std::move(value));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename... TArgs>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::emplace(const TKey& key, TArgs&&... args) {
+  return emplaceImpl(NoExpiry, key, std::forward<TArgs>(args)...);
 }
 
-template <class TKey, class TValue, class THash>
-bool LRUCache<TKey, TValue, THash>::find(ConstAccessor& caccessor, const TKey& key) {
-  std::shared_ptr<ListNode> found_node;
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename... TArgs>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::emplace(TKey&& key, TArgs&&... args) {
+  return emplaceImpl(NoExpiry, std::move(key), std::forward<TArgs>(args)...);
+}
 
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename... TArgs>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::try_emplace(const TKey& key,
+                                                                                      TArgs&&... args) {
   {
-    // fine-grained read lock on hash_map
-    if (!hash_map_.find(caccessor.constAccessor_, key)) {
-      caccessor.constAccessor_.release();  // manual release, reference object can't count on RAII
+    // read lock only, args are not consumed if key exists.
+    HashMapConstAccessor accessor;
+    if (hash_map_.find(accessor, key)) {
       return false;
-    } else {
-      // copy value from hash_map
-      caccessor.setValue();
-      // shared owner-ship for listNode. ref cnt increased, decrease when found_node out of the scope.
-      found_node = caccessor.constAccessor_->second.listNode_;
-      caccessor.constAccessor_.release();  // manual release, reference object can't count on RAII
     }
   }
 
+  return emplaceImpl(NoExpiry, key, std::forward<TArgs>(args)...);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename... TArgs>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::try_emplace(TKey&& key, TArgs&&... args) {
+  {
+    // read lock only, args are not consumed if key exists.
+    HashMapConstAccessor accessor;
+    if (hash_map_.find(accessor, key)) {
+      return false;
+    }
+  }
+
+  return emplaceImpl(NoExpiry, std::move(key), std::forward<TArgs>(args)...);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename TValueArg>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::insert_or_assign(const TKey& key,
+                                                                                           TValueArg&& value) {
+  [[maybe_unused]] auto timer = stats_.time(LatencyOp::Insert);
+  ListNode* node{nullptr};
+  bool inserted = false;
+  Notifications removed;
+
+  // an expired element is replaced as an absent one.
+  if (expiring_.load(std::memory_order_relaxed)) {
+    purgeExpired(key, removed);
+  }
+
   {
-    // Key found, update double-linked list with try lock.
-    // If lock can't be obtained, skip updating the LRU linked list.
-    std::unique_lock<ListMutex> lock{listMutex_, std::try_to_lock};
-    if (lock) {
-      if (found_node->inList()) {
-        // share linkNode ownership to unlink API.
-        unlink(found_node.get());
-        // share linkNode ownership to append API.
-        append(found_node.get());
+    // single lookup; a new element is default constructed, then assigned like an existing one.
+    HashMapAccessor accessor;
+    inserted = hash_map_.insert(accessor, key);
+
+    if (inserted) {
+      try {
+        accessor->second.value_ = std::forward<TValueArg>(value);
+      } catch (...) {
+        // insert has no effect on exception.
+        hash_map_.erase(accessor);
+        throw;
       }
+
+      node = attachNode(accessor);
+    } else {
+      recordRemoval(accessor->first, accessor->second.value_, RemovalCause::Replaced, removed);
+      accessor->second.value_ = std::forward<TValueArg>(value);
+      node = accessor->second.listNode_;
+      reweigh(accessor);
     }
   }
 
-  return true;
+  if (inserted) {
+    admit(node, removed);
+  } else {
+    recordAccess(node);
+
+    if constexpr (!IsUnitWeigher<TWeigher>::value) {
+      enforceCapacity(removed);
+    }
+  }
+
+  notifyRemoval(removed);
+
+  return inserted;
 }
 
-template <class TKey, class TValue, class THash>
-bool LRUCache<TKey, TValue, THash>::insert(const TKey& key, const TValue& value) {
-  std::shared_ptr<ListNode> node = std::make_shared<ListNode>(key);
-  HashMapValuePair hashMapValue{key, Value{value, node}};
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename TUpdater>
+bool LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::update(const TKey& key, TUpdater&& updater) {
+  ListNode* found_node{nullptr};
 
   {
-    // fine-grained write lock for hash_map, prevents other lock acquires hash_map
+    // fine-grained write lock on hash_map, updater modifies the value in place.
     HashMapAccessor accessor;
-    if (!hash_map_.insert(accessor, hashMapValue)) {
+    if (!hash_map_.find(accessor, key) || expired(accessor->second)) {
       return false;
     }
+
+    std::forward<TUpdater>(updater)(accessor->second.value_);
+    found_node = accessor->second.listNode_;
+    reweigh(accessor);
+  }
+
+  recordAccess(found_node);
+
+  if constexpr (!IsUnitWeigher<TWeigher>::value) {
+    Notifications removed;
+    enforceCapacity(removed);
+    notifyRemoval(removed);
+  }
+
+  return true;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::completeFlight(
+  const TKey& key, Flight& flight, const std::optional<TValue>& value, std::exception_ptr error) {
+  // later misses start a new load, a loaded value is already in the cache.
+  flights_.erase(key);
+
+  {
+    std::unique_lock<std::mutex> lock(flight.mutex_);
+    flight.value_ = value;
+    flight.error_ = error;
+    flight.done_ = true;
   }
 
-  int size = current_size_.load();
-  bool popped = false;
-  if (size >= capacity_) {
-    popFront();
-    popped = true;
+  flight.doneCv_.notify_all();
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename TLoader>
+std::optional<TValue> LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::get_or_compute(
+  const TKey& key, TLoader&& loader, std::chrono::milliseconds timeout) {
+  std::optional<TValue> result;
+  auto copyValue = [&result](const TValue& value) { result.emplace(value); };
+
+  if (find_visit(key, copyValue)) {
+    return result;
   }
 
+  std::shared_ptr<Flight> flight;
+  bool leader = false;
+
   {
-    std::unique_lock<ListMutex> lock(listMutex_);
+    // the first thread registering the key runs the load.
+    FlightMapAccessor accessor;
+    leader = flights_.insert(accessor, key);
+    if (leader) {
+      accessor->second = std::make_shared<Flight>();
+    }
+    flight = accessor->second;
+  }
+
+  if (!leader) {
+    std::unique_lock<std::mutex> lock(flight->mutex_);
+    if (!flight->doneCv_.wait_for(lock, timeout, [&flight] { return flight->done_; })) {
+      throw LoadTimeoutError();
+    }
+
+    if (flight->error_) {
+      std::rethrow_exception(flight->error_);
+    }
+
+    return flight->value_;
+  }
+
+  try {
+    // the previous load of key might have completed after the miss above.
+    if (!visitImpl(key, copyValue)) {
+      result = std::forward<TLoader>(loader)(key);
 
-    append(node.get());
+      if (result) {
+        insert(key, *result);
+      }
+    }
+  } catch (...) {
+    completeFlight(key, *flight, std::nullopt, std::current_exception());
+    throw;
   }
 
-  if (!popped) {
-    size = current_size_++;
+  completeFlight(key, *flight, result, nullptr);
+
+  return result;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename TKeyIterator, typename TOutputIterator>
+size_t LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::multi_find(TKeyIterator first,
+                                                                                       TKeyIterator last,
+                                                                                       TOutputIterator out) {
+  std::vector<ListNode*> found;
+  size_t count = 0;
+
+  for (; first != last; ++first, ++out, ++count) {
+    std::optional<TValue> result;
+
+    {
+      // fine-grained read lock on hash_map, released before the next key.
+      HashMapConstAccessor accessor;
+      if (hash_map_.find(accessor, *first) && !expired(accessor->second)) {
+        result.emplace(accessor->second.value_);
+        found.push_back(accessor->second.listNode_);
+      }
+    }
+
+    *out = std::move(result);
   }
 
-  if (size > capacity_) {
-    if (current_size_.compare_exchange_strong(size, size - 1)) {
-      popFront();
+  stats_.record(StatsCounter::Hit, found.size());
+  stats_.record(StatsCounter::Miss, count - found.size());
+  recordAccesses(found);
+
+  return found.size();
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+template <typename TPairIterator>
+size_t LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::multi_insert(TPairIterator first,
+                                                                                         TPairIterator last) {
+  std::vector<ListNode*> spare(static_cast<size_t>(std::distance(first, last)));
+  std::vector<ListNode*> attached;
+  attached.reserve(spare.size());
+  Notifications removed;
+
+  {
+    // nodes are allocated up front, the element locks below must not be taken inside the list lock.
+    std::unique_lock<ListMutex> lock = lockList();
+    for (auto& node : spare) {
+      node = nodePool_.allocate();
     }
   }
 
-  return true;
+  try {
+    for (; first != last; ++first) {
+      auto&& entry = *first;
+
+      if (expiring_.load(std::memory_order_relaxed)) {
+        purgeExpired(std::get<0>(entry), removed);
+      }
+
+      HashMapAccessor accessor;
+      if (hash_map_.emplace(accessor,
+                            std::piecewise_construct,
+                            std::forward_as_tuple(std::get<0>(std::forward<decltype(entry)>(entry))),
+                            std::forward_as_tuple(std::in_place, std::get<1>(std::forward<decltype(entry)>(entry))))) {
+        // the node is not linked yet, thus no other thread reads its key.
+        ListNode* node = spare.back();
+        spare.pop_back();
+        node->key_ = &accessor->first;
+        node->weight_ = weigh(accessor->first, accessor->second.value_);
+        accessor->second.listNode_ = node;
+        attached.push_back(node);
+        size_.add(1);
+      }
+    }
+  } catch (...) {
+    // link the elements inserted so far, they are owned by the cache.
+    admitBatch(attached, spare, removed);
+    notifyRemoval(removed);
+    throw;
+  }
+
+  admitBatch(attached, spare, removed);
+  notifyRemoval(removed);
+
+  return attached.size();
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::set_capacity(int64_t capacity) {
+  capacity_.store(std::min(capacity, MaxWeight), std::memory_order_relaxed);
+  trim(0);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::trim(int64_t slack) {
+  std::vector<const TKey*> expiredKeys;
+  std::vector<const TKey*> victims;
+  victims.reserve(ShrinkChunkSize);
+  Notifications removed;
+
+  while (true) {
+    // capacity is reloaded per chunk, a concurrent set_capacity() applies to the running trim.
+    const int64_t limit = std::max(capacity_.load(std::memory_order_relaxed) - slack, int64_t{0});
+    if (weight_.load() <= limit) {
+      break;
+    }
+
+    size_t evicted = 0;
+
+    {
+      std::unique_lock<ListMutex> lock = lockList();
+
+      // apply pending hits first, thus the victims are the actual least-recently used nodes.
+      drainReadBuffer();
+      evicted = evictOverflow(limit, ShrinkChunkSize, expiredKeys, victims);
+    }
+
+    eraseVictims(expiredKeys, RemovalCause::Expired, removed);
+    eraseVictims(victims, RemovalCause::Size, removed);
+    expiredKeys.clear();
+    victims.clear();
+
+    // one batch per chunk.
+    notifyRemoval(removed);
+    removed.clear();
+
+    if (evicted == 0) {
+      break;
+    }
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::requestMaintenance() {
+  // the flag is read first, thus inserts do not contend on it while a wake-up is pending.
+  if (maintenancePending_.load(std::memory_order_relaxed) || maintenancePending_.exchange(true)) {
+    return;
+  }
+
+  {
+    // orders the flag with the predicate check of the waiting thread, no lost wake-up.
+    std::unique_lock<std::mutex> lock(maintenanceMutex_);
+  }
+
+  maintenanceCv_.notify_one();
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::maintain() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(maintenanceMutex_);
+      maintenanceCv_.wait(lock, [this] { return maintenanceStop_ || maintenancePending_.load(); });
+
+      if (maintenanceStop_) {
+        return;
+      }
+    }
+
+    // inserts arriving during the cycle request the next one.
+    maintenancePending_.store(false);
+
+    std::unique_lock<std::mutex> cycleLock(maintenanceCycleMutex_);
+    try {
+      trim(slack_.load(std::memory_order_relaxed));
+    } catch (...) {
+      // out of memory for the victim list, inserts keep evicting beyond the high watermark.
+    }
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::start_maintenance(int64_t overshoot,
+                                                                                            int64_t slack) {
+  slack_.store(std::clamp(slack, int64_t{0}, MaxWeight), std::memory_order_relaxed);
+  overshoot_.store(std::clamp(overshoot, int64_t{0}, MaxWeight), std::memory_order_relaxed);
+
+  if (!maintenanceThread_.joinable()) {
+    maintenanceThread_ = std::thread([this] { maintain(); });
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::stop_maintenance() {
+  if (!maintenanceThread_.joinable()) {
+    return;
+  }
+
+  join_maintenance();
+
+  // inserts during the stop may have left the cache above its capacity.
+  trim(0);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::join_maintenance() noexcept {
+  if (!maintenanceThread_.joinable()) {
+    return;
+  }
+
+  overshoot_.store(-1, std::memory_order_relaxed);
+
+  {
+    std::unique_lock<std::mutex> lock(maintenanceMutex_);
+    maintenanceStop_ = true;
+  }
+
+  maintenanceCv_.notify_one();
+  maintenanceThread_.join();
+
+  maintenanceStop_ = false;
+  maintenancePending_.store(false);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::set_removal_listener(
+  RemovalListener<TKey, TValue> listener) {
+  removalListener_ = std::move(listener);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::set_promotion_throttle(
+  const PromotionThrottle& throttle) {
+  throttleFraction_ = std::clamp(throttle.mruFraction, 0.0, 1.0);
+  throttleWindowMs_ = static_cast<uint32_t>(std::clamp<int64_t>(throttle.window.count(), 0, INT32_MAX));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+int LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::size_exact() {
+  std::unique_lock<ListMutex> lock = lockList();
+  return current_size_;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::clear() noexcept {
+  // callers must not run concurrently, the maintenance thread may still be evicting.
+  std::unique_lock<std::mutex> cycleLock(maintenanceCycleMutex_);
+
+  reset();
 }
 
-template <class TKey, class TValue, class THash>
-void LRUCache<TKey, TValue, THash>::clear() noexcept {
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TIndex, class TStats>
+void LRUCache<TKey, TValue, THash, TAllocator, TWeigher, TIndex, TStats>::reset() noexcept {
   hash_map_.clear();
 
   head_.next_ = &tail_;
   tail_.prev_ = &head_;
+  // buffered nodes refer to the pool memory, drop them before the pool.
+  readBuffer_.clear();
+  timerWheel_.clear();
+  expiring_ = false;
+  nodePool_.clear();
   current_size_ = 0;
+  weight_ = 0;
+  size_.reset();
 }
 }  // namespace LRUC
@@ -23,10 +23,14 @@
  */
 #pragma once
 
+#include <arc_cache.h>
 #include <clock_lru_cache.h>
 #include <clock_lru_cache_hash.h>
 #include <lrucache_tbb.h>
+#include <s3fifo_cache.h>
+#include <sampled_lru_cache.h>
 #include <scale-lrucache.h>
+#include <tinylfu_cache.h>
 
 namespace AtsPluginUtils {
 inline namespace lrucache_v1 {
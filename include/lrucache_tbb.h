@@ -36,31 +36,57 @@ constexpr uint64_t twang_mix64(uint64_t key) noexcept {
  */
 template <>
 struct tbb_hash_compare<IpAddress> {
-  static std::size_t hash(const IpAddress& k) {
-    size_t seed = twang_mix64(k.base.sa_family);
+  // lookups take an IPv4 address (u_int32_t, network order) or an in6_addr as well.
+  using is_transparent = void;
 
+  static std::size_t hash(const IpAddress& k) {
     switch (k.base.sa_family) {
       case AF_INET:
-        boost::hash_combine(seed, twang_mix64(k.v4.sin_addr.s_addr));
-        break;
-      case AF_INET6: {
-        // The IPv6 address is 16 bytes long.
-        // Combine it in blocks of sizeof(size_t) bytes each.
-        static_assert(sizeof(struct in6_addr) % sizeof(size_t) == 0);
-
-        const size_t* p = reinterpret_cast<const size_t*>(k.v6.sin6_addr.s6_addr);
-        constexpr auto in6_addr_size = sizeof(struct in6_addr);
-
-        for (auto amtHashed = 0UL; amtHashed < in6_addr_size; amtHashed += sizeof(*p), ++p) {
-          boost::hash_combine(seed, twang_mix64(*p));
-        }
-      }
+        return hash(k.v4.sin_addr.s_addr);
+      case AF_INET6:
+        return hash(k.v6.sin6_addr);
+      default:
+        return twang_mix64(k.base.sa_family);
+    }
+  }
+
+  static std::size_t hash(u_int32_t k) {
+    size_t seed = twang_mix64(AF_INET);
+    boost::hash_combine(seed, twang_mix64(k));
+
+    return seed;
+  }
+
+  static std::size_t hash(const in6_addr& k) {
+    size_t seed = twang_mix64(AF_INET6);
+
+    // The IPv6 address is 16 bytes long.
+    // Combine it in blocks of sizeof(size_t) bytes each.
+    static_assert(sizeof(struct in6_addr) % sizeof(size_t) == 0);
+
+    const size_t* p = reinterpret_cast<const size_t*>(k.s6_addr);
+    constexpr auto in6_addr_size = sizeof(struct in6_addr);
+
+    for (auto amtHashed = 0UL; amtHashed < in6_addr_size; amtHashed += sizeof(*p), ++p) {
+      boost::hash_combine(seed, twang_mix64(*p));
     }
 
     return seed;
   }
 
   static bool equal(const IpAddress& k1, const IpAddress& k2) { return k1 == k2; }
+
+  static bool equal(const IpAddress& k1, u_int32_t k2) {
+    return k1.base.sa_family == AF_INET && k1.v4.sin_addr.s_addr == k2;
+  }
+
+  static bool equal(u_int32_t k1, const IpAddress& k2) { return equal(k2, k1); }
+
+  static bool equal(const IpAddress& k1, const in6_addr& k2) {
+    return k1.base.sa_family == AF_INET6 && memcmp(&k1.v6.sin6_addr, &k2, sizeof(k2)) == 0;
+  }
+
+  static bool equal(const in6_addr& k1, const IpAddress& k2) { return equal(k2, k1); }
 };
 
 }  // namespace tbb
@@ -0,0 +1,728 @@
+/**
+ * @author shchang
+ */
+
+#pragma once
+
+#include "cache_line.h"
+#include "transparent_hash.h"
+
+#include <tbb/spin_rw_mutex.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace LRUC {
+
+/**
+ * OpenHashMap is a concurrent hash map with the accessor interface of tbb::concurrent_hash_map
+ * used by LRUCache: find/insert/emplace acquire an element lock (shared for const_accessor,
+ * exclusive for accessor) which is held until the accessor is released or erase()d.
+ *
+ * The index is split into SegmentCount segments, each a linear-probing open-addressing table
+ * whose slots hold the element hash and the element pointer inline, thus a probe compares hashes
+ * without dereferencing any element. Deletion shifts the following entries back (no tombstones),
+ * tables only grow.
+ *
+ * Reads are optimistic: a lookup probes the table without locking and validates the probe with
+ * the segment version (a seqlock bumped by every writer), then locks the element found and
+ * verifies it still holds the key. Writers (insert of a new key, erase) serialize on the segment
+ * mutex.
+ *
+ * Element and table memory is type-stable: an erased element is recycled by the segment for the
+ * next insert and a replaced table is retired, both are released only by clear() or the map
+ * destruction. Thus a reader racing with erase or growth never touches freed memory, it only
+ * fails the verification and retries.
+ *
+ * THashCompare has the tbb::tbb_hash_compare interface, hash() and equal(); if it is transparent
+ * (see IsTransparent) find() takes key-like types as well.
+ *
+ * Lock order: element lock, then segment mutex; the segment mutex is never held while waiting
+ * for the lock of a live element.
+ */
+template <typename TKey, typename TValue, typename THashCompare, typename TAllocator>
+class OpenHashMap final {
+ public:
+  using key_type = TKey;
+  using mapped_type = TValue;
+  using value_type = std::pair<const TKey, TValue>;
+
+ private:
+  using Mutex = tbb::spin_rw_mutex;
+
+  struct Element {
+    Mutex mutex_{};
+    // hash_/live_ are guarded by mutex_, the value is constructed while live_ is set.
+    uint64_t hash_{0};
+    bool live_{false};
+    Element* nextFree_{nullptr};
+    alignas(value_type) unsigned char storage_[sizeof(value_type)];
+
+    value_type* value() {
+      return std::launder(reinterpret_cast<value_type*>(storage_));
+    }
+  };
+
+  struct Slot {
+    // EmptyTag, or the element hash with TagBit set.
+    std::atomic<uint64_t> tag_;
+    std::atomic<Element*> element_;
+  };
+
+  struct Table {
+    size_t mask_;
+    Slot* slots_;
+  };
+
+  struct alignas(CacheLineSize) Segment {
+    std::mutex mutex_{};
+    // odd while a writer modifies the table.
+    std::atomic<uint64_t> version_{0};
+    std::atomic<Table*> table_{nullptr};
+    size_t size_{0};
+    Element* freeList_{nullptr};
+    std::vector<Element*> chunks_{};
+    std::vector<Table*> retired_{};
+  };
+
+  using AllocatorTraits = std::allocator_traits<TAllocator>;
+  using ElementAllocator = typename AllocatorTraits::template rebind_alloc<Element>;
+  using ElementAllocatorTraits = std::allocator_traits<ElementAllocator>;
+  using SlotAllocator = typename AllocatorTraits::template rebind_alloc<Slot>;
+  using TableAllocator = typename AllocatorTraits::template rebind_alloc<Table>;
+
+  static constexpr size_t SegmentBits = 6;
+  static constexpr size_t SegmentCount = size_t{1} << SegmentBits;
+  static constexpr size_t MinSlots = 8;
+  static constexpr size_t ChunkSize = 64;
+  static constexpr uint64_t EmptyTag = 0;
+  static constexpr uint64_t TagBit = uint64_t{1} << 63;
+
+ public:
+  /**
+   * const_accessor holds a shared element lock, accessor an exclusive one.
+   */
+  class const_accessor {
+   public:
+    const_accessor() : lock_(), element_(nullptr) {}
+
+    ~const_accessor() {
+      release();
+    }
+
+    const_accessor(const const_accessor&) = delete;
+    const_accessor& operator=(const const_accessor&) = delete;
+
+    bool empty() const {
+      return element_ == nullptr;
+    }
+
+    void release() {
+      if (element_ != nullptr) {
+        lock_.release();
+        element_ = nullptr;
+      }
+    }
+
+    const value_type& operator*() const {
+      return *element_->value();
+    }
+
+    const value_type* operator->() const {
+      return element_->value();
+    }
+
+   protected:
+    friend class OpenHashMap;
+
+    typename Mutex::scoped_lock lock_;
+    Element* element_;
+  };
+
+  class accessor : public const_accessor {
+   public:
+    value_type& operator*() const {
+      return *this->element_->value();
+    }
+
+    value_type* operator->() const {
+      return this->element_->value();
+    }
+  };
+
+  /**
+   * bucketCount: expected number of elements, tables are sized to hold it without growing.
+   *
+   */
+  explicit OpenHashMap(size_t bucketCount = 0, const TAllocator& allocator = TAllocator());
+
+  ~OpenHashMap() noexcept;
+
+  OpenHashMap(const OpenHashMap&) = delete;
+  OpenHashMap& operator=(const OpenHashMap&) = delete;
+
+  bool find(const_accessor& result, const TKey& key) {
+    return lookup(result, key, false);
+  }
+
+  bool find(accessor& result, const TKey& key) {
+    return lookup(result, key, true);
+  }
+
+  /**
+   * find taking a key-like type, enabled if THashCompare is transparent (see IsTransparent).
+   *
+   */
+  template <typename TKeyLike, typename = EnableIfKeyLike<TKeyLike, THashCompare>>
+  bool find(const_accessor& result, const TKeyLike& key) {
+    return lookup(result, key, false);
+  }
+
+  template <typename TKeyLike, typename = EnableIfKeyLike<TKeyLike, THashCompare>>
+  bool find(accessor& result, const TKeyLike& key) {
+    return lookup(result, key, true);
+  }
+
+  /**
+   * insert acquires an exclusive lock on the element of key, a new element holds a default
+   * constructed value.
+   * Returns true if the element is inserted.
+   *
+   */
+  bool insert(accessor& result, const TKey& key) {
+    return lookupOrInsert(result, key, [&key](void* storage) {
+      ::new (storage) value_type(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple());
+    });
+  }
+
+  /**
+   * emplace constructs value_type from args if the key is absent.
+   * The piecewise form with a single key argument looks up the key argument (as is if THashCompare
+   * is transparent, e.g. a HashedKey) and constructs the element in place; any other form
+   * constructs value_type on the stack first to learn its key.
+   * Returns true if the element is inserted.
+   *
+   */
+  template <typename TKeyArg, typename... TValueArgs>
+  bool emplace(accessor& result,
+               std::piecewise_construct_t,
+               std::tuple<TKeyArg> keyArgs,
+               std::tuple<TValueArgs...> valueArgs);
+
+  template <typename... TArgs>
+  bool emplace(accessor& result, TArgs&&... args);
+
+  /**
+   * erase removes the element held by result and releases it.
+   *
+   */
+  bool erase(accessor& result);
+
+  /**
+   * Not thread-safe.
+   *
+   */
+  void clear() noexcept;
+
+  size_t size() const;
+
+ private:
+  static uint64_t mix(size_t hash) {
+    // fibonacci hashing, spreads sequential hashes over the segment and slot bits.
+    const uint64_t mixed = static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull;
+    return mixed ^ (mixed >> 29);
+  }
+
+  Segment& segmentFor(uint64_t hash) {
+    return segments_[hash >> (64 - SegmentBits)];
+  }
+
+  /**
+   * Probe table for key under the segment mutex, returns the element or nullptr.
+   *
+   */
+  template <typename TKeyLike>
+  Element* probeLocked(const Table& table, uint64_t hash, const TKeyLike& key) const;
+
+  /**
+   * Probe table without locking, returns the first element with hash, it might hold another key
+   * on a full hash collision. The result is only valid if the segment version did not change.
+   *
+   */
+  static Element* probeOptimistic(const Table& table, uint64_t hash);
+
+  template <typename TKeyLike>
+  bool lookup(const_accessor& result, const TKeyLike& key, bool write);
+
+  template <typename TKeyLike, typename TConstruct>
+  bool lookupOrInsert(accessor& result, const TKeyLike& key, TConstruct&& construct);
+
+  /**
+   * Link element of hash into the segment table, growing it first if needed.
+   * Caller holds the segment mutex.
+   *
+   */
+  void link(Segment& segment, Element* element, uint64_t hash);
+
+  /**
+   * Remove element from the segment table, the entries after it are shifted back.
+   * Caller holds the segment mutex.
+   *
+   */
+  void unlink(Segment& segment, Element* element);
+
+  Element* allocateElement(Segment& segment);
+
+  Table* allocateTable(size_t slotCount);
+  void deallocateTable(Table* table) noexcept;
+
+  static void beginWrite(Segment& segment) {
+    segment.version_.store(segment.version_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  static void endWrite(Segment& segment) {
+    segment.version_.store(segment.version_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  TAllocator allocator_;
+  THashCompare hashCompare_;
+  size_t initialSlots_;
+  std::unique_ptr<Segment[]> segments_;
+};
+
+template <typename TKey, typename TValue, typename THashCompare, typename TAllocator>
+OpenHashMap<TKey, TValue, THashCompare, TAllocator>::OpenHashMap(size_t bucketCount, const TAllocator& allocator)
+  : allocator_(allocator), hashCompare_(), initialSlots_([bucketCount] {
+      // load factor at most 3/4.
+      const size_t perSegment = (bucketCount / SegmentCount + 1) * 4 / 3 + 1;
+      size_t slots = MinSlots;
+      while (slots < perSegment) {
+        slots <<= 1;
+      }
+      return slots;
+    }()),
+    segments_(std::make_unique<Segment[]>(SegmentCount)) {
+  for (size_t i = 0; i < SegmentCount; i++) {
+    segments_[i].table_.store(allocateTable(initialSlots_), std::memory_order_relaxed);
+  }
+}
+
+template <typename TKey, typename TValue, typename THashCompare, typename TAllocator>
+OpenHashMap<TKey, TValue, THashCompare, TAllocator>::~OpenHashMap() noexcept {
+  clear();
+
+  for (size_t i = 0; i < SegmentCount; i++) {
+    deallocateTable(segments_[i].table_.load(std::memory_order_relaxed));
+  }
+}
+
+template <typename TKey, typename TValue, typename THashCompare, typename TAllocator>
+typename OpenHashMap<TKey, TValue, THashCompare, TAllocator>::Table*
+  OpenHashMap<TKey, TValue, THashCompare, TAllocator>::allocateTable(size_t slotCount) {
+  TableAllocator tableAllocator(allocator_);
+  SlotAllocator slotAllocator(allocator_);
+
+  Table* table = std::allocator_traits<TableAllocator>::allocate(tableAllocator, 1);
+  Slot* slots{nullptr};
+  try {
+    slots = std::allocator_traits<SlotAllocator>::allocate(slotAllocator, slotCount);
+  } catch (...) {
+    std::allocator_traits<TableAllocator>::deallocate(tableAllocator, table, 1);
+    throw;
+  }
+
+  for (size_t i = 0; i < slotCount; i++) {
+    ::new (static_cast<void*>(&slots[i])) Slot{{EmptyTag}, {nullptr}};
+  }
+
+  ::new (static_cast<void*>(table)) Table{slotCount - 1, slots};
+
+  return table;
+}
+
+template <typename TKey, typename TValue, typename THashCompare, typename TAllocator>
+void OpenHashMap<TKey, TValue, THashCompare, TAllocator>::deallocateTable(Table* table) noexcept {
+  TableAllocator tableAllocator(allocator_);
+  SlotAllocator slotAllocator(allocator_);
+
+  // Slot and Table are trivially destructible.
+  std::allocator_traits<SlotAllocator>::deallocate(slotAllocator, table->slots_, table->mask_ + 1);
+  std::allocator_traits<TableAllocator>::deallocate(tableAllocator, table, 1);
+}
+
+template <typename TKey, typename TValue, typename THashCompare, typename TAllocator>
+typename OpenHashMap<TKey, TValue, THashCompare, TAllocator>::Element*
+  OpenHashMap<TKey, TValue, THashCompare, TAllocator>::allocateElement(Segment& segment) {
+  if (segment.freeList_ == nullptr) {
+    ElementAllocator elementAllocator(allocator_);
+
+    // chunk is reserved first, thus push_back does not throw after the allocation.
+    segment.chunks_.reserve(segment.chunks_.size() + 1);
+    Element* chunk = ElementAllocatorTraits::allocate(elementAllocator, ChunkSize);
+    segment.chunks_.push_back(chunk);
+
+    for (size_t i = 0; i < ChunkSize; i++) {
+      ElementAllocatorTraits::construct(elementAllocator, &chunk[i]);
+      chunk[i].nextFree_ = segment.freeList_;
+      segment.freeList_ = &chunk[i];
+    }
+  }
+
+  Element* element = segment.freeList_;
+  segment.freeList_ = element->nextFree_;
+
+  return element;
+}
+
+template <typename TKey, typename TValue, typename THashCompare, typename TAllocator>
+template <typename TKeyLike>
+typename OpenHashMap<TKey, TValue, THashCompare, TAllocator>::Element*
+  OpenHashMap<TKey, TValue, THashCompare, TAllocator>::probeLocked(const Table& table,
+                                                                  uint64_t hash,
+                                                                  const TKeyLike& key) const {
+  const uint64_t tag = hash | TagBit;
+
+  for (size_t i = hash & table.mask_;; i = (i + 1) & table.mask_) {
+    const uint64_t slotTag = table.slots_[i].tag_.load(std::memory_order_relaxed);
+    if (slotTag == EmptyTag) {
+      return nullptr;
+    }
+
+    // elements linked in the table are live, their keys are not modified while the mutex is held.
+    Element* element = table.slots_[i].element_.load(std::memory_order_relaxed);
+    if (slotTag == tag && hashCompare_.equal(element->value()->first, key)) {
+      return element;
+    }
+  }
+}
+
+template <typename TKey, typename TValue, typename THashCompare, typename TAllocator>
+typename OpenHashMap<TKey, TValue, THashCompare, TAllocator>::Element*
+  OpenHashMap<TKey, TValue, THashCompare, TAllocator>::probeOptimistic(const Table& table, uint64_t hash) {
+  const uint64_t tag = hash | TagBit;
+  size_t i = hash & table.mask_;
+
+  // bounded, concurrent writers might keep the probe from seeing an empty slot; a torn probe fails
+  // the version check anyway.
+  for (size_t probed = 0; probed <= table.mask_; probed++, i = (i + 1) & table.mask_) {
+    const uint64_t slotTag = table.slots_[i].tag_.load(std::memory_order_relaxed);
+    if (slotTag == EmptyTag) {
+      return nullptr;
+    }
+
+    if (slotTag == tag) {
+      return table.slots_[i].element_.load(std::memory_order_relaxed);
+    }
+  }
+
+  return nullptr;
+}
+
+template <typename TKey, typename TValue, typename THashCompare, typename TAllocator>
+template <typename TKeyLike>
+bool OpenHashMap<TKey, TValue, THashCompare, TAllocator>::lookup(const_accessor& result,
+                                                                 const TKeyLike& key,
+                                                                 bool write) {
+  result.release();
+
+  const uint64_t hash = mix(hashCompare_.hash(key));
+  Segment& segment = segmentFor(hash);
+
+  while (true) {
+    const uint64_t version = segment.version_.load(std::memory_order_acquire);
+    if (version & 1) {
+      // a writer is modifying the table.
+      std::this_thread::yield();
+      continue;
+    }
+
+    Element* element = probeOptimistic(*segment.table_.load(std::memory_order_acquire), hash);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (segment.version_.load(std::memory_order_relaxed) != version) {
+      continue;
+    }
+
+    if (element == nullptr) {
+      return false;
+    }
+
+    // element memory is never freed while the map exists, it is safe to lock a recycled one.
+    result.lock_.acquire(element->mutex_, write);
+
+    if (element->live_ && element->hash_ == hash) {
+      if (hashCompare_.equal(element->value()->first, key)) {
+        result.element_ = element;
+        return true;
+      }
+
+      // full hash collision, the optimistic probe stops at the first match; probe by key instead.
+      result.lock_.release();
+
+      {
+        std::unique_lock<std::mutex> lock(segment.mutex_);
+        element = probeLocked(*segment.table_.load(std::memory_order_relaxed), hash, key);
+      }
+
+      if (element == nullptr) {
+        return false;
+      }
+
+      result.lock_.acquire(element->mutex_, write);
+      if (element->live_ && element->hash_ == hash && hashCompare_.equal(element->value()->first, key)) {
+        result.element_ = element;
+        return true;
+      }
+    }
+
+    // erased (and maybe recycled) between the probe and the lock.
+    result.lock_.release();
+  }
+}
+
+template <typename TKey, typename TValue, typename THashCompare, typename TAllocator>
+template <typename TKeyLike, typename TConstruct>
+bool OpenHashMap<TKey, TValue, THashCompare, TAllocator>::lookupOrInsert(accessor& result,
+                                                                        const TKeyLike& key,
+                                                                        TConstruct&& construct) {
+  result.release();
+
+  const uint64_t hash = mix(hashCompare_.hash(key));
+  Segment& segment = segmentFor(hash);
+
+  while (true) {
+    Element* element{nullptr};
+
+    {
+      std::unique_lock<std::mutex> lock(segment.mutex_);
+      element = probeLocked(*segment.table_.load(std::memory_order_relaxed), hash, key);
+
+      if (element == nullptr) {
+        element = allocateElement(segment);
+
+        // a free element is only locked by readers failing its verification.
+        result.lock_.acquire(element->mutex_, true);
+        bool constructed = false;
+        try {
+          construct(static_cast<void*>(element->storage_));
+          constructed = true;
+          link(segment, element, hash);
+        } catch (...) {
+          if (constructed) {
+            element->value()->~value_type();
+          }
+          result.lock_.release();
+          element->nextFree_ = segment.freeList_;
+          segment.freeList_ = element;
+          throw;
+        }
+
+        result.element_ = element;
+        return true;
+      }
+    }
+
+    // the element lock is not taken under the segment mutex, see the lock order.
+    result.lock_.acquire(element->mutex_, true);
+    if (element->live_ && element->hash_ == hash && hashCompare_.equal(element->value()->first, key)) {
+      result.element_ = element;
+      return false;
+    }
+
+    result.lock_.release();
+  }
+}
+
+template <typename TKey, typename TValue, typename THashCompare, typename TAllocator>
+template <typename TKeyArg, typename... TValueArgs>
+bool OpenHashMap<TKey, TValue, THashCompare, TAllocator>::emplace(accessor& result,
+                                                                 std::piecewise_construct_t,
+                                                                 std::tuple<TKeyArg> keyArgs,
+                                                                 std::tuple<TValueArgs...> valueArgs) {
+  using TKeyLookup = std::conditional_t<IsTransparent<THashCompare>::value, std::decay_t<TKeyArg>, TKey>;
+  const TKeyLookup& key = std::get<0>(keyArgs);
+
+  return lookupOrInsert(result, key, [&keyArgs, &valueArgs](void* storage) {
+    ::new (storage) value_type(std::piecewise_construct, std::move(keyArgs), std::move(valueArgs));
+  });
+}
+
+template <typename TKey, typename TValue, typename THashCompare, typename TAllocator>
+template <typename... TArgs>
+bool OpenHashMap<TKey, TValue, THashCompare, TAllocator>::emplace(accessor& result, TArgs&&... args) {
+  // the key is only known once value_type is constructed.
+  std::optional<value_type> constructed;
+  constructed.emplace(std::forward<TArgs>(args)...);
+
+  return lookupOrInsert(result, constructed->first, [&constructed](void* storage) {
+    ::new (storage) value_type(constructed->first, std::move(constructed->second));
+  });
+}
+
+template <typename TKey, typename TValue, typename THashCompare, typename TAllocator>
+void OpenHashMap<TKey, TValue, THashCompare, TAllocator>::link(Segment& segment, Element* element, uint64_t hash) {
+  Table* table = segment.table_.load(std::memory_order_relaxed);
+
+  if ((segment.size_ + 1) * 4 > (table->mask_ + 1) * 3) {
+    // grow into a new table; readers of the old one fail the version check and retry.
+    Table* grown = allocateTable((table->mask_ + 1) * 2);
+    segment.retired_.reserve(segment.retired_.size() + 1);
+
+    for (size_t i = 0; i <= table->mask_; i++) {
+      const uint64_t tag = table->slots_[i].tag_.load(std::memory_order_relaxed);
+      if (tag == EmptyTag) {
+        continue;
+      }
+
+      size_t j = tag & grown->mask_;
+      while (grown->slots_[j].tag_.load(std::memory_order_relaxed) != EmptyTag) {
+        j = (j + 1) & grown->mask_;
+      }
+      grown->slots_[j].tag_.store(tag, std::memory_order_relaxed);
+      grown->slots_[j].element_.store(table->slots_[i].element_.load(std::memory_order_relaxed),
+                                      std::memory_order_relaxed);
+    }
+
+    beginWrite(segment);
+    segment.table_.store(grown, std::memory_order_release);
+    endWrite(segment);
+
+    segment.retired_.push_back(table);
+    table = grown;
+  }
+
+  size_t i = hash & table->mask_;
+  while (table->slots_[i].tag_.load(std::memory_order_relaxed) != EmptyTag) {
+    i = (i + 1) & table->mask_;
+  }
+
+  element->hash_ = hash;
+  element->live_ = true;
+
+  beginWrite(segment);
+  table->slots_[i].element_.store(element, std::memory_order_relaxed);
+  table->slots_[i].tag_.store(hash | TagBit, std::memory_order_relaxed);
+  endWrite(segment);
+
+  segment.size_++;
+}
+
+template <typename TKey, typename TValue, typename THashCompare, typename TAllocator>
+void OpenHashMap<TKey, TValue, THashCompare, TAllocator>::unlink(Segment& segment, Element* element) {
+  Table* table = segment.table_.load(std::memory_order_relaxed);
+
+  size_t hole = element->hash_ & table->mask_;
+  while (table->slots_[hole].element_.load(std::memory_order_relaxed) != element) {
+    hole = (hole + 1) & table->mask_;
+  }
+
+  beginWrite(segment);
+
+  // backward shift: move each following entry into the hole unless its home slot lies after it.
+  for (size_t i = (hole + 1) & table->mask_;; i = (i + 1) & table->mask_) {
+    const uint64_t tag = table->slots_[i].tag_.load(std::memory_order_relaxed);
+    if (tag == EmptyTag) {
+      break;
+    }
+
+    const size_t home = tag & table->mask_;
+    const bool stays = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+    if (stays) {
+      continue;
+    }
+
+    table->slots_[hole].tag_.store(tag, std::memory_order_relaxed);
+    table->slots_[hole].element_.store(table->slots_[i].element_.load(std::memory_order_relaxed),
+                                       std::memory_order_relaxed);
+    hole = i;
+  }
+
+  table->slots_[hole].tag_.store(EmptyTag, std::memory_order_relaxed);
+  table->slots_[hole].element_.store(nullptr, std::memory_order_relaxed);
+
+  endWrite(segment);
+
+  segment.size_--;
+}
+
+template <typename TKey, typename TValue, typename THashCompare, typename TAllocator>
+bool OpenHashMap<TKey, TValue, THashCompare, TAllocator>::erase(accessor& result) {
+  Element* element = result.element_;
+  if (element == nullptr) {
+    return false;
+  }
+
+  Segment& segment = segmentFor(element->hash_);
+
+  {
+    std::unique_lock<std::mutex> lock(segment.mutex_);
+    unlink(segment, element);
+
+    // readers holding a stale pointer block on the element lock, then see it is no longer live.
+    element->value()->~value_type();
+    element->live_ = false;
+    element->nextFree_ = segment.freeList_;
+    segment.freeList_ = element;
+  }
+
+  result.release();
+
+  return true;
+}
+
+template <typename TKey, typename TValue, typename THashCompare, typename TAllocator>
+void OpenHashMap<TKey, TValue, THashCompare, TAllocator>::clear() noexcept {
+  ElementAllocator elementAllocator(allocator_);
+
+  for (size_t s = 0; s < SegmentCount; s++) {
+    Segment& segment = segments_[s];
+
+    for (Element* chunk : segment.chunks_) {
+      for (size_t i = 0; i < ChunkSize; i++) {
+        if (chunk[i].live_) {
+          chunk[i].value()->~value_type();
+        }
+        ElementAllocatorTraits::destroy(elementAllocator, &chunk[i]);
+      }
+      ElementAllocatorTraits::deallocate(elementAllocator, chunk, ChunkSize);
+    }
+
+    for (Table* table : segment.retired_) {
+      deallocateTable(table);
+    }
+
+    Table* table = segment.table_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i <= table->mask_; i++) {
+      table->slots_[i].tag_.store(EmptyTag, std::memory_order_relaxed);
+      table->slots_[i].element_.store(nullptr, std::memory_order_relaxed);
+    }
+
+    segment.chunks_.clear();
+    segment.retired_.clear();
+    segment.freeList_ = nullptr;
+    segment.size_ = 0;
+  }
+}
+
+template <typename TKey, typename TValue, typename THashCompare, typename TAllocator>
+size_t OpenHashMap<TKey, TValue, THashCompare, TAllocator>::size() const {
+  size_t size = 0;
+
+  for (size_t i = 0; i < SegmentCount; i++) {
+    std::unique_lock<std::mutex> lock(segments_[i].mutex_);
+    size += segments_[i].size_;
+  }
+
+  return size;
+}
+
+}  // namespace LRUC
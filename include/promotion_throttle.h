@@ -0,0 +1,29 @@
+/**
+ * @author shchang
+ */
+
+#pragma once
+
+#include <chrono>
+
+namespace LRUC {
+
+/**
+ * PromotionThrottle bounds how often a hit relinks its node in the LRU list, see
+ * LRUCache::set_promotion_throttle. A node is stamped when it is appended at the most-recently
+ * used end (on insert and on promotion), a hit on a node recent enough already is not relinked:
+ *
+ * mruFraction: the node is among the mruFraction (0 to 1) most-recently used of the list,
+ *   estimated by the count of appends since its stamp, an upper bound of the nodes ahead of it.
+ * window: the node was appended less than window ago, in milliseconds; costs a clock read per hit.
+ *
+ * A zero bound is disabled, the default throttles nothing. A throttled hit counts as a skipped
+ * promotion in stats(). The LRU order is then approximate within the throttled part of the list,
+ * the least-recently used end is still evicted first.
+ */
+struct PromotionThrottle final {
+  double mruFraction{0.0};
+  std::chrono::milliseconds window{0};
+};
+
+}  // namespace LRUC
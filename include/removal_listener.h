@@ -0,0 +1,45 @@
+/**
+ * @author shchang
+ */
+
+#pragma once
+
+#include <functional>
+#include <vector>
+
+namespace LRUC {
+
+/**
+ * RemovalCause tells why an entry left the cache.
+ *
+ * Size: evicted to keep the capacity (including an entry heavier than the capacity).
+ * Expired: its TTL passed.
+ * Explicit: removed by erase().
+ * Replaced: its value was overwritten by insert_or_assign(), the notification holds the old value.
+ */
+enum class RemovalCause { Size, Expired, Explicit, Replaced };
+
+/**
+ * RemovalNotification holds a removed key, its value (moved out of the cache) and the cause.
+ */
+template <typename TKey, typename TValue>
+struct RemovalNotification final {
+  TKey key;
+  TValue value;
+  RemovalCause cause;
+};
+
+/**
+ * RemovalListener receives the entries removed by one cache operation as a batch, thus an insert
+ * evicting several entries makes one call.
+ *
+ * The listener is invoked by the thread running the operation (or by the maintenance thread)
+ * after all cache locks are released, thus it may access the cache; the notifications may be
+ * moved out of the batch. The listener must not throw.
+ *
+ * Entries dropped by clear() or by the cache destruction are not notified.
+ */
+template <typename TKey, typename TValue>
+using RemovalListener = std::function<void(std::vector<RemovalNotification<TKey, TValue>>&)>;
+
+}  // namespace LRUC
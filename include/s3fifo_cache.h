@@ -0,0 +1,535 @@
+/**
+ * @author shchang
+ */
+
+#pragma once
+
+#include "cache_common.h"
+#include "weigher.h"
+
+#include <tbb/concurrent_hash_map.h>
+#include <tbb/concurrent_queue.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace LRUC {
+
+/**
+ * S3FIFOCache is a thread-safe cache with S3-FIFO eviction, built on FIFO queues only.
+ *
+ * New keys enter the small FIFO (SmallPercent of the capacity), keys found in the ghost FIFO
+ * enter the main FIFO directly. Each entry has a 2-bit frequency counter, a hit increments it
+ * with a relaxed atomic store under the shared element lock of the hash map, thus a hit never
+ * takes a cache-wide lock nor relinks a list.
+ *
+ * Eviction pops the small FIFO while it holds at least its share: an entry hit while in small
+ * moves to the main FIFO, otherwise it is evicted and its key is remembered as ghost. Otherwise
+ * eviction pops the main FIFO: an entry with a non-zero counter is pushed back with the counter
+ * decremented, otherwise it is evicted.
+ *
+ * The ghost FIFO is a table of key hash tags stamped with a ghost clock, a ghost expires once
+ * main capacity more ghosts were added after it, as if it had left a FIFO of that length. A
+ * colliding ghost overwrites the older one, ghosts are only an admission hint.
+ *
+ * The FIFOs are tbb::concurrent_queue of entry nodes, inserts push without a lock; eviction is
+ * serialized by one mutex, taken only by inserts beyond the capacity. The FIFOs own the nodes,
+ * an evicted node is unlinked from the hash map before it is freed.
+ *
+ * find() takes S3FIFOCache::ConstAccessor as argument which stores a copy of the found value.
+ *
+ * contains() and peek() look a key up without incrementing its frequency counter.
+ *
+ * insert() takes key and value to insert into the cache, rvalue arguments are moved.
+ *
+ * erase() takes key to remove the entry from the cache, its node is marked erased and freed
+ * once popped from its FIFO. Once the erased nodes exceed ReclaimPercent of the capacity, erase()
+ * sweeps them out of both FIFOs, thus an insert/erase churn under the capacity does not pile up
+ * nodes.
+ */
+template <typename TKey, typename TValue, typename THash = tbb::tbb_hash_compare<TKey>>
+class S3FIFOCache final {
+ public:
+  static constexpr int SmallPercent = 10;
+  static constexpr uint8_t MaxFrequency = 3;
+  static constexpr int ReclaimPercent = 50;
+
+ private:
+  struct Node final {
+    template <typename TKeyArg, typename TValueArg>
+    Node(TKeyArg&& key, TValueArg&& value)
+      : key_(std::forward<TKeyArg>(key)), value_(std::forward<TValueArg>(value)), freq_(0), erased_(false) {}
+
+    const TKey key_;
+    TValue value_;
+    std::atomic<uint8_t> freq_;
+    // set by erase() before the node is unlinked from the hash map.
+    std::atomic<bool> erased_;
+  };
+
+  using HashMap = tbb::concurrent_hash_map<TKey, Node*, THash>;
+  using HashMapConstAccessor = typename HashMap::const_accessor;
+  using HashMapAccessor = typename HashMap::accessor;
+
+ public:
+  using ConstAccessor = CopyAccessor<TValue, S3FIFOCache>;
+
+ private:
+  HashMap hash_map_;
+  tbb::concurrent_queue<Node*> small_;
+  tbb::concurrent_queue<Node*> main_;
+  // hash tag in the upper, ghost clock in the lower 32 bits, 0 if empty.
+  std::vector<std::atomic<uint64_t>> ghosts_;
+  std::atomic<uint32_t> ghostClock_;
+  std::mutex evictMutex_;
+  // nodes in each FIFO, erased nodes included until popped.
+  std::atomic<int> smallSize_;
+  std::atomic<int> mainSize_;
+  // erased nodes not popped yet.
+  std::atomic<int> erasedSize_;
+  const int capacity_;
+  const int smallCapacity_;
+  const int reclaimThreshold_;
+
+ private:
+  template <typename TKeyArg, typename TValueArg>
+  bool insertImpl(TKeyArg&& key, TValueArg&& value);
+
+  /**
+   * Evict until the entries fit the capacity.
+   *
+   */
+  void evict();
+
+  /**
+   * Pop the small FIFO: move the first live node to main if it was hit, otherwise evict it to
+   * the ghost FIFO. Return false if the FIFO has no live node.
+   * Caller holds evictMutex_.
+   *
+   */
+  bool evictSmall();
+
+  /**
+   * Pop the main FIFO until a node without hits is evicted, hit nodes are pushed back.
+   * Return false if the FIFO has no live node.
+   * Caller holds evictMutex_.
+   *
+   */
+  bool evictMain();
+
+  /**
+   * Unlink node from the hash map, false if erase() did already.
+   * Caller holds evictMutex_.
+   *
+   */
+  bool unlink(Node* node);
+
+  /**
+   * Pop every node queued in fifo when called, free the erased ones and push the others back in
+   * order, their frequency counters untouched.
+   * Caller holds evictMutex_.
+   *
+   */
+  void sweep(tbb::concurrent_queue<Node*>& fifo, std::atomic<int>& fifoSize);
+
+  /**
+   * Free a popped node unlinked by erase().
+   * Caller holds evictMutex_.
+   *
+   */
+  void reclaim(Node* node);
+
+  /**
+   * Remember the key of an evicted small node.
+   * Caller holds evictMutex_.
+   *
+   */
+  void pushGhost(const TKey& key);
+
+  /**
+   * Consume the ghost of key, return true if it did not expire yet.
+   *
+   */
+  bool popGhost(const TKey& key);
+
+ public:
+  /**
+   * size: capacity in entries, the small FIFO holds SmallPercent of it (at least 1).
+   *
+   */
+  explicit S3FIFOCache(int size);
+
+  ~S3FIFOCache() noexcept {
+    clear();
+  }
+
+  S3FIFOCache(const S3FIFOCache&) = delete;
+  S3FIFOCache& operator=(const S3FIFOCache&) = delete;
+
+  /**
+   * find copies the value of key into caccessor and counts the hit, without any cache-wide lock.
+   * Return true if key is found.
+   *
+   */
+  bool find(ConstAccessor& caccessor, const TKey& key);
+
+  /**
+   * contains returns true if key is found, peek copies its value into caccessor like find.
+   * Neither counts the hit.
+   *
+   */
+  bool contains(const TKey& key);
+  bool peek(ConstAccessor& caccessor, const TKey& key);
+
+  /**
+   * insert inserts key/value if key is absent, into the main FIFO if key is a ghost, otherwise
+   * into the small FIFO. Return true if key is inserted.
+   *
+   */
+  bool insert(const TKey& key, const TValue& value);
+  bool insert(const TKey& key, TValue&& value);
+  bool insert(TKey&& key, TValue&& value);
+
+  size_t erase(const TKey& key);
+
+  /**
+   * clear removes all entries and ghosts, not to be called concurrently with other operations.
+   *
+   */
+  void clear() noexcept;
+
+  int size() const {
+    const int size = smallSize_.load(std::memory_order_relaxed) + mainSize_.load(std::memory_order_relaxed) -
+                     erasedSize_.load(std::memory_order_relaxed);
+    return std::max(size, 0);
+  }
+
+  int capacity() const {
+    return capacity_;
+  }
+};
+
+/**
+ * S3FIFOShard is the ScalableLRUCache shard policy making each shard an S3FIFOCache.
+ * The allocator is unused, the weigher must be UnitWeigher.
+ *
+ */
+struct S3FIFOShard final {
+  static constexpr bool HashedKeys = false;
+
+  template <typename TKey, typename TValue, typename THash, typename TAllocator, typename TWeigher>
+  using Shard = S3FIFOCache<TKey, TValue, THash>;
+
+  template <typename TShard, typename TAllocator, typename TWeigher>
+  static std::unique_ptr<TShard> make(size_t capacity, size_t, const TWeigher&) {
+    static_assert(IsUnitWeigher<TWeigher>::value, "S3FIFOCache shards count entries, use UnitWeigher");
+    return std::make_unique<TShard>(static_cast<int>(capacity));
+  }
+};
+
+template <typename TKey, typename TValue, typename THash>
+S3FIFOCache<TKey, TValue, THash>::S3FIFOCache(int size)
+  : hash_map_(),
+    small_(),
+    main_(),
+    ghosts_(),
+    ghostClock_(0),
+    evictMutex_(),
+    smallSize_(0),
+    mainSize_(0),
+    erasedSize_(0),
+    capacity_(size),
+    smallCapacity_(std::max(size * SmallPercent / 100, 1)),
+    reclaimThreshold_(std::max(size * ReclaimPercent / 100, 1)) {
+  // entries stay within the capacity, no rehash while running.
+  hash_map_.rehash(static_cast<size_t>(std::max(size, 0)) * 2);
+
+  // a lost ghost costs a main admission, 8 slots per live ghost keep the collisions rare.
+  size_t ghostSlots = 8;
+  while (ghostSlots < static_cast<size_t>(std::max(size, 0)) * 8) {
+    ghostSlots <<= 1;
+  }
+  ghosts_ = std::vector<std::atomic<uint64_t>>(ghostSlots);
+}
+
+template <typename TKey, typename TValue, typename THash>
+bool S3FIFOCache<TKey, TValue, THash>::find(ConstAccessor& caccessor, const TKey& key) {
+  HashMapConstAccessor constAccessor;
+  if (!hash_map_.find(constAccessor, key)) {
+    return false;
+  }
+
+  // a lost concurrent increment only under-counts a hit, no read-modify-write needed.
+  Node* node = constAccessor->second;
+  if (const uint8_t count = node->freq_.load(std::memory_order_relaxed); count < MaxFrequency) {
+    node->freq_.store(static_cast<uint8_t>(count + 1), std::memory_order_relaxed);
+  }
+
+  caccessor.value_ = node->value_;
+
+  return true;
+}
+
+template <typename TKey, typename TValue, typename THash>
+bool S3FIFOCache<TKey, TValue, THash>::contains(const TKey& key) {
+  HashMapConstAccessor constAccessor;
+  return hash_map_.find(constAccessor, key);
+}
+
+template <typename TKey, typename TValue, typename THash>
+bool S3FIFOCache<TKey, TValue, THash>::peek(ConstAccessor& caccessor, const TKey& key) {
+  HashMapConstAccessor constAccessor;
+  if (!hash_map_.find(constAccessor, key)) {
+    return false;
+  }
+
+  caccessor.value_ = constAccessor->second->value_;
+
+  return true;
+}
+
+template <typename TKey, typename TValue, typename THash>
+template <typename TKeyArg, typename TValueArg>
+bool S3FIFOCache<TKey, TValue, THash>::insertImpl(TKeyArg&& key, TValueArg&& value) {
+  if (capacity_ <= 0) {
+    return false;
+  }
+
+  {
+    HashMapAccessor accessor;
+    if (!hash_map_.insert(accessor, key)) {
+      return false;
+    }
+
+    try {
+      accessor->second = new Node(std::forward<TKeyArg>(key), std::forward<TValueArg>(value));
+    } catch (...) {
+      hash_map_.erase(accessor);
+      throw;
+    }
+
+    if (popGhost(accessor->first)) {
+      main_.push(accessor->second);
+      mainSize_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      small_.push(accessor->second);
+      smallSize_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  evict();
+
+  return true;
+}
+
+template <typename TKey, typename TValue, typename THash>
+bool S3FIFOCache<TKey, TValue, THash>::insert(const TKey& key, const TValue& value) {
+  return insertImpl(key, value);
+}
+
+template <typename TKey, typename TValue, typename THash>
+bool S3FIFOCache<TKey, TValue, THash>::insert(const TKey& key, TValue&& value) {
+  return insertImpl(key, std::move(value));
+}
+
+template <typename TKey, typename TValue, typename THash>
+bool S3FIFOCache<TKey, TValue, THash>::insert(TKey&& key, TValue&& value) {
+  return insertImpl(std::move(key), std::move(value));
+}
+
+template <typename TKey, typename TValue, typename THash>
+void S3FIFOCache<TKey, TValue, THash>::evict() {
+  if (size() <= capacity_) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(evictMutex_);
+
+  while (size() > capacity_) {
+    const bool fromSmall =
+      smallSize_.load(std::memory_order_relaxed) >= smallCapacity_ || mainSize_.load(std::memory_order_relaxed) == 0;
+
+    if (!(fromSmall ? evictSmall() || evictMain() : evictMain() || evictSmall())) {
+      break;
+    }
+  }
+}
+
+template <typename TKey, typename TValue, typename THash>
+bool S3FIFOCache<TKey, TValue, THash>::evictSmall() {
+  Node* node{nullptr};
+
+  while (small_.try_pop(node)) {
+    smallSize_.fetch_sub(1, std::memory_order_relaxed);
+
+    if (node->erased_.load(std::memory_order_acquire)) {
+      reclaim(node);
+      continue;
+    }
+
+    if (node->freq_.load(std::memory_order_relaxed) > 0) {
+      node->freq_.store(0, std::memory_order_relaxed);
+      main_.push(node);
+      mainSize_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+
+    if (!unlink(node)) {
+      reclaim(node);
+      continue;
+    }
+
+    pushGhost(node->key_);
+    delete node;
+
+    return true;
+  }
+
+  return false;
+}
+
+template <typename TKey, typename TValue, typename THash>
+bool S3FIFOCache<TKey, TValue, THash>::evictMain() {
+  Node* node{nullptr};
+
+  while (main_.try_pop(node)) {
+    mainSize_.fetch_sub(1, std::memory_order_relaxed);
+
+    if (node->erased_.load(std::memory_order_acquire)) {
+      reclaim(node);
+      continue;
+    }
+
+    if (const uint8_t count = node->freq_.load(std::memory_order_relaxed); count > 0) {
+      node->freq_.store(static_cast<uint8_t>(count - 1), std::memory_order_relaxed);
+      main_.push(node);
+      mainSize_.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+
+    if (!unlink(node)) {
+      reclaim(node);
+      continue;
+    }
+
+    delete node;
+
+    return true;
+  }
+
+  return false;
+}
+
+template <typename TKey, typename TValue, typename THash>
+bool S3FIFOCache<TKey, TValue, THash>::unlink(Node* node) {
+  HashMapAccessor accessor;
+  if (!hash_map_.find(accessor, node->key_) || accessor->second != node) {
+    return false;
+  }
+
+  hash_map_.erase(accessor);
+
+  return true;
+}
+
+template <typename TKey, typename TValue, typename THash>
+void S3FIFOCache<TKey, TValue, THash>::sweep(tbb::concurrent_queue<Node*>& fifo, std::atomic<int>& fifoSize) {
+  // nodes pushed by concurrent inserts during the sweep are left for the next one.
+  Node* node{nullptr};
+  for (int count = fifoSize.load(std::memory_order_relaxed); count > 0 && fifo.try_pop(node); count--) {
+    if (node->erased_.load(std::memory_order_acquire)) {
+      fifoSize.fetch_sub(1, std::memory_order_relaxed);
+      reclaim(node);
+    } else {
+      fifo.push(node);
+    }
+  }
+}
+
+template <typename TKey, typename TValue, typename THash>
+void S3FIFOCache<TKey, TValue, THash>::reclaim(Node* node) {
+  erasedSize_.fetch_sub(1, std::memory_order_relaxed);
+  delete node;
+}
+
+template <typename TKey, typename TValue, typename THash>
+void S3FIFOCache<TKey, TValue, THash>::pushGhost(const TKey& key) {
+  const uint64_t hash = static_cast<uint64_t>(THash().hash(key));
+  // clock 0 marks an empty slot.
+  uint32_t clock = ghostClock_.load(std::memory_order_relaxed) + 1;
+  clock += clock == 0;
+  ghostClock_.store(clock, std::memory_order_relaxed);
+
+  ghosts_[hash & (ghosts_.size() - 1)].store((hash >> 32) << 32 | clock, std::memory_order_relaxed);
+}
+
+template <typename TKey, typename TValue, typename THash>
+bool S3FIFOCache<TKey, TValue, THash>::popGhost(const TKey& key) {
+  const uint64_t hash = static_cast<uint64_t>(THash().hash(key));
+  auto& ghost = ghosts_[hash & (ghosts_.size() - 1)];
+
+  uint64_t slot = ghost.load(std::memory_order_relaxed);
+  if (slot == 0 || slot >> 32 != hash >> 32) {
+    return false;
+  }
+
+  // unsigned distance, correct across the clock wrap.
+  const uint32_t age = ghostClock_.load(std::memory_order_relaxed) - static_cast<uint32_t>(slot);
+  if (age >= static_cast<uint32_t>(capacity_ - smallCapacity_)) {
+    return false;
+  }
+
+  return ghost.compare_exchange_strong(slot, 0, std::memory_order_relaxed);
+}
+
+template <typename TKey, typename TValue, typename THash>
+size_t S3FIFOCache<TKey, TValue, THash>::erase(const TKey& key) {
+  HashMapAccessor accessor;
+  if (!hash_map_.find(accessor, key)) {
+    return 0;
+  }
+
+  // the node stays in its FIFO, the evicting or sweeping thread frees it.
+  erasedSize_.fetch_add(1, std::memory_order_relaxed);
+  accessor->second->erased_.store(true, std::memory_order_release);
+  hash_map_.erase(accessor);
+
+  // evict() only pops while the live entries exceed the capacity, below it erased nodes are swept.
+  if (erasedSize_.load(std::memory_order_relaxed) > reclaimThreshold_) {
+    std::unique_lock<std::mutex> lock(evictMutex_);
+    if (erasedSize_.load(std::memory_order_relaxed) > reclaimThreshold_) {
+      sweep(small_, smallSize_);
+      sweep(main_, mainSize_);
+    }
+  }
+
+  return 1;
+}
+
+template <typename TKey, typename TValue, typename THash>
+void S3FIFOCache<TKey, TValue, THash>::clear() noexcept {
+  std::unique_lock<std::mutex> lock(evictMutex_);
+
+  Node* node{nullptr};
+  while (small_.try_pop(node)) {
+    delete node;
+  }
+  while (main_.try_pop(node)) {
+    delete node;
+  }
+
+  hash_map_.clear();
+  for (auto& ghost : ghosts_) {
+    ghost.store(0, std::memory_order_relaxed);
+  }
+  smallSize_.store(0, std::memory_order_relaxed);
+  mainSize_.store(0, std::memory_order_relaxed);
+  erasedSize_.store(0, std::memory_order_relaxed);
+}
+
+}  // namespace LRUC
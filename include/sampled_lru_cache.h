@@ -0,0 +1,479 @@
+/**
+ * @author shchang
+ */
+
+#pragma once
+
+#include "cache_common.h"
+
+#include <tbb/concurrent_hash_map.h>
+#include <tbb/concurrent_queue.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace LRUC {
+
+/**
+ * SampledLRUCache approximates LRU by sampling, without any list nor cache-wide lock.
+ *
+ * Each entry owns one of capacity slots, and each slot a coarse last-access stamp. A hit stores
+ * the current stamp into the slot of the entry with a relaxed atomic store, skipped if the stamp
+ * did not change, under the shared element lock of the hash map only.
+ *
+ * An insert into a full cache samples sampleCount random slots and evicts the least-recently
+ * stamped one, or an older candidate kept in the eviction pool: the oldest sampled entry not
+ * evicted is offered to a pool of PoolSize candidates (one cache line), the least-recently stamped
+ * ones stay. A pool candidate accessed (or replaced) since is dropped once its stamp changed.
+ * Concurrent evictions claim the victim slot by compare-and-swap, thus each takes its own victim.
+ *
+ * The stamp is the insert count divided by about capacity / StampResolution, it ticks
+ * StampResolution times while the cache turns its content over once.
+ *
+ * find() takes SampledLRUCache::ConstAccessor as argument which stores a copy of the found value.
+ *
+ * contains() and peek() look a key up without stamping its slot.
+ *
+ * insert() takes key and value to insert into the cache, rvalue arguments are moved.
+ *
+ * erase() takes key to remove the entry from the cache and frees its slot.
+ */
+template <typename TKey, typename TValue, typename THash = tbb::tbb_hash_compare<TKey>>
+class SampledLRUCache final {
+ public:
+  static constexpr size_t DefaultSampleCount = 5;
+  static constexpr size_t PoolSize = 8;
+  static constexpr size_t StampResolution = 1024;
+
+ private:
+  struct Node final {
+    template <typename TKeyArg, typename TValueArg>
+    Node(TKeyArg&& key, TValueArg&& value, size_t slot)
+      : key_(std::forward<TKeyArg>(key)), value_(std::forward<TValueArg>(value)), slot_(slot) {}
+
+    const TKey key_;
+    TValue value_;
+    const size_t slot_;
+  };
+
+  /**
+   * Slot holds the entry and its last-access stamp side by side, a sample reads one cache line.
+   *
+   */
+  struct Slot final {
+    // nullptr if free or claimed by a running insert/erase.
+    std::atomic<Node*> node_{nullptr};
+    std::atomic<uint32_t> stamp_{0};
+  };
+
+  using HashMap = tbb::concurrent_hash_map<TKey, Node*, THash>;
+  using HashMapConstAccessor = typename HashMap::const_accessor;
+  using HashMapAccessor = typename HashMap::accessor;
+
+ public:
+  using ConstAccessor = CopyAccessor<TValue, SampledLRUCache>;
+
+ private:
+  HashMap hash_map_;
+  std::vector<Slot> slots_;
+  tbb::concurrent_queue<size_t> freeSlots_;
+  // stamp in the upper, slot + 1 in the lower 32 bits, 0 if empty.
+  std::array<std::atomic<uint64_t>, PoolSize> pool_;
+  std::atomic<uint64_t> insertCount_;
+  const size_t capacity_;
+  const size_t sampleCount_;
+  const int stampShift_;
+
+ private:
+  template <typename TKeyArg, typename TValueArg>
+  bool insertImpl(TKeyArg&& key, TValueArg&& value);
+
+  uint32_t stamp() const {
+    return static_cast<uint32_t>(insertCount_.load(std::memory_order_relaxed) >> stampShift_);
+  }
+
+  /**
+   * Take a free slot, or evict the entry of a sampled slot and take its slot.
+   *
+   */
+  size_t acquireSlot();
+
+  /**
+   * Pick a victim slot from sampleCount random slots and the pool, offer the oldest other sampled
+   * slot to the pool. Return capacity_ if no slot is occupied.
+   *
+   */
+  size_t sample();
+
+  /**
+   * Offer slot last stamped at slotStamp to the pool, it replaces the most recently stamped
+   * candidate if older.
+   *
+   */
+  void offer(size_t slot, uint32_t slotStamp, uint32_t now);
+
+  /**
+   * Claim the occupied slot for the calling insert, unlink and free its entry.
+   * Return false if another thread claimed it first.
+   *
+   */
+  bool evictSlot(size_t slot);
+
+ public:
+  /**
+   * size: capacity in entries.
+   * sampleCount: slots sampled per eviction, larger is closer to LRU and slower.
+   *
+   */
+  explicit SampledLRUCache(size_t size, size_t sampleCount = DefaultSampleCount);
+
+  ~SampledLRUCache() noexcept {
+    clear();
+  }
+
+  SampledLRUCache(const SampledLRUCache&) = delete;
+  SampledLRUCache& operator=(const SampledLRUCache&) = delete;
+
+  /**
+   * find copies the value of key into caccessor and stamps its slot, without any cache-wide lock.
+   * Return true if key is found.
+   *
+   */
+  bool find(ConstAccessor& caccessor, const TKey& key);
+
+  /**
+   * contains returns true if key is found, peek copies its value into caccessor like find.
+   * Neither stamps the slot.
+   *
+   */
+  bool contains(const TKey& key);
+  bool peek(ConstAccessor& caccessor, const TKey& key);
+
+  /**
+   * insert inserts key/value if key is absent, evicting a sampled entry if the cache is full.
+   * Return true if key is inserted.
+   *
+   */
+  bool insert(const TKey& key, const TValue& value);
+  bool insert(const TKey& key, TValue&& value);
+  bool insert(TKey&& key, TValue&& value);
+
+  size_t erase(const TKey& key);
+
+  /**
+   * clear removes all entries, not to be called concurrently with other operations.
+   *
+   */
+  void clear() noexcept;
+
+  size_t size() const {
+    return hash_map_.size();
+  }
+
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+  size_t sample_count() const noexcept {
+    return sampleCount_;
+  }
+};
+
+template <typename TKey, typename TValue, typename THash>
+SampledLRUCache<TKey, TValue, THash>::SampledLRUCache(size_t size, size_t sampleCount)
+  : hash_map_(),
+    slots_(size),
+    freeSlots_(),
+    pool_(),
+    insertCount_(0),
+    capacity_(size),
+    sampleCount_(std::max<size_t>(sampleCount, 1)),
+    stampShift_([size] {
+      int shift = 0;
+      while ((size >> shift) > StampResolution) {
+        shift++;
+      }
+      return shift;
+    }()) {
+  // entries stay within the capacity, no rehash while running.
+  hash_map_.rehash(size * 2);
+
+  for (size_t slot = 0; slot < size; slot++) {
+    freeSlots_.push(slot);
+  }
+}
+
+template <typename TKey, typename TValue, typename THash>
+bool SampledLRUCache<TKey, TValue, THash>::find(ConstAccessor& caccessor, const TKey& key) {
+  HashMapConstAccessor constAccessor;
+  if (!hash_map_.find(constAccessor, key)) {
+    return false;
+  }
+
+  // a hit within the same tick leaves the stamp cache line shared.
+  Node* node = constAccessor->second;
+  auto& slotStamp = slots_[node->slot_].stamp_;
+  if (const uint32_t now = stamp(); slotStamp.load(std::memory_order_relaxed) != now) {
+    slotStamp.store(now, std::memory_order_relaxed);
+  }
+
+  caccessor.value_ = node->value_;
+
+  return true;
+}
+
+template <typename TKey, typename TValue, typename THash>
+bool SampledLRUCache<TKey, TValue, THash>::contains(const TKey& key) {
+  HashMapConstAccessor constAccessor;
+  return hash_map_.find(constAccessor, key);
+}
+
+template <typename TKey, typename TValue, typename THash>
+bool SampledLRUCache<TKey, TValue, THash>::peek(ConstAccessor& caccessor, const TKey& key) {
+  HashMapConstAccessor constAccessor;
+  if (!hash_map_.find(constAccessor, key)) {
+    return false;
+  }
+
+  caccessor.value_ = constAccessor->second->value_;
+
+  return true;
+}
+
+template <typename TKey, typename TValue, typename THash>
+template <typename TKeyArg, typename TValueArg>
+bool SampledLRUCache<TKey, TValue, THash>::insertImpl(TKeyArg&& key, TValueArg&& value) {
+  if (capacity_ == 0) {
+    return false;
+  }
+
+  {
+    // no eviction for a present key.
+    HashMapConstAccessor constAccessor;
+    if (hash_map_.find(constAccessor, key)) {
+      return false;
+    }
+  }
+
+  // the slot is taken before the hash map element lock, an eviction never waits while holding one.
+  const size_t slot = acquireSlot();
+
+  Node* node{nullptr};
+  try {
+    node = new Node(std::forward<TKeyArg>(key), std::forward<TValueArg>(value), slot);
+  } catch (...) {
+    freeSlots_.push(slot);
+    throw;
+  }
+
+  HashMapAccessor accessor;
+  if (!hash_map_.insert(accessor, node->key_)) {
+    // a concurrent insert of the same key won.
+    delete node;
+    freeSlots_.push(slot);
+    return false;
+  }
+
+  accessor->second = node;
+  slots_[slot].stamp_.store(static_cast<uint32_t>(insertCount_.fetch_add(1, std::memory_order_relaxed) >> stampShift_),
+                      std::memory_order_relaxed);
+  slots_[slot].node_.store(node, std::memory_order_release);
+
+  return true;
+}
+
+template <typename TKey, typename TValue, typename THash>
+bool SampledLRUCache<TKey, TValue, THash>::insert(const TKey& key, const TValue& value) {
+  return insertImpl(key, value);
+}
+
+template <typename TKey, typename TValue, typename THash>
+bool SampledLRUCache<TKey, TValue, THash>::insert(const TKey& key, TValue&& value) {
+  return insertImpl(key, std::move(value));
+}
+
+template <typename TKey, typename TValue, typename THash>
+bool SampledLRUCache<TKey, TValue, THash>::insert(TKey&& key, TValue&& value) {
+  return insertImpl(std::move(key), std::move(value));
+}
+
+template <typename TKey, typename TValue, typename THash>
+size_t SampledLRUCache<TKey, TValue, THash>::acquireSlot() {
+  size_t slot{0};
+
+  for (;;) {
+    if (freeSlots_.try_pop(slot)) {
+      return slot;
+    }
+
+    // all slots claimed by running inserts/erases if none sampled, one of them frees or fills its slot.
+    slot = sample();
+    if (slot != capacity_ && evictSlot(slot)) {
+      return slot;
+    }
+
+    // the sampled slots are claimed by other threads, let them run before the next pass.
+    std::this_thread::yield();
+  }
+}
+
+template <typename TKey, typename TValue, typename THash>
+size_t SampledLRUCache<TKey, TValue, THash>::sample() {
+  thread_local std::minstd_rand gen{std::random_device{}()};
+
+  const uint32_t now = stamp();
+  size_t victim = capacity_;
+  uint32_t victimAge = 0;
+
+  // the oldest sampled slot other than the victim, offered to the pool.
+  size_t runnerUp = capacity_;
+  uint32_t runnerUpAge = 0;
+
+  for (size_t i = 0; i < sampleCount_; i++) {
+    const size_t slot = gen() % capacity_;
+    if (slot == victim || slots_[slot].node_.load(std::memory_order_relaxed) == nullptr) {
+      continue;
+    }
+
+    // unsigned distance, correct across the stamp wrap.
+    const uint32_t age = now - slots_[slot].stamp_.load(std::memory_order_relaxed);
+    if (victim == capacity_ || age > victimAge) {
+      runnerUp = victim;
+      runnerUpAge = victimAge;
+      victim = slot;
+      victimAge = age;
+    } else if (slot != runnerUp && (runnerUp == capacity_ || age > runnerUpAge)) {
+      runnerUp = slot;
+      runnerUpAge = age;
+    }
+  }
+
+  // the oldest pool candidate wins if older. Only it is validated, at most once per eviction:
+  // stamps only grow, thus a stale candidate looks older than it is and is dropped on its turn.
+  std::atomic<uint64_t>* oldest{nullptr};
+  uint32_t oldestAge = victimAge;
+  for (auto& candidate : pool_) {
+    const uint64_t entry = candidate.load(std::memory_order_relaxed);
+    if (entry == 0) {
+      continue;
+    }
+
+    if (const uint32_t age = now - static_cast<uint32_t>(entry >> 32);
+        age > oldestAge || (victim == capacity_ && oldest == nullptr)) {
+      oldest = &candidate;
+      oldestAge = age;
+    }
+  }
+
+  if (uint64_t entry = oldest == nullptr ? 0 : oldest->load(std::memory_order_relaxed);
+      entry != 0 && oldest->compare_exchange_strong(entry, 0, std::memory_order_relaxed)) {
+    const size_t slot = static_cast<uint32_t>(entry) - 1;
+    if (slots_[slot].stamp_.load(std::memory_order_relaxed) == static_cast<uint32_t>(entry >> 32) &&
+        slots_[slot].node_.load(std::memory_order_relaxed) != nullptr && slot != victim) {
+      if (victim != capacity_ && (runnerUp == capacity_ || victimAge > runnerUpAge)) {
+        runnerUp = victim;
+        runnerUpAge = victimAge;
+      }
+      victim = slot;
+    }
+  }
+
+  if (runnerUp != capacity_ && runnerUp != victim) {
+    offer(runnerUp, now - runnerUpAge, now);
+  }
+
+  return victim;
+}
+
+template <typename TKey, typename TValue, typename THash>
+void SampledLRUCache<TKey, TValue, THash>::offer(size_t slot, uint32_t slotStamp, uint32_t now) {
+  const uint64_t entry = static_cast<uint64_t>(slotStamp) << 32 | static_cast<uint64_t>(slot + 1);
+
+  // the empty or most recently stamped candidate, a lost race only drops a candidate.
+  std::atomic<uint64_t>* youngest{nullptr};
+  uint32_t youngestAge = now - slotStamp;
+  for (auto& candidate : pool_) {
+    const uint64_t current = candidate.load(std::memory_order_relaxed);
+    if (current == entry) {
+      return;
+    }
+
+    if (current == 0) {
+      youngest = &candidate;
+      break;
+    }
+
+    if (const uint32_t age = now - static_cast<uint32_t>(current >> 32); age < youngestAge) {
+      youngest = &candidate;
+      youngestAge = age;
+    }
+  }
+
+  if (youngest != nullptr) {
+    youngest->store(entry, std::memory_order_relaxed);
+  }
+}
+
+template <typename TKey, typename TValue, typename THash>
+bool SampledLRUCache<TKey, TValue, THash>::evictSlot(size_t slot) {
+  Node* node = slots_[slot].node_.load(std::memory_order_acquire);
+  if (node == nullptr || !slots_[slot].node_.compare_exchange_strong(node, nullptr, std::memory_order_acquire)) {
+    return false;
+  }
+
+  {
+    // erase() may have unlinked it already, it leaves the node to the claiming thread.
+    HashMapAccessor accessor;
+    if (hash_map_.find(accessor, node->key_) && accessor->second == node) {
+      hash_map_.erase(accessor);
+    }
+  }
+
+  delete node;
+
+  return true;
+}
+
+template <typename TKey, typename TValue, typename THash>
+size_t SampledLRUCache<TKey, TValue, THash>::erase(const TKey& key) {
+  HashMapAccessor accessor;
+  if (!hash_map_.find(accessor, key)) {
+    return 0;
+  }
+
+  // whoever claims the slot frees the node, a running eviction may have claimed it first.
+  Node* node = accessor->second;
+  Node* expected = node;
+  const bool claimed = slots_[node->slot_].node_.compare_exchange_strong(expected, nullptr, std::memory_order_acquire);
+  hash_map_.erase(accessor);
+
+  if (claimed) {
+    freeSlots_.push(node->slot_);
+    delete node;
+  }
+
+  return 1;
+}
+
+template <typename TKey, typename TValue, typename THash>
+void SampledLRUCache<TKey, TValue, THash>::clear() noexcept {
+  hash_map_.clear();
+  freeSlots_.clear();
+
+  for (size_t slot = 0; slot < capacity_; slot++) {
+    delete slots_[slot].node_.exchange(nullptr, std::memory_order_relaxed);
+    slots_[slot].stamp_.store(0, std::memory_order_relaxed);
+    freeSlots_.push(slot);
+  }
+
+  for (auto& candidate : pool_) {
+    candidate.store(0, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace LRUC
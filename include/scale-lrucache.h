@@ -5,35 +5,105 @@
 #pragma once
 #include "lrucache.h"
 
+#include <chrono>
+#include <functional>
+#include <iterator>
 #include <limits>
 #include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 namespace LRUC {
 
-template <class TKey, class TValue, class THash = tbb::tbb_hash_compare<TKey>>
+/**
+ * LRUShard is the default ScalableLRUCache shard policy, each shard is an LRUCache with buffered
+ * promotion. BasicLRUShard<TStats> shards LRUCache with the TStats stats policy, e.g.
+ * BasicLRUShard<ThreadStats> for stats() of each shard.
+ *
+ * A shard policy provides the Shard type template and make() constructing one shard, see
+ * S3FIFOShard (s3fifo_cache.h) for an alternative. The ScalableLRUCache functions forward to the
+ * shard functions of the same name, thus only those the Shard type has could be used.
+ * HashedKeys tells if the Shard takes HashedKey, then the hash routing a key to its shard is
+ * reused by the shard lookup.
+ */
+template <class TStats = LRUC_DEFAULT_STATS>
+struct BasicLRUShard final {
+  static constexpr bool HashedKeys = true;
+
+  template <class TKey, class TValue, class THash, class TAllocator, class TWeigher>
+  using Shard = LRUCache<TKey, TValue, THash, TAllocator, TWeigher, LRUC_DEFAULT_HASH_INDEX, TStats>;
+
+  template <class TShard, class TAllocator, class TWeigher>
+  static std::unique_ptr<TShard> make(size_t capacity, size_t bucket_count, const TWeigher& weigher) {
+    return std::make_unique<TShard>(
+      static_cast<int64_t>(capacity), bucket_count, TShard::Promotion::Buffered, TAllocator(), weigher);
+  }
+};
+
+using LRUShard = BasicLRUShard<>;
+
+template <class TKey,
+          class TValue,
+          class THash = tbb::tbb_hash_compare<TKey>,
+          class TAllocator = SlabAllocator<std::pair<const TKey, TValue>>,
+          class TWeigher = UnitWeigher,
+          class TShard = LRUShard>
 class ScalableLRUCache final {
  private:
-  using Shard = LRUCache<TKey, TValue, THash>;
+  using Shard = typename TShard::template Shard<TKey, TValue, THash, TAllocator, TWeigher>;
   using ShardPtr = std::unique_ptr<Shard>;
 
   std::vector<ShardPtr> shards_;
-  const size_t cache_size_;
   size_t shard_count_;
 
  private:
+  /**
+   * shardIndex returns the index of the Shard owning key, key is a TKey, a key-like type or a
+   * HashedKey.
+   */
+  template <typename TKeyLike>
+  size_t shardIndex(const TKeyLike& key) const;
+
+  /**
+   * shardKey returns hashed for the shard lookup if the Shard takes HashedKey, otherwise its key.
+   */
+  static decltype(auto) shardKey(const HashedKey<TKey>& hashed);
+
   /**
    * shard returns a Shard (LRUCache instance) based on key.
    */
-  Shard& shard(const TKey& key);
+  template <typename TKeyLike>
+  Shard& shard(const TKeyLike& key);
+
+  /**
+   * shardCapacity returns the capacity of shard shard_idx for cache capacity size,
+   * the remainder of the even split goes to the first shard.
+   */
+  size_t shardCapacity(size_t size, size_t shard_idx) const;
+
+  /**
+   * groupByShard returns the batch positions ordered by owning shard, and the start offset of
+   * each shard's group in that order (shard_count_ + 1 entries).
+   */
+  template <typename TIterator, typename TGetKey>
+  std::tuple<std::vector<size_t>, std::vector<size_t>> groupByShard(TIterator first,
+                                                                    TIterator last,
+                                                                    TGetKey&& getKey) const;
 
  public:
   using ConstAccessor = typename Shard::ConstAccessor;
 
   /**
-   * size: ScalableLRUCache capacity. And each internal LRUCache's capacity can be changed at runtime TODO(shchang)
+   * size: ScalableLRUCache capacity, split evenly across the shards, could be changed at run-time
+   * with set_capacity().
    * shard_count: shard count.
+   * Each shard allocates from its own default constructed TAllocator, i.e. its own slab pool.
+   * weigher: copied into each shard, size is then a weight budget, see LRUCache.
    */
-  explicit ScalableLRUCache(size_t size, size_t shard_count = 0);
+  explicit ScalableLRUCache(size_t size, size_t shard_count = 0, const TWeigher& weigher = TWeigher());
 
   ~ScalableLRUCache() noexcept {
     clear();
@@ -46,71 +116,521 @@ class ScalableLRUCache final {
 
   bool find(ConstAccessor& caccessor, const TKey& key);
 
+  /**
+   * contains returns true if key is found, peek copies its value into caccessor like find.
+   * Neither updates key access frequency.
+   */
+  bool contains(const TKey& key);
+  bool peek(ConstAccessor& caccessor, const TKey& key);
+
+  /**
+   * erase, find, contains and peek taking a key-like type, enabled if THash is transparent, see
+   * LRUCache. The shard is picked by the key-like hash, thus it must hash like the key.
+   */
+  template <typename TKeyLike, typename = EnableIfKeyLike<TKeyLike, THash>>
+  size_t erase(const TKeyLike& key);
+
+  template <typename TKeyLike, typename = EnableIfKeyLike<TKeyLike, THash>>
+  bool find(ConstAccessor& caccessor, const TKeyLike& key);
+
+  template <typename TKeyLike, typename = EnableIfKeyLike<TKeyLike, THash>>
+  bool contains(const TKeyLike& key);
+
+  template <typename TKeyLike, typename = EnableIfKeyLike<TKeyLike, THash>>
+  bool peek(ConstAccessor& caccessor, const TKeyLike& key);
+
+  /**
+   * hashed_key returns the HashedKey of key, see LRUCache::hashed_key. The overloads taking it
+   * route it to the shard and look it up there without hashing key again.
+   */
+  static HashedKey<TKey> hashed_key(const TKey& key);
+
+  size_t erase(const HashedKey<TKey>& key);
+  bool find(ConstAccessor& caccessor, const HashedKey<TKey>& key);
+  bool contains(const HashedKey<TKey>& key);
+  bool peek(ConstAccessor& caccessor, const HashedKey<TKey>& key);
+  bool insert(const HashedKey<TKey>& key, const TValue& value);
+  bool insert(const HashedKey<TKey>& key, TValue&& value);
+
+  /**
+   * find_visit invokes visitor on the stored value without copying it, see LRUCache::find_visit.
+   */
+  template <typename TVisitor>
+  bool find_visit(const TKey& key, TVisitor&& visitor);
+
   bool insert(const TKey& key, const TValue& value);
+  bool insert(const TKey& key, TValue&& value);
+  bool insert(TKey&& key, TValue&& value);
+
+  /**
+   * insert with ttl inserts an entry expiring after ttl into the owning shard,
+   * see LRUCache::insert.
+   */
+  bool insert(const TKey& key, const TValue& value, std::chrono::milliseconds ttl);
+  bool insert(TKey&& key, TValue&& value, std::chrono::milliseconds ttl);
+
+  /**
+   * emplace/try_emplace construct the value inside the owning shard, see LRUCache::emplace
+   * and LRUCache::try_emplace.
+   */
+  template <typename... TArgs>
+  bool emplace(const TKey& key, TArgs&&... args);
+
+  template <typename... TArgs>
+  bool emplace(TKey&& key, TArgs&&... args);
+
+  template <typename... TArgs>
+  bool try_emplace(const TKey& key, TArgs&&... args);
+
+  template <typename... TArgs>
+  bool try_emplace(TKey&& key, TArgs&&... args);
+
+  /**
+   * insert_or_assign/update modify the value inside the owning shard in place,
+   * see LRUCache::insert_or_assign and LRUCache::update.
+   */
+  template <typename TValueArg>
+  bool insert_or_assign(const TKey& key, TValueArg&& value);
+
+  template <typename TUpdater>
+  bool update(const TKey& key, TUpdater&& updater);
+
+  /**
+   * get_or_compute returns the cached value or loads it in the owning shard, concurrent misses
+   * of the same key share one load, see LRUCache::get_or_compute.
+   */
+  template <typename TLoader>
+  std::optional<TValue> get_or_compute(const TKey& key,
+                                       TLoader&& loader,
+                                       std::chrono::milliseconds timeout = Shard::DefaultLoadTimeout);
+
+  /**
+   * multi_find looks up a batch of keys, grouped by shard thus each shard updates its LRU order
+   * in one lock hold, see LRUCache::multi_find. Results are written to out in key order.
+   */
+  template <typename TKeyIterator, typename TOutputIterator>
+  size_t multi_find(TKeyIterator first, TKeyIterator last, TOutputIterator out);
+
+  /**
+   * multi_insert inserts a batch of key/value pairs, grouped by shard thus each shard links and
+   * evicts in one lock hold, see LRUCache::multi_insert. Pairs are copied into the cache.
+   */
+  template <typename TPairIterator>
+  size_t multi_insert(TPairIterator first, TPairIterator last);
 
   void clear() noexcept;
 
   long long size() const;
   int size(size_t shard_idx) const;
 
-  long long capacity() const;
-  int capacity(size_t shard_idx) const;
+  /**
+   * weight returns the total weight of the cached entries, see LRUCache::weight.
+   */
+  int64_t weight() const;
+  int64_t weight(size_t shard_idx) const;
+
+  int64_t capacity() const;
+  int64_t capacity(size_t shard_idx) const;
+
+  /**
+   * set_capacity changes the cache capacity, the new capacity is redistributed across the shards
+   * as in the constructor. Each shard shrinks in bounded chunks, see LRUCache::set_capacity.
+   */
+  void set_capacity(size_t size);
+
+  /**
+   * start_maintenance switches the shards to background eviction, overshoot and slack are split
+   * across the shards as the capacity. Each shard runs its own maintenance thread, see
+   * LRUCache::start_maintenance.
+   */
+  void start_maintenance(size_t overshoot, size_t slack = 0);
+
+  void stop_maintenance();
+
+  /**
+   * set_removal_listener sets the removal listener of every shard, each shard notifies the
+   * entries it removes, see LRUCache::set_removal_listener.
+   * Not thread-safe, set it before the cache is shared.
+   */
+  void set_removal_listener(const RemovalListener<TKey, TValue>& listener);
+
+  /**
+   * set_promotion_throttle sets the promotion throttle of every shard, the list fraction is of
+   * each shard list, see LRUCache::set_promotion_throttle.
+   * Not thread-safe, set it before the cache is shared.
+   */
+  void set_promotion_throttle(const PromotionThrottle& throttle);
 
   size_t shardCount() const;
+
+  /**
+   * stats returns the sum of the shard counters, stats(shard_idx) those of one shard, see
+   * LRUCache::stats; counted with BasicLRUShard<ThreadStats> (or LRUC_DEFAULT_STATS).
+   */
+  CacheStats stats() const;
+  CacheStats stats(size_t shard_idx) const;
+
+  /**
+   * stats_prometheus returns the counters of each shard (label shard="<index>") in the Prometheus
+   * text format, see CacheStats::to_prometheus.
+   */
+  std::string stats_prometheus(const std::string& prefix = "lruc") const;
+
+  /**
+   * stats_json returns the total and the per shard counters as a JSON object:
+   * {"total":{...},"shards":[{...},...]}.
+   */
+  std::string stats_json() const;
+
+  /**
+   * latency returns the merged latency histograms of the shards, latency(shard_idx) those of one
+   * shard, see LRUCache::latency; sampled with BasicLRUShard<LatencyStats<>>.
+   */
+  LatencySnapshot latency() const;
+  LatencySnapshot latency(size_t shard_idx) const;
 };
 
 // ---- private member functions ----
-template <class TKey, class TValue, class THash>
-typename ScalableLRUCache<TKey, TValue, THash>::Shard& ScalableLRUCache<TKey, TValue, THash>::shard(const TKey& key) {
-  THash hashObj{};
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+template <typename TKeyLike>
+size_t ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::shardIndex(const TKeyLike& key) const {
+  PreHashed<THash> hashObj{};
   // lower 16 bits counted as hash key
   constexpr int shift = std::numeric_limits<size_t>::digits - 16;
 
   // According to intel TBB doc:
   // Good performance depends on having good pseudo-randomness in the low-order bits of the hash code.
-  size_t h = (hashObj.hash(key) >> shift) % shard_count_;
+  return (hashObj.hash(key) >> shift) % shard_count_;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+template <typename TKeyLike>
+typename ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::Shard&
+ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::shard(const TKeyLike& key) {
+  return *shards_[shardIndex(key)];
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+decltype(auto)
+  ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::shardKey(const HashedKey<TKey>& hashed) {
+  if constexpr (TShard::HashedKeys) {
+    return hashed;
+  } else {
+    return hashed.key();
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+template <typename TIterator, typename TGetKey>
+std::tuple<std::vector<size_t>, std::vector<size_t>>
+  ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::groupByShard(TIterator first,
+                                                                                    TIterator last,
+                                                                                    TGetKey&& getKey) const {
+  std::vector<size_t> owner;
+  std::vector<size_t> offsets(shard_count_ + 1, 0);
+
+  for (; first != last; ++first) {
+    owner.push_back(shardIndex(getKey(*first)));
+    offsets[owner.back() + 1]++;
+  }
+
+  for (size_t i = 1; i <= shard_count_; i++) {
+    offsets[i] += offsets[i - 1];
+  }
+
+  // counting sort, keeps the batch order inside each shard.
+  std::vector<size_t> order(owner.size());
+  std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+  for (size_t pos = 0; pos < owner.size(); pos++) {
+    order[next[owner[pos]]++] = pos;
+  }
 
-  return *shards_[h];
+  return {std::move(order), std::move(offsets)};
+}
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+size_t ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::shardCapacity(size_t size,
+                                                                                          size_t shard_idx) const {
+  size_t cap = size / shard_count_;
+  size_t modular = size % shard_count_;
+
+  return shard_idx != 0 ? cap : (cap + modular);
 }
 // ---- private member functions end ----
 
-template <class TKey, class TValue, class THash>
-ScalableLRUCache<TKey, TValue, THash>::ScalableLRUCache(size_t size, size_t shard_count)
-  : cache_size_(size), shard_count_(shard_count > 0 ? shard_count : std::thread::hardware_concurrency()) {
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::ScalableLRUCache(size_t size,
+                                                                                         size_t shard_count,
+                                                                                         const TWeigher& weigher)
+  : shard_count_(shard_count > 0 ? shard_count : std::thread::hardware_concurrency()) {
   const size_t bucket_count = std::thread::hardware_concurrency() * 8;
 
-  size_t cap = cache_size_ / shard_count_;
-  size_t modular = cache_size_ % shard_count_;
-
   for (size_t i = 0; i < shard_count_; i++) {
-    shards_.emplace_back(std::make_unique<Shard>(i != 0 ? cap : (cap + modular), bucket_count));
+    shards_.emplace_back(TShard::template make<Shard, TAllocator>(shardCapacity(size, i), bucket_count, weigher));
   }
 }
 
-template <class TKey, class TValue, class THash>
-size_t ScalableLRUCache<TKey, TValue, THash>::erase(const TKey& key) {
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+size_t ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::erase(const TKey& key) {
+  return erase(hashed_key(key));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::find(ConstAccessor& caccessor,
+                                                                               const TKey& key) {
+  return find(caccessor, hashed_key(key));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::contains(const TKey& key) {
+  return contains(hashed_key(key));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::peek(ConstAccessor& caccessor,
+                                                                               const TKey& key) {
+  return peek(caccessor, hashed_key(key));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+HashedKey<TKey> ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::hashed_key(const TKey& key) {
+  return HashedKey<TKey>(key, THash().hash(key));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+size_t ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::erase(const HashedKey<TKey>& key) {
+  return shard(key).erase(shardKey(key));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::find(ConstAccessor& caccessor,
+                                                                               const HashedKey<TKey>& key) {
+  return shard(key).find(caccessor, shardKey(key));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::contains(const HashedKey<TKey>& key) {
+  return shard(key).contains(shardKey(key));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::peek(ConstAccessor& caccessor,
+                                                                               const HashedKey<TKey>& key) {
+  return shard(key).peek(caccessor, shardKey(key));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::insert(const HashedKey<TKey>& key,
+                                                                                 const TValue& value) {
+  return shard(key).insert(shardKey(key), value);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::insert(const HashedKey<TKey>& key,
+                                                                                 TValue&& value) {
+  return shard(key).insert(shardKey(key), std::move(value));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+template <typename TKeyLike, typename>
+size_t ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::erase(const TKeyLike& key) {
   return shard(key).erase(key);
 }
 
-template <class TKey, class TValue, class THash>
-bool ScalableLRUCache<TKey, TValue, THash>::find(ConstAccessor& caccessor, const TKey& key) {
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+template <typename TKeyLike, typename>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::find(ConstAccessor& caccessor,
+                                                                               const TKeyLike& key) {
   return shard(key).find(caccessor, key);
 }
 
-template <class TKey, class TValue, class THash>
-bool ScalableLRUCache<TKey, TValue, THash>::insert(const TKey& key, const TValue& value) {
-  return shard(key).insert(key, value);
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+template <typename TKeyLike, typename>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::contains(const TKeyLike& key) {
+  return shard(key).contains(key);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+template <typename TKeyLike, typename>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::peek(ConstAccessor& caccessor,
+                                                                               const TKeyLike& key) {
+  return shard(key).peek(caccessor, key);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+template <typename TVisitor>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::find_visit(const TKey& key,
+                                                                                     TVisitor&& visitor) {
+  return shard(key).find_visit(key, std::forward<TVisitor>(visitor));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::insert(const TKey& key, const TValue& value) {
+  return insert(hashed_key(key), value);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::insert(const TKey& key, TValue&& value) {
+  return insert(hashed_key(key), std::move(value));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::insert(TKey&& key, TValue&& value) {
+  // pick the shard before key is moved.
+  Shard& owner = shard(key);
+  return owner.insert(std::move(key), std::move(value));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::insert(const TKey& key,
+                                                                                 const TValue& value,
+                                                                                 std::chrono::milliseconds ttl) {
+  return shard(key).insert(key, value, ttl);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::insert(TKey&& key,
+                                                                                 TValue&& value,
+                                                                                 std::chrono::milliseconds ttl) {
+  // pick the shard before key is moved.
+  Shard& owner = shard(key);
+  return owner.insert(std::move(key), std::move(value), ttl);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+template <typename... TArgs>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::emplace(const TKey& key, TArgs&&... args) {
+  return shard(key).emplace(key, std::forward<TArgs>(args)...);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+template <typename... TArgs>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::emplace(TKey&& key, TArgs&&... args) {
+  // pick the shard before key is moved.
+  Shard& owner = shard(key);
+  return owner.emplace(std::move(key), std::forward<TArgs>(args)...);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+template <typename... TArgs>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::try_emplace(const TKey& key,
+                                                                                      TArgs&&... args) {
+  return shard(key).try_emplace(key, std::forward<TArgs>(args)...);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+template <typename... TArgs>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::try_emplace(TKey&& key, TArgs&&... args) {
+  // pick the shard before key is moved.
+  Shard& owner = shard(key);
+  return owner.try_emplace(std::move(key), std::forward<TArgs>(args)...);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+template <typename TValueArg>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::insert_or_assign(const TKey& key,
+                                                                                           TValueArg&& value) {
+  return shard(key).insert_or_assign(key, std::forward<TValueArg>(value));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+template <typename TUpdater>
+bool ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::update(const TKey& key, TUpdater&& updater) {
+  return shard(key).update(key, std::forward<TUpdater>(updater));
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+template <typename TLoader>
+std::optional<TValue> ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::get_or_compute(
+  const TKey& key, TLoader&& loader, std::chrono::milliseconds timeout) {
+  return shard(key).get_or_compute(key, std::forward<TLoader>(loader), timeout);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+template <typename TKeyIterator, typename TOutputIterator>
+size_t ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::multi_find(TKeyIterator first,
+                                                                                       TKeyIterator last,
+                                                                                       TOutputIterator out) {
+  if (shard_count_ == 1) {
+    return shards_[0]->multi_find(first, last, out);
+  }
+
+  std::vector<std::reference_wrapper<const TKey>> keys(first, last);
+  auto [order, offsets] = groupByShard(keys.begin(), keys.end(), [](const TKey& key) -> const TKey& { return key; });
+
+  std::vector<std::reference_wrapper<const TKey>> grouped;
+  grouped.reserve(order.size());
+  for (size_t pos : order) {
+    grouped.push_back(keys[pos]);
+  }
+
+  std::vector<std::optional<TValue>> results(order.size());
+  size_t hits = 0;
+
+  for (size_t i = 0; i < shard_count_; i++) {
+    if (offsets[i] != offsets[i + 1]) {
+      hits += shards_[i]->multi_find(
+        grouped.begin() + offsets[i], grouped.begin() + offsets[i + 1], results.begin() + offsets[i]);
+    }
+  }
+
+  // scatter the grouped results back to the batch order.
+  std::vector<size_t> rank(order.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    rank[order[i]] = i;
+  }
+
+  for (size_t pos = 0; pos < rank.size(); pos++, ++out) {
+    *out = std::move(results[rank[pos]]);
+  }
+
+  return hits;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+template <typename TPairIterator>
+size_t ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::multi_insert(TPairIterator first,
+                                                                                         TPairIterator last) {
+  using PairRef = std::pair<const TKey&, const TValue&>;
+
+  if (shard_count_ == 1) {
+    return shards_[0]->multi_insert(first, last);
+  }
+
+  std::vector<PairRef> pairs;
+  for (; first != last; ++first) {
+    pairs.emplace_back(std::get<0>(*first), std::get<1>(*first));
+  }
+
+  auto [order, offsets] = groupByShard(pairs.begin(), pairs.end(), [](const PairRef& pair) -> const TKey& {
+    return pair.first;
+  });
+
+  std::vector<PairRef> grouped;
+  grouped.reserve(order.size());
+  for (size_t pos : order) {
+    grouped.push_back(pairs[pos]);
+  }
+
+  size_t inserted = 0;
+
+  for (size_t i = 0; i < shard_count_; i++) {
+    if (offsets[i] != offsets[i + 1]) {
+      inserted += shards_[i]->multi_insert(grouped.begin() + offsets[i], grouped.begin() + offsets[i + 1]);
+    }
+  }
+
+  return inserted;
 }
 
-template <class TKey, class TValue, class THash>
-void ScalableLRUCache<TKey, TValue, THash>::clear() noexcept {
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+void ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::clear() noexcept {
   for (size_t i = 0; i < shard_count_; i++) {
     shards_[i]->clear();
   }
 }
 
-template <class TKey, class TValue, class THash>
-long long ScalableLRUCache<TKey, TValue, THash>::size() const {
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+long long ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::size() const {
   long long size = 0;
   for (size_t i = 0; i < shard_count_; i++) {
     size += shards_[i]->size();
@@ -118,8 +638,8 @@ long long ScalableLRUCache<TKey, TValue, THash>::size() const {
   return size;
 }
 
-template <class TKey, class TValue, class THash>
-int ScalableLRUCache<TKey, TValue, THash>::size(size_t shard_idx) const {
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+int ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::size(size_t shard_idx) const {
   if (shard_idx < shard_count_) {
     return shards_[shard_idx]->size();
   }
@@ -127,9 +647,28 @@ int ScalableLRUCache<TKey, TValue, THash>::size(size_t shard_idx) const {
   return 0;
 }
 
-template <class TKey, class TValue, class THash>
-long long ScalableLRUCache<TKey, TValue, THash>::capacity() const {
-  long long size = 0;
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+int64_t ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::weight() const {
+  int64_t weight = 0;
+  for (size_t i = 0; i < shard_count_; i++) {
+    weight += shards_[i]->weight();
+  }
+
+  return weight;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+int64_t ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::weight(size_t shard_idx) const {
+  if (shard_idx < shard_count_) {
+    return shards_[shard_idx]->weight();
+  }
+
+  return 0;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+int64_t ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::capacity() const {
+  int64_t size = 0;
   for (size_t i = 0; i < shard_count_; i++) {
     size += shards_[i]->capacity();
   }
@@ -137,8 +676,8 @@ long long ScalableLRUCache<TKey, TValue, THash>::capacity() const {
   return size;
 }
 
-template <class TKey, class TValue, class THash>
-int ScalableLRUCache<TKey, TValue, THash>::capacity(size_t shard_idx) const {
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+int64_t ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::capacity(size_t shard_idx) const {
   if (shard_idx < shard_count_) {
     return shards_[shard_idx]->capacity();
   }
@@ -146,8 +685,109 @@ int ScalableLRUCache<TKey, TValue, THash>::capacity(size_t shard_idx) const {
   return 0;
 }
 
-template <class TKey, class TValue, class THash>
-size_t ScalableLRUCache<TKey, TValue, THash>::shardCount() const {
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+void ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::set_capacity(size_t size) {
+  for (size_t i = 0; i < shard_count_; i++) {
+    shards_[i]->set_capacity(static_cast<int64_t>(shardCapacity(size, i)));
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+void ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::start_maintenance(size_t overshoot,
+                                                                                            size_t slack) {
+  for (size_t i = 0; i < shard_count_; i++) {
+    shards_[i]->start_maintenance(static_cast<int64_t>(shardCapacity(overshoot, i)),
+                                  static_cast<int64_t>(shardCapacity(slack, i)));
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+void ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::stop_maintenance() {
+  for (auto& shard : shards_) {
+    shard->stop_maintenance();
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+void ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::set_removal_listener(
+  const RemovalListener<TKey, TValue>& listener) {
+  for (auto& shard : shards_) {
+    shard->set_removal_listener(listener);
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+void ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::set_promotion_throttle(
+  const PromotionThrottle& throttle) {
+  for (auto& shard : shards_) {
+    shard->set_promotion_throttle(throttle);
+  }
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+size_t ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::shardCount() const {
   return shard_count_;
 }
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+CacheStats ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::stats() const {
+  CacheStats stats;
+  for (size_t i = 0; i < shard_count_; i++) {
+    stats += shards_[i]->stats();
+  }
+
+  return stats;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+CacheStats ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::stats(size_t shard_idx) const {
+  if (shard_idx < shard_count_) {
+    return shards_[shard_idx]->stats();
+  }
+
+  return {};
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+std::string ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::stats_prometheus(
+  const std::string& prefix) const {
+  std::vector<std::pair<std::string, CacheStats>> samples;
+  for (size_t i = 0; i < shard_count_; i++) {
+    samples.emplace_back("shard=\"" + std::to_string(i) + "\"", shards_[i]->stats());
+  }
+
+  return to_prometheus(samples, prefix);
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+std::string ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::stats_json() const {
+  CacheStats total;
+  std::string shards;
+  for (size_t i = 0; i < shard_count_; i++) {
+    const CacheStats stats = shards_[i]->stats();
+    total += stats;
+    shards += (i == 0 ? "" : ",") + stats.to_json();
+  }
+
+  return "{\"total\":" + total.to_json() + ",\"shards\":[" + shards + "]}";
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+LatencySnapshot ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::latency() const {
+  LatencySnapshot latency;
+  for (size_t i = 0; i < shard_count_; i++) {
+    latency += shards_[i]->latency();
+  }
+
+  return latency;
+}
+
+template <class TKey, class TValue, class THash, class TAllocator, class TWeigher, class TShard>
+LatencySnapshot ScalableLRUCache<TKey, TValue, THash, TAllocator, TWeigher, TShard>::latency(size_t shard_idx) const {
+  if (shard_idx < shard_count_) {
+    return shards_[shard_idx]->latency();
+  }
+
+  return {};
+}
 }  // namespace LRUC
@@ -0,0 +1,337 @@
+/**
+ * @author shchang
+ */
+
+#pragma once
+
+#include "cache_line.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace LRUC {
+
+/**
+ * SlabPool is a fixed-size block pool, carving blocks of size classes
+ * (multiples of Alignment up to MaxBlockSize) out of slabs.
+ *
+ * Blocks are cached in per-thread stripes (threads are assigned to stripes
+ * in round-robin, a thread finding its stripe locked moves on to the next
+ * free one), each with a free list per size class. A stripe holding
+ * too many free blocks of a class moves a batch to the shared depot, an empty
+ * stripe refills from the depot before carving a new slab, thus memory freed
+ * by one thread is reused by the others.
+ *
+ * The first slab of a stripe is MinSlabSize, each next one doubles up to SlabSize, thus a
+ * stripe used by a thread allocating a few blocks (e.g. a thread touching every shard of a
+ * scaled-lru cache once) holds MinSlabSize instead of a full SlabSize slab.
+ *
+ * Once warmed up, allocate/deallocate of a size class do not call the global
+ * allocator. Requests beyond MaxBlockSize fall through to operator new.
+ *
+ * Slabs are released when the pool is destroyed.
+ *
+ * Thread-safe.
+ */
+class SlabPool final {
+public:
+  static constexpr size_t Alignment = alignof(std::max_align_t);
+  static constexpr size_t ClassCount = 16;
+  static constexpr size_t MaxBlockSize = Alignment * ClassCount;
+  static constexpr size_t MinSlabSize = 4 * 1024;
+  static constexpr size_t SlabSize = 64 * 1024;
+
+private:
+  /**
+   * Free lists hold at most HighWater blocks per stripe and class,
+   * BatchSize blocks are moved between a stripe and the depot at once.
+   */
+  static constexpr size_t HighWater = 256;
+  static constexpr size_t BatchSize = HighWater / 2;
+
+  struct FreeBlock {
+    FreeBlock* next_;
+  };
+
+  struct FreeList {
+    FreeBlock* head_{nullptr};
+    size_t count_{0};
+  };
+
+  struct alignas(CacheLineSize) Stripe {
+    std::mutex mutex_{};
+    std::array<FreeList, ClassCount> freeLists_{};
+    char* bump_{nullptr};
+    char* bumpEnd_{nullptr};
+    // size of the last slab carved by this stripe, 0 before the first one.
+    size_t slabSize_{0};
+  };
+
+  std::unique_ptr<Stripe[]> stripes_;
+  const size_t mask_;
+
+  std::mutex depotMutex_;
+  std::array<FreeList, ClassCount> depot_;
+  std::vector<void*> slabs_;
+
+private:
+  /**
+   * Lock the stripe of the calling thread, or the next unlocked stripe if it is contended.
+   */
+  Stripe& lockStripe(std::unique_lock<std::mutex>& lock);
+
+  static constexpr size_t sizeClass(size_t bytes) {
+    return (bytes + Alignment - 1) / Alignment - 1;
+  }
+
+  /**
+   * Move up to count blocks from the front of from to to.
+   */
+  static void transfer(FreeList& from, FreeList& to, size_t count);
+
+  /**
+   * Fill the stripe free list of cls from the depot, or carve blocks from the stripe slab.
+   * Caller holds the stripe lock.
+   */
+  void refill(Stripe& stripe, size_t cls);
+
+public:
+  explicit SlabPool(size_t stripeCount = std::thread::hardware_concurrency() * 4);
+  ~SlabPool() noexcept;
+
+  SlabPool(const SlabPool&) = delete;
+  SlabPool& operator=(const SlabPool&) = delete;
+
+  void* allocate(size_t bytes);
+  void deallocate(void* ptr, size_t bytes) noexcept;
+};
+
+/**
+ * SlabAllocator is a std allocator handle to a SlabPool, the pool must outlive
+ * all copies of the allocator. Copies and rebound copies refer to the same pool,
+ * thus a container and all its internal node types allocate from one pool.
+ *
+ * A default constructed SlabAllocator is unbound and allocates with operator new,
+ * LRUCache binds an unbound SlabAllocator to a slab pool owned by the cache.
+ *
+ * The handle is a plain pointer, since containers (e.g. tbb::concurrent_hash_map)
+ * copy the allocator on every node allocation.
+ *
+ * Over-aligned types are allocated with the aligned operator new.
+ */
+template <typename T>
+class SlabAllocator {
+public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  template <typename U>
+  struct rebind {
+    using other = SlabAllocator<U>;
+  };
+
+private:
+  template <typename U>
+  friend class SlabAllocator;
+
+  SlabPool* pool_;
+
+public:
+  SlabAllocator() noexcept : pool_(nullptr) {}
+
+  explicit SlabAllocator(SlabPool& pool) noexcept : pool_(&pool) {}
+
+  template <typename U>
+  SlabAllocator(const SlabAllocator<U>& other) noexcept : pool_(other.pool_) {}
+
+  // nullptr if unbound.
+  SlabPool* pool() const noexcept {
+    return pool_;
+  }
+
+  T* allocate(size_t n) {
+    if constexpr (alignof(T) > SlabPool::Alignment) {
+      return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{alignof(T)}));
+    }
+
+    if (pool_ == nullptr) {
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    return static_cast<T*>(pool_->allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T* ptr, size_t n) noexcept {
+    if constexpr (alignof(T) > SlabPool::Alignment) {
+      ::operator delete(ptr, std::align_val_t{alignof(T)});
+      return;
+    }
+
+    if (pool_ == nullptr) {
+      ::operator delete(ptr);
+      return;
+    }
+
+    pool_->deallocate(ptr, n * sizeof(T));
+  }
+
+  template <typename U>
+  bool operator==(const SlabAllocator<U>& other) const noexcept {
+    return pool_ == other.pool_;
+  }
+
+  template <typename U>
+  bool operator!=(const SlabAllocator<U>& other) const noexcept {
+    return pool_ != other.pool_;
+  }
+};
+
+/**
+ * IsSlabAllocator is true for SlabAllocator types.
+ */
+template <typename TAllocator>
+struct IsSlabAllocator : std::false_type {};
+
+template <typename T>
+struct IsSlabAllocator<SlabAllocator<T>> : std::true_type {};
+
+inline SlabPool::SlabPool(size_t stripeCount)
+  : stripes_(), mask_(stripeMask(stripeCount)), depotMutex_(), depot_(), slabs_() {
+  stripes_ = std::make_unique<Stripe[]>(mask_ + 1);
+}
+
+inline SlabPool::~SlabPool() noexcept {
+  for (void* slab : slabs_) {
+    ::operator delete(slab);
+  }
+}
+
+inline SlabPool::Stripe& SlabPool::lockStripe(std::unique_lock<std::mutex>& lock) {
+  const size_t home = threadProbe();
+
+  for (size_t i = 0; i <= mask_; i++) {
+    Stripe& stripe = stripes_[(home + i) & mask_];
+    lock = std::unique_lock<std::mutex>(stripe.mutex_, std::try_to_lock);
+    if (lock) {
+      return stripe;
+    }
+  }
+
+  Stripe& stripe = stripes_[home & mask_];
+  lock = std::unique_lock<std::mutex>(stripe.mutex_);
+  return stripe;
+}
+
+inline void SlabPool::transfer(FreeList& from, FreeList& to, size_t count) {
+  for (; count > 0 && from.head_ != nullptr; count--) {
+    FreeBlock* block = from.head_;
+    from.head_ = block->next_;
+    from.count_--;
+
+    block->next_ = to.head_;
+    to.head_ = block;
+    to.count_++;
+  }
+}
+
+inline void SlabPool::refill(Stripe& stripe, size_t cls) {
+  FreeList& freeList = stripe.freeLists_[cls];
+
+  {
+    std::unique_lock<std::mutex> lock(depotMutex_);
+    transfer(depot_[cls], freeList, BatchSize);
+  }
+
+  if (freeList.head_ != nullptr) {
+    return;
+  }
+
+  const size_t blockSize = (cls + 1) * Alignment;
+
+  if (static_cast<size_t>(stripe.bumpEnd_ - stripe.bump_) < blockSize) {
+    // the tail of the previous slab is abandoned, it is below MaxBlockSize.
+    const size_t slabSize = stripe.slabSize_ == 0 ? MinSlabSize : std::min(stripe.slabSize_ * 2, SlabSize);
+    void* slab = ::operator new(slabSize);
+
+    {
+      std::unique_lock<std::mutex> lock(depotMutex_);
+      try {
+        slabs_.push_back(slab);
+      } catch (...) {
+        ::operator delete(slab);
+        throw;
+      }
+    }
+
+    stripe.bump_ = static_cast<char*>(slab);
+    stripe.bumpEnd_ = stripe.bump_ + slabSize;
+    stripe.slabSize_ = slabSize;
+  }
+
+  // carve a batch, the depot is only checked again once the batch is used up.
+  for (size_t i = 0; i < BatchSize && static_cast<size_t>(stripe.bumpEnd_ - stripe.bump_) >= blockSize; i++) {
+    FreeBlock* block = reinterpret_cast<FreeBlock*>(stripe.bump_);
+    stripe.bump_ += blockSize;
+
+    block->next_ = freeList.head_;
+    freeList.head_ = block;
+    freeList.count_++;
+  }
+}
+
+inline void* SlabPool::allocate(size_t bytes) {
+  if (bytes == 0 || bytes > MaxBlockSize) {
+    return ::operator new(bytes);
+  }
+
+  const size_t cls = sizeClass(bytes);
+
+  std::unique_lock<std::mutex> lock;
+  Stripe& stripe = lockStripe(lock);
+  FreeList& freeList = stripe.freeLists_[cls];
+
+  if (freeList.head_ == nullptr) {
+    refill(stripe, cls);
+  }
+
+  FreeBlock* block = freeList.head_;
+  freeList.head_ = block->next_;
+  freeList.count_--;
+
+  return block;
+}
+
+inline void SlabPool::deallocate(void* ptr, size_t bytes) noexcept {
+  if (bytes == 0 || bytes > MaxBlockSize) {
+    ::operator delete(ptr);
+    return;
+  }
+
+  const size_t cls = sizeClass(bytes);
+
+  std::unique_lock<std::mutex> lock;
+  Stripe& stripe = lockStripe(lock);
+  FreeList& freeList = stripe.freeLists_[cls];
+
+  FreeBlock* block = static_cast<FreeBlock*>(ptr);
+  block->next_ = freeList.head_;
+  freeList.head_ = block;
+  freeList.count_++;
+
+  if (freeList.count_ > HighWater) {
+    std::unique_lock<std::mutex> depotLock(depotMutex_);
+    transfer(freeList, depot_[cls], BatchSize);
+  }
+}
+
+}  // namespace LRUC
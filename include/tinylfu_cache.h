@@ -0,0 +1,357 @@
+/**
+ * @author shchang
+ */
+
+#pragma once
+
+#include "cache_common.h"
+#include "frequency_sketch.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace LRUC {
+
+/**
+ * TinyLFUCache is a thread-safe cache with W-TinyLFU eviction, scan resistant unlike LRU.
+ *
+ * New entries enter a small LRU admission window (WindowPercent of the capacity). An entry
+ * leaving the window is a candidate for the main region, a segmented LRU of a probation and a
+ * protected segment (ProtectedPercent of the main region): the candidate replaces the main
+ * victim (the least-recently used probation entry) only if a FrequencySketch estimates it was
+ * accessed more often recently, otherwise the candidate is evicted. A hit in probation promotes
+ * the entry to protected, protected overflow is demoted back to probation.
+ *
+ * Thus one-off keys (e.g. a scan) pass through the window without flushing frequently used keys
+ * out of the main region, while the window still holds bursts of recency.
+ *
+ * Every find() and insert() is recorded into the sketch, hits and misses alike.
+ *
+ * find() takes TinyLFUCache::ConstAccessor as argument which stores a copy of the found value.
+ *
+ * contains() and peek() look a key up without recording it into the sketch nor moving its entry.
+ *
+ * insert() takes key and value to insert into the cache, rvalue arguments are moved.
+ *
+ * erase() takes key to remove the entry from the cache.
+ *
+ * All operations take one cache-wide mutex, shard the key space over several instances for
+ * heavy concurrent load.
+ */
+template <typename TKey, typename TValue, typename THash = std::hash<TKey>, typename TKeyEqual = std::equal_to<TKey>>
+class TinyLFUCache final {
+ public:
+  static constexpr size_t WindowPercent = 1;
+  static constexpr size_t ProtectedPercent = 80;
+
+  using ConstAccessor = CopyAccessor<TValue, TinyLFUCache>;
+
+ private:
+  enum class Region : uint8_t { Window, Probation, Protected };
+
+  struct Entry final : IntrusiveLink {
+    template <typename TValueArg>
+    explicit Entry(TValueArg&& value) : IntrusiveLink(), value_(std::forward<TValueArg>(value)) {}
+
+    TValue value_;
+    const TKey* key_{nullptr};
+    Region region_{Region::Window};
+  };
+
+  using EntryList = IntrusiveList<Entry>;
+
+  using HashMap = std::unordered_map<TKey, Entry, THash, TKeyEqual>;
+
+  mutable std::mutex mutex_;
+  HashMap hash_map_;
+  EntryList window_;
+  EntryList probation_;
+  EntryList protected_;
+  FrequencySketch sketch_;
+  const THash hasher_;
+  const size_t capacity_;
+  const size_t windowCapacity_;
+  const size_t protectedCapacity_;
+
+ private:
+  /**
+   * Update the regions for a hit on entry.
+   * Caller holds mutex_.
+   *
+   */
+  void onHit(Entry* entry);
+
+  /**
+   * Move the least-recently used window entries beyond the window capacity to the main region,
+   * or evict them if they lose against the main victim.
+   * Caller holds mutex_.
+   *
+   */
+  void evictWindow();
+
+  /**
+   * Unlink entry from its region and erase it.
+   * Caller holds mutex_.
+   *
+   */
+  void evict(Entry* entry);
+
+  EntryList& regionList(Region region);
+
+  template <typename TKeyArg, typename TValueArg>
+  bool insertImpl(TKeyArg&& key, TValueArg&& value);
+
+ public:
+  /**
+   * size: capacity in entries.
+   *
+   */
+  explicit TinyLFUCache(size_t size);
+
+  ~TinyLFUCache() noexcept = default;
+
+  TinyLFUCache(const TinyLFUCache&) = delete;
+  TinyLFUCache& operator=(const TinyLFUCache&) = delete;
+
+  /**
+   * find copies the value of key into caccessor and records the hit.
+   * Return true if key is found.
+   *
+   */
+  bool find(ConstAccessor& caccessor, const TKey& key);
+
+  /**
+   * contains returns true if key is found, peek copies its value into caccessor like find.
+   * Neither records the access.
+   *
+   */
+  bool contains(const TKey& key);
+  bool peek(ConstAccessor& caccessor, const TKey& key);
+
+  /**
+   * insert inserts key/value into the admission window if key is absent.
+   * Return true if key is inserted (it may still be evicted right away by the admission).
+   *
+   */
+  bool insert(const TKey& key, const TValue& value);
+  bool insert(const TKey& key, TValue&& value);
+  bool insert(TKey&& key, TValue&& value);
+
+  size_t erase(const TKey& key);
+
+  void clear();
+
+  size_t size() const;
+
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+};
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+TinyLFUCache<TKey, TValue, THash, TKeyEqual>::TinyLFUCache(size_t size)
+  : mutex_(),
+    hash_map_(),
+    window_(),
+    probation_(),
+    protected_(),
+    sketch_(size),
+    hasher_(),
+    capacity_(size),
+    windowCapacity_(std::max<size_t>(size * WindowPercent / 100, 1)),
+    protectedCapacity_((size - std::min(size, windowCapacity_)) * ProtectedPercent / 100) {
+  hash_map_.reserve(size + 1);
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+typename TinyLFUCache<TKey, TValue, THash, TKeyEqual>::EntryList&
+  TinyLFUCache<TKey, TValue, THash, TKeyEqual>::regionList(Region region) {
+  switch (region) {
+    case Region::Window:
+      return window_;
+    case Region::Probation:
+      return probation_;
+    default:
+      return protected_;
+  }
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+void TinyLFUCache<TKey, TValue, THash, TKeyEqual>::onHit(Entry* entry) {
+  switch (entry->region_) {
+    case Region::Window:
+      window_.remove(entry);
+      window_.pushBack(entry);
+      break;
+    case Region::Probation:
+      probation_.remove(entry);
+      entry->region_ = Region::Protected;
+      protected_.pushBack(entry);
+
+      if (protected_.size() > protectedCapacity_) {
+        Entry* demoted = protected_.front();
+        protected_.remove(demoted);
+        demoted->region_ = Region::Probation;
+        probation_.pushBack(demoted);
+      }
+      break;
+    case Region::Protected:
+      protected_.remove(entry);
+      protected_.pushBack(entry);
+      break;
+  }
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+void TinyLFUCache<TKey, TValue, THash, TKeyEqual>::evict(Entry* entry) {
+  regionList(entry->region_).remove(entry);
+  hash_map_.erase(*entry->key_);
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+void TinyLFUCache<TKey, TValue, THash, TKeyEqual>::evictWindow() {
+  const size_t mainCapacity = capacity_ - std::min(capacity_, windowCapacity_);
+
+  while (window_.size() > windowCapacity_) {
+    Entry* candidate = window_.front();
+    window_.remove(candidate);
+    candidate->region_ = Region::Probation;
+
+    if (probation_.size() + protected_.size() < mainCapacity) {
+      probation_.pushBack(candidate);
+      continue;
+    }
+
+    Entry* victim = probation_.size() > 0 ? probation_.front() : protected_.front();
+    if (victim == nullptr) {
+      // no main region.
+      hash_map_.erase(*candidate->key_);
+      continue;
+    }
+
+    // ties go to the victim, a one-off key does not replace an entry seen as often.
+    if (sketch_.frequency(hasher_(*candidate->key_)) > sketch_.frequency(hasher_(*victim->key_))) {
+      evict(victim);
+      probation_.pushBack(candidate);
+    } else {
+      hash_map_.erase(*candidate->key_);
+    }
+  }
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+bool TinyLFUCache<TKey, TValue, THash, TKeyEqual>::find(ConstAccessor& caccessor, const TKey& key) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  sketch_.increment(hasher_(key));
+
+  auto it = hash_map_.find(key);
+  if (it == hash_map_.end()) {
+    return false;
+  }
+
+  onHit(&it->second);
+  caccessor.value_ = it->second.value_;
+
+  return true;
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+bool TinyLFUCache<TKey, TValue, THash, TKeyEqual>::contains(const TKey& key) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  return hash_map_.find(key) != hash_map_.end();
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+bool TinyLFUCache<TKey, TValue, THash, TKeyEqual>::peek(ConstAccessor& caccessor, const TKey& key) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  auto it = hash_map_.find(key);
+  if (it == hash_map_.end()) {
+    return false;
+  }
+
+  caccessor.value_ = it->second.value_;
+
+  return true;
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+template <typename TKeyArg, typename TValueArg>
+bool TinyLFUCache<TKey, TValue, THash, TKeyEqual>::insertImpl(TKeyArg&& key, TValueArg&& value) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  sketch_.increment(hasher_(key));
+
+  if (hash_map_.find(key) != hash_map_.end()) {
+    return false;
+  }
+
+  auto it = hash_map_
+              .emplace(std::piecewise_construct,
+                       std::forward_as_tuple(std::forward<TKeyArg>(key)),
+                       std::forward_as_tuple(std::forward<TValueArg>(value)))
+              .first;
+
+  Entry* entry = &it->second;
+  entry->key_ = &it->first;
+  window_.pushBack(entry);
+
+  evictWindow();
+
+  return true;
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+bool TinyLFUCache<TKey, TValue, THash, TKeyEqual>::insert(const TKey& key, const TValue& value) {
+  return insertImpl(key, value);
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+bool TinyLFUCache<TKey, TValue, THash, TKeyEqual>::insert(const TKey& key, TValue&& value) {
+  return insertImpl(key, std::move(value));
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+bool TinyLFUCache<TKey, TValue, THash, TKeyEqual>::insert(TKey&& key, TValue&& value) {
+  return insertImpl(std::move(key), std::move(value));
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+size_t TinyLFUCache<TKey, TValue, THash, TKeyEqual>::erase(const TKey& key) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  auto it = hash_map_.find(key);
+  if (it == hash_map_.end()) {
+    return 0;
+  }
+
+  regionList(it->second.region_).remove(&it->second);
+  hash_map_.erase(it);
+
+  return 1;
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+void TinyLFUCache<TKey, TValue, THash, TKeyEqual>::clear() {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  window_.clear();
+  probation_.clear();
+  protected_.clear();
+  hash_map_.clear();
+  sketch_.clear();
+}
+
+template <typename TKey, typename TValue, typename THash, typename TKeyEqual>
+size_t TinyLFUCache<TKey, TValue, THash, TKeyEqual>::size() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return hash_map_.size();
+}
+
+}  // namespace LRUC
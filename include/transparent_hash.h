@@ -0,0 +1,133 @@
+/**
+ * @author shchang
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace LRUC {
+
+/**
+ * IsTransparent is true for a hash (std::hash style functor, or tbb::tbb_hash_compare style
+ * hash-compare) or key equality declaring the member type is_transparent: it accepts key-like
+ * types besides the key type, e.g. std::string_view for std::string keys.
+ *
+ * find(), erase() and contains() of LRUCache, ScalableLRUCache and LRUClockCache then take any
+ * key-like type and look it up without constructing a key. A key-like value must hash like the
+ * key it is equal to.
+ */
+template <typename THash, typename = void>
+struct IsTransparent : std::false_type {};
+
+template <typename THash>
+struct IsTransparent<THash, std::void_t<typename THash::is_transparent>> : std::true_type {};
+
+/**
+ * EnableIfKeyLike enables an overload taking TKeyLike if all of the hash and equality types are
+ * transparent, a TKey argument still picks the overload taking const TKey&.
+ */
+template <typename TKeyLike, typename... TTransparent>
+using EnableIfKeyLike = std::enable_if_t<std::conjunction_v<IsTransparent<TTransparent>...>, TKeyLike>;
+
+/**
+ * StringHashCompare is a transparent hash-compare of std::string keys for LRUCache and
+ * ScalableLRUCache, lookups take std::string_view or const char* as well.
+ */
+struct StringHashCompare final {
+  using is_transparent = void;
+
+  static std::size_t hash(std::string_view key) noexcept {
+    return std::hash<std::string_view>()(key);
+  }
+
+  static bool equal(std::string_view lhs, std::string_view rhs) noexcept {
+    return lhs == rhs;
+  }
+};
+
+/**
+ * StringHash is a transparent hash of std::string keys for LRUClockCache, use it with
+ * std::equal_to<> as key equality.
+ */
+struct StringHash final {
+  using is_transparent = void;
+
+  std::size_t operator()(std::string_view key) const noexcept {
+    return std::hash<std::string_view>()(key);
+  }
+};
+
+/**
+ * HashedKey is a key with its hash computed once, see hashed_key() of LRUCache, ScalableLRUCache
+ * and LRUClockCache. find(), insert(), erase() and contains() taking it do not hash the key again;
+ * ScalableLRUCache routes it to its shard and looks it up there with the same hash.
+ *
+ * The hash is of the THash of the cache which made the handle, thus a handle is only passed to
+ * caches of the same THash. The key must outlive the handle.
+ */
+template <typename TKey>
+class HashedKey final {
+ public:
+  HashedKey(const TKey& key, std::size_t hash) noexcept : key_(&key), hash_(hash) {}
+
+  const TKey& key() const noexcept {
+    return *key_;
+  }
+
+  std::size_t hash() const noexcept {
+    return hash_;
+  }
+
+  // the hash index constructs the stored key from the handle.
+  operator const TKey&() const noexcept {
+    return *key_;
+  }
+
+ private:
+  const TKey* key_;
+  std::size_t hash_;
+};
+
+/**
+ * PreHashed adapts a tbb::tbb_hash_compare style THash for a hash index: a HashedKey is hashed by
+ * its stored hash and compared by its key, any other argument goes to THash.
+ */
+template <typename THash>
+struct PreHashed final {
+  using is_transparent = void;
+
+  template <typename TKeyLike>
+  std::size_t hash(const TKeyLike& key) const {
+    return hash_.hash(key);
+  }
+
+  template <typename TKey>
+  std::size_t hash(const HashedKey<TKey>& key) const noexcept {
+    return key.hash();
+  }
+
+  template <typename TLhs, typename TRhs>
+  bool equal(const TLhs& lhs, const TRhs& rhs) const {
+    return hash_.equal(unwrap(lhs), unwrap(rhs));
+  }
+
+ private:
+  template <typename TKeyLike>
+  static const TKeyLike& unwrap(const TKeyLike& key) noexcept {
+    return key;
+  }
+
+  template <typename TKey>
+  static const TKey& unwrap(const HashedKey<TKey>& key) noexcept {
+    return key.key();
+  }
+
+  THash hash_{};
+};
+
+}  // namespace LRUC
@@ -0,0 +1,60 @@
+/**
+ * @author shchang
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+namespace LRUC {
+
+/**
+ * UnitWeigher weighs every entry as 1, thus the cache capacity counts entries.
+ *
+ * A user supplied weigher is a copyable callable of the same shape, invoked as
+ * weigher(key, value) with const references and returning a non-negative arithmetic weight in
+ * arbitrary units (e.g. bytes), the cache capacity is then a budget in the same units. The result
+ * is clamped to [0, MaxWeight], see clampWeight.
+ * The weigher is called while the entry is locked, it must not access the cache and must not
+ * throw.
+ */
+struct UnitWeigher final {
+  template <typename TKey, typename TValue>
+  constexpr int operator()(const TKey&, const TValue&) const noexcept {
+    return 1;
+  }
+};
+
+/**
+ * MaxWeight bounds an entry weight and a cache capacity, thus the weight sums of a cache (capacity
+ * plus overshoot, linked weight plus the entries being admitted) do not overflow int64_t.
+ */
+inline constexpr int64_t MaxWeight = int64_t{1} << 48;
+
+/**
+ * clampWeight converts a weigher result to a weight in [0, MaxWeight] instead of truncating it:
+ * a negative (or NaN) result weighs 0, a larger one weighs MaxWeight.
+ */
+template <typename TWeight>
+constexpr int64_t clampWeight(TWeight weight) noexcept {
+  static_assert(std::is_arithmetic_v<TWeight>, "a weigher must return an arithmetic weight");
+
+  if (!(weight > 0)) {
+    return 0;
+  }
+
+  if constexpr (std::is_floating_point_v<TWeight>) {
+    return weight < static_cast<TWeight>(MaxWeight) ? static_cast<int64_t>(weight) : MaxWeight;
+  } else {
+    return static_cast<uint64_t>(weight) < static_cast<uint64_t>(MaxWeight) ? static_cast<int64_t>(weight) : MaxWeight;
+  }
+}
+
+/**
+ * IsUnitWeigher is true for UnitWeigher, caches skip re-weighing updated values with it.
+ */
+template <typename TWeigher>
+struct IsUnitWeigher : std::is_same<TWeigher, UnitWeigher> {};
+
+}  // namespace LRUC
@@ -0,0 +1,182 @@
+/**
+ * Unit Test for ARCCache with type:
+ *
+ * key type: IpAddress
+ * value type: CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>>
+ */
+#include "lrucache_common.h"
+
+#include <numeric>
+
+using namespace testing;
+
+/**
+ * Init. ARCCache with 255 entries
+ */
+class ARCCacheTest : public Test {
+protected:
+  constexpr static int LRUC_SIZE = 255;
+  constexpr static int EXPIRYTS = 42;
+
+  // IPv4 a.b.c.d with 'a' stick to 192 and 'b', 'c', 'd' has the range [from,to)
+  constexpr static int bfrom{0};
+  constexpr static int bto{1};
+  constexpr static int cfrom{0};
+  constexpr static int cto{1};
+  constexpr static int dfrom{0};
+  constexpr static int dto{255};
+
+  std::random_device rd{};
+  std::mt19937 gen{rd()};
+
+  IPARCCache lruc{LRUC_SIZE};
+
+protected:
+  void SetUp() override { ipJob(lruc, bfrom, bto, cfrom, cto, dfrom, dto, EXPIRYTS); }
+  void TearDown() override {}
+};
+
+/**
+ * Single thread access ARC cache test.
+ */
+TEST_F(ARCCacheTest, TestSingleThread) {
+  ASSERT_EQ(LRUC_SIZE, lruc.size()) << "cache.size() result not match";
+  ASSERT_EQ(LRUC_SIZE, lruc.capacity()) << "cache.capacity() result not match";
+
+  // random generator
+  std::uniform_int_distribution<> rangeD{0, 254};
+  std::uniform_int_distribution<> rangeFalseB{1, 254};
+
+  std::stringstream randomFalseIPv4;
+  randomFalseIPv4 << "192." << rangeFalseB(gen) << ".0." << rangeD(gen);
+
+  IPARCCache::ConstAccessor ca;
+  EXPECT_FALSE(lruc.find(ca, create_IpAddress(randomFalseIPv4.str())))
+      << "IP [" << randomFalseIPv4.str() << "] shouldn't be found in lru-cache";
+  EXPECT_TRUE(ca.empty());
+
+  std::stringstream randomIPv4;
+  randomIPv4 << "192.0.0." << rangeD(gen);
+  EXPECT_TRUE(lruc.find(ca, create_IpAddress(randomIPv4.str())))
+      << "IP [" << randomIPv4.str() << "] can't be found in lru-cache";
+  EXPECT_EQ(EXPIRYTS, ca->expiryTs);
+  ca.release();
+  EXPECT_TRUE(ca.empty());
+
+  EXPECT_EQ(1u, lruc.erase(create_IpAddress(randomIPv4.str())));
+  EXPECT_EQ(0u, lruc.erase(create_IpAddress(randomIPv4.str())));
+  EXPECT_EQ(LRUC_SIZE - 1, lruc.size());
+
+  EXPECT_TRUE(lruc.insert(create_IpAddress(randomIPv4.str()), create_cache_value(EXPIRYTS)));
+  EXPECT_FALSE(lruc.insert(create_IpAddress(randomIPv4.str()), create_cache_value(EXPIRYTS)));
+  EXPECT_EQ(LRUC_SIZE, lruc.size());
+
+  lruc.clear();
+  EXPECT_FALSE(lruc.find(ca, create_IpAddress(randomIPv4.str()))) << "cache cleared but IP key still can be found";
+  EXPECT_EQ(0, lruc.size()) << "cache cleared but size still show not 0";
+
+  ASSERT_EQ(LRUC_SIZE, lruc.capacity()) << "cache.capacity() result not match";
+}
+
+/**
+ * multi-threads access ARC cache test.
+ *
+ * Insert/find/erase new IPs into a fully filled cache concurrently, the size never exceeds the capacity.
+ */
+TEST_F(ARCCacheTest, TestMultiThread) {
+  std::vector<int> keys(LRUC_SIZE * 4);
+  std::iota(keys.begin(), keys.end(), 0);
+
+  tbb::parallel_for_each(begin(keys), end(keys), [this](int key) {
+    auto ip = create_IpAddress(getIPv4(1 + key / 255, 0, key % 255));
+
+    lruc.insert(ip, create_cache_value(EXPIRYTS));
+    IPARCCache::ConstAccessor ca;
+    if (lruc.find(ca, ip)) {
+      EXPECT_EQ(EXPIRYTS, ca->expiryTs);
+    }
+    EXPECT_GE(LRUC_SIZE, lruc.size());
+
+    if (key % 2) {
+      lruc.erase(ip);
+    }
+  });
+
+  EXPECT_GE(LRUC_SIZE, lruc.size()) << "cache.size() result not match";
+}
+
+
+/**
+ * Keys seen twice (T2) survive a one-off scan, which only cycles through T1.
+ */
+TEST(ARCCacheTest_Adaptive, ScanResistant) {
+  constexpr int capacity = 100;
+  constexpr int hotCnt = 50;
+  LRUC::ARCCache<int, int> lruc{capacity};
+
+  EXPECT_EQ(hotCnt, scanHotKeys(lruc, capacity, hotCnt, 2)) << "scan flushed a hot key";
+  // one-off keys never hit a ghost list, the T1 target does not move.
+  EXPECT_EQ(0u, lruc.recency_target());
+  EXPECT_EQ(static_cast<size_t>(capacity), lruc.size());
+}
+
+/**
+ * A B1 ghost hit grows the T1 target, a B2 ghost hit shrinks it, the re-inserted key goes to T2.
+ */
+TEST(ARCCacheTest_Adaptive, RecencyTargetAdapts) {
+  constexpr int capacity = 10;
+  LRUC::ARCCache<int, int> lruc{capacity};
+  LRUC::ARCCache<int, int>::ConstAccessor ca;
+
+  // T1: 5..9, T2: 0..4
+  for (int key = 0; key < capacity; key++) {
+    lruc.insert(key, key);
+  }
+  for (int key = 0; key < 5; key++) {
+    EXPECT_TRUE(lruc.find(ca, key));
+  }
+
+  // T1: 10..14, B1: 5..9
+  for (int key = 10; key < 15; key++) {
+    lruc.insert(key, key);
+  }
+  EXPECT_FALSE(lruc.find(ca, 5));
+  EXPECT_EQ(0u, lruc.recency_target());
+
+  EXPECT_TRUE(lruc.insert(5, 5));
+  EXPECT_EQ(1u, lruc.recency_target());
+  EXPECT_TRUE(lruc.find(ca, 5));
+
+  // T1 shrinks to the target, then T2 is evicted into B2.
+  EXPECT_TRUE(lruc.insert(6, 6));
+  EXPECT_TRUE(lruc.insert(7, 7));
+  EXPECT_EQ(3u, lruc.recency_target());
+  EXPECT_FALSE(lruc.find(ca, 0));
+
+  EXPECT_TRUE(lruc.insert(0, 0));
+  EXPECT_GT(3u, lruc.recency_target());
+  EXPECT_TRUE(lruc.find(ca, 0));
+  EXPECT_EQ(static_cast<size_t>(capacity), lruc.size());
+}
+
+/**
+ * peek() copies the value without moving the entry to T2, and a ghost is absent for contains().
+ */
+TEST(ARCCacheTest_Peek, NoPromotion) {
+  LRUC::ARCCache<int, int> lruc{2};
+  LRUC::ARCCache<int, int>::ConstAccessor ca;
+
+  lruc.insert(1, 1);
+  lruc.insert(2, 2);
+  ASSERT_TRUE(lruc.peek(ca, 1));
+  EXPECT_EQ(1, *ca);
+  EXPECT_TRUE(lruc.contains(2));
+  EXPECT_FALSE(lruc.peek(ca, 3));
+
+  // 1 is still the LRU of T1, evicted into B1.
+  lruc.insert(3, 3);
+  EXPECT_FALSE(lruc.contains(1));
+  EXPECT_FALSE(lruc.peek(ca, 1));
+  EXPECT_TRUE(lruc.peek(ca, 2));
+  EXPECT_EQ(2, *ca);
+}
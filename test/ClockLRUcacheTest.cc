@@ -356,3 +356,277 @@ TEST(ClockLRUCacheTest_Same_Key, ConcurrentInsertAndPop) {
 
   ASSERT_EQ(1, lruc.size()) << "cache.size() is not 1";
 }
+
+/**
+ * Test rvalue insert, emplace and try_emplace with std::string value.
+ */
+TEST(ClockLRUCacheTest_Emplace, MoveAndEmplace) {
+  using StringCache = LRUC::LRUClockCache<int, std::string>;
+  StringCache lruc{42};
+
+  std::string value(64, 'm');
+  EXPECT_TRUE(lruc.insert(1, std::move(value)));
+  EXPECT_TRUE(value.empty()) << "value not moved into the cache";
+
+  EXPECT_TRUE(lruc.emplace(2, 64, 'e'));
+  EXPECT_FALSE(lruc.emplace(2, 64, 'x')) << "emplace overwrote an existing key";
+
+  std::string arg = "kept";
+  EXPECT_FALSE(lruc.try_emplace(2, std::move(arg)));
+  EXPECT_EQ("kept", arg) << "try_emplace consumed args of an existing key";
+
+  EXPECT_EQ(std::string(64, 'm'), lruc.find(1).value());
+  EXPECT_EQ(std::string(64, 'e'), lruc.find(2).value());
+  EXPECT_EQ(2, lruc.size());
+}
+
+/**
+ * Test erased key re-inserted into another slot survives the clock sweep over its stale slot.
+ */
+TEST(ClockLRUCacheTest_Same_Key, EraseReinsert) {
+  LRUC::LRUClockCache<int, int> lruc{4};
+
+  // slots: [3, 4, 1, 2]
+  for (int i = 1; i <= 4; i++) {
+    lruc.insert(i, i);
+  }
+
+  // 3 is re-inserted into the slot of 1, its former slot keeps the stale key.
+  lruc.erase(3);
+  lruc.insert(3, 42);
+
+  // 6 takes the stale slot of 3.
+  lruc.insert(5, 5);
+  lruc.insert(6, 6);
+
+  auto found = lruc.find(3);
+  ASSERT_TRUE(found.has_value()) << "re-inserted key dropped by the sweep of its stale slot";
+  EXPECT_EQ(42, *found);
+  EXPECT_EQ(4, lruc.size());
+}
+
+/**
+ * Test insert_or_assign and update modify the value in place.
+ */
+TEST(ClockLRUCacheTest_Upsert, InsertOrAssignUpdate) {
+  IPClockLRUCache lruc{42};
+  auto key = create_IpAddress("192.168.1.1");
+
+  EXPECT_TRUE(lruc.insert_or_assign(key, create_cache_value(1)));
+  EXPECT_FALSE(lruc.insert_or_assign(key, create_cache_value(2)));
+  EXPECT_TRUE(lruc.update(key, [](auto& value) { value.denialInfoCode = 7; }));
+  EXPECT_FALSE(lruc.update(create_IpAddress("192.168.1.2"), [](auto& value) { value.denialInfoCode = 7; }));
+
+  auto found = lruc.find(key);
+  ASSERT_TRUE(found.has_value());
+  EXPECT_EQ(2, found->expiryTs);
+  EXPECT_EQ(7, found->denialInfoCode);
+  EXPECT_EQ(1, lruc.size());
+}
+
+/**
+ * Weighted capacity: the sweep continues until enough weight is freed, slots bound the entries.
+ */
+TEST(ClockLRUCacheTest_Weigher, ByteBudget) {
+  constexpr size_t LRUC_SIZE = 100;
+  LRUC::LRUClockCache<int, std::string, std::hash<int>, std::equal_to<int>, StringWeigher> lruc{LRUC_SIZE, 16};
+
+  for (int i = 0; i < 10; i++) {
+    lruc.insert(i, std::string(10, 'a'));
+  }
+  EXPECT_EQ(LRUC_SIZE, lruc.weight());
+  EXPECT_EQ(10, lruc.size());
+
+  // 35 bytes need four 10 bytes victims.
+  lruc.insert(10, std::string(35, 'b'));
+  EXPECT_EQ(95u, lruc.weight());
+  EXPECT_EQ(7, lruc.size());
+  EXPECT_TRUE(lruc.find(10).has_value());
+
+  // heavier than the capacity, not stored.
+  lruc.insert(11, std::string(LRUC_SIZE + 1, 'c'));
+  EXPECT_FALSE(lruc.find(11).has_value());
+  EXPECT_EQ(95u, lruc.weight());
+
+  // growing an entry past the capacity evicts others.
+  EXPECT_TRUE(lruc.update(10, [](std::string& found) { found.append(20, 'd'); }));
+  EXPECT_LE(lruc.weight(), LRUC_SIZE);
+
+  size_t weight = 0;
+  int kept = -1;
+  size_t keptWeight = 0;
+  for (int i = 0; i <= 10; i++) {
+    if (auto found = lruc.find(i)) {
+      weight += found->size();
+      kept = i;
+      keptWeight = found->size();
+    }
+  }
+  EXPECT_EQ(weight, lruc.weight()) << "weight out of sync with the stored entries";
+
+  ASSERT_NE(-1, kept);
+  EXPECT_EQ(1u, lruc.erase(kept));
+  EXPECT_EQ(weight - keptWeight, lruc.weight());
+}
+
+/**
+ * Removal listener: sweep victims, erased and replaced entries are notified outside the lock.
+ */
+TEST(ClockLRUCacheTest_Listener, RemovalCauses) {
+  using Notification = LRUC::RemovalNotification<int, int>;
+  LRUC::LRUClockCache<int, int> lruc{3};
+
+  std::vector<Notification> removed;
+  lruc.set_removal_listener([&lruc, &removed](std::vector<Notification>& batch) {
+    // delivered outside the lock, the cache is accessible.
+    EXPECT_LE(lruc.size(), 3u);
+    std::move(batch.begin(), batch.end(), std::back_inserter(removed));
+  });
+
+  for (int i = 1; i <= 4; i++) {
+    lruc.insert(i, i * 10);
+  }
+  ASSERT_EQ(1u, removed.size());
+  EXPECT_TRUE(removed[0].cause == LRUC::RemovalCause::Size);
+  EXPECT_EQ(removed[0].key * 10, removed[0].value);
+  EXPECT_FALSE(lruc.find(removed[0].key));
+
+  const int live = removed[0].key == 4 ? 1 : 4;
+  EXPECT_FALSE(lruc.insert_or_assign(live, 7));
+  ASSERT_EQ(2u, removed.size());
+  EXPECT_TRUE(removed[1].cause == LRUC::RemovalCause::Replaced);
+  EXPECT_EQ(live * 10, removed[1].value);
+
+  EXPECT_EQ(1u, lruc.erase(live));
+  ASSERT_EQ(3u, removed.size());
+  EXPECT_TRUE(removed[2].cause == LRUC::RemovalCause::Explicit);
+  EXPECT_EQ(7, removed[2].value);
+}
+
+/**
+ * Key-like lookups of a transparent hash and key equality, and contains() does not set the
+ * survive bit.
+ */
+TEST(ClockLRUCacheTest_Transparent, KeyLikeLookup) {
+  LRUC::LRUClockCache<std::string, int, LRUC::StringHash, std::equal_to<>> lruc{2};
+  const std::string key = "transparent";
+  EXPECT_TRUE(lruc.insert(key, 42));
+
+  auto found = lruc.find(std::string_view{key});
+  ASSERT_TRUE(found.has_value());
+  EXPECT_EQ(42, *found);
+  EXPECT_TRUE(lruc.contains("transparent"));
+  EXPECT_FALSE(lruc.contains(std::string_view{key}.substr(1)));
+  EXPECT_EQ(1u, lruc.erase(std::string_view{key}));
+  EXPECT_FALSE(lruc.contains(key));
+
+  // slots: ["b", "a"], the sweep passes "a" first unless it is marked.
+  lruc.insert("a", 1);
+  lruc.insert("b", 2);
+  EXPECT_TRUE(lruc.contains("a"));
+  lruc.insert("c", 3);
+  EXPECT_FALSE(lruc.contains("a"));
+  EXPECT_TRUE(lruc.contains("b"));
+  EXPECT_EQ(2, lruc.size());
+
+  IPClockLRUCache iplruc{8};
+  const auto ip = create_IpAddress("192.168.1.1");
+  EXPECT_TRUE(iplruc.insert(ip, create_cache_value(1)));
+  ASSERT_TRUE(iplruc.find(ip.v4.sin_addr.s_addr).has_value());
+  EXPECT_FALSE(iplruc.contains(create_IpAddress("192.168.1.2").v4.sin_addr.s_addr));
+  EXPECT_EQ(1u, iplruc.erase(ip.v4.sin_addr.s_addr));
+  EXPECT_EQ(0, iplruc.size());
+}
+
+/**
+ * peek() copies the value without setting the survive bit, thus the sweep passes it like an
+ * untouched slot, unlike find().
+ */
+TEST(ClockLRUCacheTest_Peek, NoSurviveBit) {
+  LRUC::LRUClockCache<std::string, int, LRUC::StringHash, std::equal_to<>, LRUC::UnitWeigher, LRUC::ThreadStats>
+    lruc{2};
+
+  // slots: ["b", "a"], the sweep passes "a" first unless it is marked.
+  lruc.insert("a", 1);
+  lruc.insert("b", 2);
+  EXPECT_EQ(1, lruc.peek("a").value_or(0));
+  EXPECT_EQ(2, lruc.peek(std::string{"b"}).value_or(0));
+  const std::string b = "b";
+  EXPECT_EQ(2, lruc.peek(decltype(lruc)::hashed_key(b)).value_or(0));
+  EXPECT_FALSE(lruc.peek(std::string_view{"c"}).has_value());
+
+  lruc.insert("c", 3);
+  EXPECT_FALSE(lruc.peek("a").has_value());
+  EXPECT_EQ(0u, lruc.stats().hits);
+  EXPECT_EQ(0u, lruc.stats().misses);
+
+  // find() marks "b", the sweep passes "c" instead.
+  EXPECT_TRUE(lruc.find("b").has_value());
+  lruc.insert("d", 4);
+  EXPECT_TRUE(lruc.contains("b"));
+  EXPECT_FALSE(lruc.contains("c"));
+}
+
+/**
+ * HashedKey handles: the key hashed once is inserted, found and erased.
+ */
+TEST(ClockLRUCacheTest_HashedKey, FindInsertErase) {
+  IPClockLRUCache lruc{8};
+  const auto key = create_IpAddress("192.168.1.1");
+  const auto hashed = IPClockLRUCache::hashed_key(key);
+
+  EXPECT_TRUE(lruc.insert(hashed, create_cache_value(1)));
+  EXPECT_FALSE(lruc.insert(key, create_cache_value(2)));
+
+  auto found = lruc.find(hashed);
+  ASSERT_TRUE(found.has_value());
+  EXPECT_EQ(1, found->expiryTs);
+  EXPECT_TRUE(lruc.contains(hashed));
+  EXPECT_EQ(1u, lruc.erase(hashed));
+  EXPECT_FALSE(lruc.find(key).has_value());
+  EXPECT_EQ(0, lruc.size());
+}
+
+/**
+ * ThreadStats counts the lookups and the swept evictions.
+ */
+TEST(ClockLRUCacheTest_Stats, CountHitsMissesEvictions) {
+  LRUC::LRUClockCache<int, int, std::hash<int>, std::equal_to<int>, LRUC::UnitWeigher, LRUC::ThreadStats> lruc{2};
+
+  lruc.insert(1, 1);
+  lruc.insert(2, 2);
+  lruc.insert(3, 3);
+
+  int hits = 0;
+  for (int key = 1; key <= 3; key++) {
+    hits += lruc.find(key).has_value();
+  }
+  EXPECT_FALSE(lruc.find(4).has_value());
+
+  const LRUC::CacheStats stats = lruc.stats();
+  EXPECT_EQ(1u, stats.evictions);
+  EXPECT_EQ(2, hits);
+  EXPECT_EQ(2u, stats.hits);
+  EXPECT_EQ(2u, stats.misses);
+  EXPECT_EQ(0u, stats.skipped_promotions);
+}
+
+/**
+ * LatencyStats<1> times every lookup, insert, erase and swept eviction.
+ */
+TEST(ClockLRUCacheTest_Stats, Latency) {
+  LRUC::LRUClockCache<int, int, std::hash<int>, std::equal_to<int>, LRUC::UnitWeigher, LRUC::LatencyStats<1>> lruc{2};
+
+  lruc.insert(1, 1);
+  lruc.insert(2, 2);
+  lruc.insert(3, 3);
+  lruc.find(2);
+  lruc.find(4);
+  lruc.erase(3);
+
+  const LRUC::LatencySnapshot latency = lruc.latency();
+  EXPECT_EQ(2u, latency[LRUC::LatencyOp::Find].count());
+  EXPECT_EQ(3u, latency[LRUC::LatencyOp::Insert].count());
+  EXPECT_EQ(1u, latency[LRUC::LatencyOp::Erase].count());
+  EXPECT_LE(1u, latency[LRUC::LatencyOp::Eviction].count());
+}
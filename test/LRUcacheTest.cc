@@ -5,9 +5,16 @@
  * value type: CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>>
  */
 #include "lrucache_common.h"
+#include <tbb/parallel_for.h>
+#include <cmath>
+#include <functional>
+#include <future>
+#include <limits>
 
 using namespace testing;
 
+using IPVec = std::vector<std::tuple<IpAddress, CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>>>;
+
 /**
  * Init. LRUCache with 255 entries
  */
@@ -77,6 +84,112 @@ TEST_F(LRUCacheTest, TestSingleThread) {
   ASSERT_EQ(LRUC_SIZE, lruc.capacity()) << "cache.capacity() result not match";
 }
 
+/**
+ * find_visit reads the stored value in place.
+ */
+TEST_F(LRUCacheTest, TestFindVisit) {
+  int64_t expiryTs = 0;
+  EXPECT_TRUE(lruc.find_visit(create_IpAddress("192.0.0.1"), [&](const auto& value) { expiryTs = value.expiryTs; }));
+  EXPECT_EQ(EXPIRYTS, expiryTs);
+
+  bool visited = false;
+  EXPECT_FALSE(lruc.find_visit(create_IpAddress("192.1.0.1"), [&](const auto&) { visited = true; }));
+  EXPECT_FALSE(visited) << "visitor invoked for a key not in cache";
+
+  // visited keys are promoted, thus 192.0.0.2 is the least-recently used one.
+  lruc.find_visit(create_IpAddress("192.0.0.0"), [](const auto&) {});
+  lruc.insert(create_IpAddress("192.1.0.1"), create_cache_value(EXPIRYTS));
+
+  IPLRUCache::ConstAccessor ca;
+  EXPECT_TRUE(lruc.find(ca, create_IpAddress("192.0.0.0")));
+  EXPECT_TRUE(lruc.find(ca, create_IpAddress("192.0.0.1")));
+  EXPECT_FALSE(lruc.find(ca, create_IpAddress("192.0.0.2")));
+}
+
+/**
+ * insert_or_assign and update modify the value in place and promote the key.
+ */
+TEST_F(LRUCacheTest, TestInsertOrAssignUpdate) {
+  constexpr int NEW_EXPIRYTS = 4242;
+
+  // 192.0.0.0 is the least-recently used key, assigning promotes it.
+  EXPECT_FALSE(lruc.insert_or_assign(create_IpAddress("192.0.0.0"), create_cache_value(NEW_EXPIRYTS)));
+  EXPECT_EQ(LRUC_SIZE, lruc.size());
+
+  EXPECT_TRUE(lruc.update(create_IpAddress("192.0.0.1"), [](auto& value) { value.expiryTs++; }));
+  EXPECT_FALSE(lruc.update(create_IpAddress("192.1.0.1"), [](auto& value) { value.expiryTs++; }));
+
+  // new key evicts 192.0.0.2, the least-recently used key after the promotions.
+  EXPECT_TRUE(lruc.insert_or_assign(create_IpAddress("192.1.0.1"), create_cache_value(NEW_EXPIRYTS)));
+  EXPECT_EQ(LRUC_SIZE, lruc.size());
+
+  IPLRUCache::ConstAccessor ca;
+  ASSERT_TRUE(lruc.find(ca, create_IpAddress("192.0.0.0")));
+  EXPECT_EQ(NEW_EXPIRYTS, ca->expiryTs);
+  ASSERT_TRUE(lruc.find(ca, create_IpAddress("192.0.0.1")));
+  EXPECT_EQ(EXPIRYTS + 1, ca->expiryTs);
+  ASSERT_TRUE(lruc.find(ca, create_IpAddress("192.1.0.1")));
+  EXPECT_EQ(NEW_EXPIRYTS, ca->expiryTs);
+  EXPECT_FALSE(lruc.find(ca, create_IpAddress("192.0.0.2")));
+}
+
+/**
+ * multi_find and multi_insert process a batch with the same semantics as find and insert.
+ */
+TEST_F(LRUCacheTest, TestMultiFindInsert) {
+  std::vector<IpAddress> keys{
+    create_IpAddress("192.0.0.0"), create_IpAddress("192.1.0.1"), create_IpAddress("192.0.0.1")};
+  std::vector<std::optional<CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>>> results;
+
+  // hits are promoted, thus 192.0.0.2 is the least-recently used key.
+  EXPECT_EQ(2, lruc.multi_find(keys.begin(), keys.end(), std::back_inserter(results)));
+  ASSERT_EQ(keys.size(), results.size());
+  ASSERT_TRUE(results[0]);
+  EXPECT_EQ(EXPIRYTS, results[0]->expiryTs);
+  EXPECT_FALSE(results[1]);
+  EXPECT_TRUE(results[2]);
+
+  IPVec batch;
+  ipJob(batch, 1, 2, 0, 1, 1, 4, EXPIRYTS + 1);
+  batch.emplace_back(create_IpAddress("192.0.0.5"), create_cache_value(0));
+
+  // existing 192.0.0.5 is kept, three new keys evict 192.0.0.2 - 192.0.0.4.
+  EXPECT_EQ(3, lruc.multi_insert(batch.begin(), batch.end()));
+  EXPECT_EQ(LRUC_SIZE, lruc.size());
+
+  IPLRUCache::ConstAccessor ca;
+  EXPECT_TRUE(lruc.find(ca, create_IpAddress("192.0.0.0")));
+  EXPECT_TRUE(lruc.find(ca, create_IpAddress("192.0.0.1")));
+  EXPECT_FALSE(lruc.find(ca, create_IpAddress("192.0.0.2")));
+  EXPECT_FALSE(lruc.find(ca, create_IpAddress("192.0.0.4")));
+  ASSERT_TRUE(lruc.find(ca, create_IpAddress("192.0.0.5")));
+  EXPECT_EQ(EXPIRYTS, ca->expiryTs);
+  ASSERT_TRUE(lruc.find(ca, create_IpAddress("192.1.0.3")));
+  EXPECT_EQ(EXPIRYTS + 1, ca->expiryTs);
+}
+
+/**
+ * set_capacity shrinks to the least-recently used entries and applies to admission immediately.
+ */
+TEST_F(LRUCacheTest, TestSetCapacity) {
+  constexpr int NEW_SIZE = 100;
+
+  lruc.set_capacity(NEW_SIZE);
+  EXPECT_EQ(NEW_SIZE, lruc.capacity());
+  EXPECT_EQ(NEW_SIZE, lruc.size());
+
+  IPLRUCache::ConstAccessor ca;
+  EXPECT_FALSE(lruc.find(ca, create_IpAddress(getIPv4(0, 0, LRUC_SIZE - NEW_SIZE - 1))));
+  EXPECT_TRUE(lruc.find(ca, create_IpAddress(getIPv4(0, 0, LRUC_SIZE - NEW_SIZE))));
+
+  lruc.insert(create_IpAddress("192.1.0.1"), create_cache_value(EXPIRYTS));
+  EXPECT_EQ(NEW_SIZE, lruc.size());
+
+  lruc.set_capacity(LRUC_SIZE);
+  lruc.insert(create_IpAddress("192.1.0.2"), create_cache_value(EXPIRYTS));
+  EXPECT_EQ(NEW_SIZE + 1, lruc.size());
+}
+
 /**
  * multi-threads access LRU cache test.
  *
@@ -373,3 +486,1043 @@ TEST(LRUCacheTest_Same_Key, ConcurrentInsertAndPop) {
 
   ASSERT_EQ(1, lruc.size()) << "cache.size() is not 1";
 }
+
+namespace {
+
+/**
+ * ListGate stalls the first allocation made after arm() until open(), see GatedAllocator.
+ */
+struct ListGate final {
+  std::atomic<bool> armed{false};
+  std::promise<void> entered{};
+  std::promise<void> released{};
+
+  void arm() { armed.store(true); }
+  void open() { released.set_value(); }
+};
+
+/**
+ * GatedAllocator is std::allocator stalling on the armed ListGate.
+ * multi_insert allocates a new LRU list node chunk while holding the list lock, thus an armed
+ * gate holds the list lock from the test.
+ */
+template <typename T>
+struct GatedAllocator final : std::allocator<T> {
+  using is_always_equal = std::false_type;
+
+  template <typename U>
+  struct rebind {
+    using other = GatedAllocator<U>;
+  };
+
+  explicit GatedAllocator(ListGate& gate) noexcept : gate_{gate} {}
+
+  template <typename U>
+  GatedAllocator(const GatedAllocator<U>& other) noexcept : gate_{other.gate_} {}
+
+  T* allocate(size_t n) {
+    ListGate& gate = gate_.get();
+    if (gate.armed.exchange(false)) {
+      gate.entered.set_value();
+      gate.released.get_future().wait();
+    }
+
+    return std::allocator<T>::allocate(n);
+  }
+
+  std::reference_wrapper<ListGate> gate_;
+};
+
+template <typename T, typename U>
+bool operator==(const GatedAllocator<T>& lhs, const GatedAllocator<U>& rhs) noexcept {
+  return &lhs.gate_.get() == &rhs.gate_.get();
+}
+
+template <typename T, typename U>
+bool operator!=(const GatedAllocator<T>& lhs, const GatedAllocator<U>& rhs) noexcept {
+  return !(lhs == rhs);
+}
+
+using GatedCache = LRUC::LRUCache<int, int, tbb::tbb_hash_compare<int>, GatedAllocator<std::pair<const int, int>>>;
+
+/**
+ * hitHotUnderListLock records hits on the least-recently used key while another thread holds
+ * the list lock, then inserts one key over the capacity.
+ *
+ * Returns whether the hot key survived the eviction.
+ */
+bool hitHotUnderListLock(GatedCache::Promotion promotion) {
+  constexpr int hot = 1;
+  constexpr int cold = 2;
+  ListGate gate;
+  GatedCache lruc{2, 8, promotion, GatedAllocator<std::pair<const int, int>>(gate)};
+
+  // hot is the least-recently used.
+  lruc.insert(hot, hot);
+  lruc.insert(cold, cold);
+
+  // a batch of an existing key inserts nothing, but allocates a new node chunk under the list lock.
+  std::vector<std::pair<int, int>> batch(2048, std::pair{cold, cold});
+  gate.arm();
+  std::thread holder([&] { lruc.multi_insert(batch.begin(), batch.end()); });
+  gate.entered.get_future().wait();
+
+  for (int i = 0; i < 4; i++) {
+    GatedCache::ConstAccessor ca;
+    EXPECT_TRUE(lruc.find(ca, hot));
+  }
+
+  gate.open();
+  holder.join();
+
+  lruc.insert(3, 3);
+  EXPECT_EQ(2, lruc.size());
+
+  return lruc.contains(hot);
+}
+
+}  // namespace
+
+/**
+ * Test hits recorded while the list lock is taken, buffered promotion against try-lock promotion.
+ * Try-lock promotion drops the hits thus the hot key is evicted, buffered promotion replays them
+ * before the eviction thus the hot key stays resident.
+ */
+TEST(LRUCacheTest_Promotion, BufferedUnderListLock) {
+  EXPECT_FALSE(hitHotUnderListLock(GatedCache::Promotion::TryLock)) << "try-lock promotion did not drop the hits";
+  EXPECT_TRUE(hitHotUnderListLock(GatedCache::Promotion::Buffered)) << "buffered promotion lost the hits";
+}
+
+/**
+ * A throttled hit is not promoted: by the most-recently used fraction of the list, by the time
+ * window since the last append, and for a batch of throttled hits.
+ */
+TEST(LRUCacheTest_Promotion, Throttle) {
+  using StatsLRUCache = LRUC::LRUCache<int,
+                                       int,
+                                       tbb::tbb_hash_compare<int>,
+                                       LRUC::SlabAllocator<std::pair<const int, int>>,
+                                       LRUC::UnitWeigher,
+                                       LRUC_DEFAULT_HASH_INDEX,
+                                       LRUC::ThreadStats>;
+  StatsLRUCache::ConstAccessor ca;
+
+  // list: 1, 2, 3, 4; 3 and 4 are the most-recently used half.
+  StatsLRUCache byFraction{4, 8, StatsLRUCache::Promotion::TryLock};
+  byFraction.set_promotion_throttle({0.5, std::chrono::milliseconds{0}});
+  for (int key = 1; key <= 4; key++) {
+    byFraction.insert(key, key);
+  }
+
+  EXPECT_TRUE(byFraction.find(ca, 4));
+  EXPECT_TRUE(byFraction.find(ca, 3));
+  EXPECT_EQ(2u, byFraction.stats().skipped_promotions);
+  EXPECT_TRUE(byFraction.find(ca, 1));
+  EXPECT_EQ(2u, byFraction.stats().skipped_promotions);
+
+  // 1 was promoted, 2 is the least-recently used.
+  byFraction.insert(5, 5);
+  EXPECT_FALSE(byFraction.contains(2));
+  EXPECT_TRUE(byFraction.contains(1));
+
+  const std::vector<int> recent{5, 1};
+  std::vector<std::optional<int>> values(recent.size());
+  EXPECT_EQ(2u, byFraction.multi_find(recent.begin(), recent.end(), values.begin()));
+  EXPECT_EQ(4u, byFraction.stats().skipped_promotions);
+
+  // 1 was appended within the window, thus not promoted and evicted first.
+  StatsLRUCache byWindow{2, 8, StatsLRUCache::Promotion::TryLock};
+  byWindow.set_promotion_throttle({0.0, std::chrono::hours{1}});
+  byWindow.insert(1, 1);
+  byWindow.insert(2, 2);
+  EXPECT_TRUE(byWindow.find(ca, 1));
+  byWindow.insert(3, 3);
+  EXPECT_FALSE(byWindow.contains(1));
+  EXPECT_TRUE(byWindow.contains(2));
+  EXPECT_EQ(1u, byWindow.stats().skipped_promotions);
+
+  // not throttled, 1 is promoted.
+  StatsLRUCache unthrottled{2, 8, StatsLRUCache::Promotion::TryLock};
+  unthrottled.insert(1, 1);
+  unthrottled.insert(2, 2);
+  EXPECT_TRUE(unthrottled.find(ca, 1));
+  unthrottled.insert(3, 3);
+  EXPECT_TRUE(unthrottled.contains(1));
+  EXPECT_FALSE(unthrottled.contains(2));
+  EXPECT_EQ(0u, unthrottled.stats().skipped_promotions);
+}
+
+/**
+ * find_visit works with a value type which is not default constructible.
+ */
+TEST(LRUCacheTest_Visit, NonDefaultConstructibleValue) {
+  struct Payload {
+    explicit Payload(int v) : value(v) {}
+    int value;
+  };
+
+  LRUC::LRUCache<int, Payload> lruc{2};
+  lruc.insert(1, Payload{1});
+  lruc.insert(2, Payload{2});
+  lruc.insert(3, Payload{3});
+
+  int found = 0;
+  EXPECT_TRUE(lruc.find_visit(3, [&](const Payload& p) { found = p.value; }));
+  EXPECT_EQ(3, found);
+  EXPECT_FALSE(lruc.find_visit(1, [&](const Payload& p) { found = p.value; }));
+  EXPECT_EQ(2, lruc.size());
+}
+
+/**
+ * Test rvalue insert, emplace and try_emplace with std::string value.
+ */
+TEST(LRUCacheTest_Emplace, MoveAndEmplace) {
+  using StringCache = LRUC::LRUCache<int, std::string>;
+  StringCache lruc{42};
+
+  std::string value(64, 'm');
+  EXPECT_TRUE(lruc.insert(1, std::move(value)));
+  EXPECT_TRUE(value.empty()) << "value not moved into the cache";
+
+  EXPECT_TRUE(lruc.emplace(2, 64, 'e'));
+  EXPECT_FALSE(lruc.emplace(2, 64, 'x')) << "emplace overwrote an existing key";
+
+  std::string arg = "kept";
+  EXPECT_FALSE(lruc.try_emplace(2, std::move(arg)));
+  EXPECT_EQ("kept", arg) << "try_emplace consumed args of an existing key";
+  EXPECT_TRUE(lruc.try_emplace(3, std::move(arg)));
+
+  StringCache::ConstAccessor ca;
+  ASSERT_TRUE(lruc.find(ca, 1));
+  EXPECT_EQ(std::string(64, 'm'), *ca);
+  ASSERT_TRUE(lruc.find(ca, 2));
+  EXPECT_EQ(std::string(64, 'e'), *ca);
+  ASSERT_TRUE(lruc.find(ca, 3));
+  EXPECT_EQ("kept", *ca);
+  EXPECT_EQ(3, lruc.size());
+}
+
+/**
+ * Test concurrent update of the same key, every update is applied under the write lock.
+ */
+TEST(LRUCacheTest_Same_Key, ConcurrentUpdate) {
+  auto key = create_IpAddress("192.168.1.1");
+  std::array<unsigned char, 10000> data;
+  data.fill('o');
+  IPLRUCache lruc{42};
+
+  lruc.insert(key, create_cache_value(0));
+
+  tbb::parallel_for_each(data, [&, key](auto) { lruc.update(key, [](auto& value) { value.expiryTs++; }); });
+
+  IPLRUCache::ConstAccessor ca;
+  ASSERT_TRUE(lruc.find(ca, key));
+  EXPECT_EQ(static_cast<int64_t>(data.size()), ca->expiryTs);
+  ASSERT_EQ(1, lruc.size()) << "cache.size() result not match";
+}
+
+/**
+ * Test get_or_compute runs one loader for concurrent misses of the same key.
+ */
+TEST(LRUCacheTest_Load, SingleFlight) {
+  constexpr int followerCnt = 8;
+  constexpr int EXPIRYTS_VALUE = 42;
+  auto key = create_IpAddress("192.168.1.1");
+  IPLRUCache lruc{42};
+  std::promise<void> started;
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  std::atomic<int> followerLoads{0};
+
+  std::thread leader([&] {
+    auto value = lruc.get_or_compute(key, [&](const auto&) {
+      started.set_value();
+      released.wait();
+      return std::optional(create_cache_value(EXPIRYTS_VALUE));
+    });
+    ASSERT_TRUE(value);
+    EXPECT_EQ(EXPIRYTS_VALUE, value->expiryTs);
+  });
+  started.get_future().wait();
+
+  std::vector<std::thread> followers;
+  std::atomic<int> followerHits{0};
+  for (int i = 0; i < followerCnt; ++i) {
+    followers.emplace_back([&] {
+      auto value = lruc.get_or_compute(
+          key,
+          [&](const auto&) {
+            followerLoads++;
+            return std::optional(create_cache_value(0));
+          },
+          std::chrono::seconds(10));
+      if (value && value->expiryTs == EXPIRYTS_VALUE) {
+        followerHits++;
+      }
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  release.set_value();
+  leader.join();
+  for (auto& follower : followers) {
+    follower.join();
+  }
+
+  EXPECT_EQ(0, followerLoads.load()) << "loader ran for a key being loaded";
+  EXPECT_EQ(followerCnt, followerHits.load());
+  EXPECT_EQ(1, lruc.size());
+}
+
+/**
+ * Test get_or_compute negative results, loader failures and wait timeout.
+ */
+TEST(LRUCacheTest_Load, NegativeFailureTimeout) {
+  using IPValue = CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>;
+  auto key = create_IpAddress("192.168.1.1");
+  IPLRUCache lruc{42};
+  int loads = 0;
+
+  auto negative = lruc.get_or_compute(key, [&](const auto&) -> std::optional<IPValue> {
+    loads++;
+    return std::nullopt;
+  });
+  EXPECT_FALSE(negative);
+  EXPECT_EQ(0, lruc.size()) << "negative result cached";
+
+  EXPECT_THROW(lruc.get_or_compute(key,
+                                   [&](const auto&) -> std::optional<IPValue> {
+                                     loads++;
+                                     throw std::runtime_error("load failed");
+                                   }),
+               std::runtime_error);
+  EXPECT_EQ(0, lruc.size());
+
+  auto loaded = lruc.get_or_compute(key, [&](const auto&) {
+    loads++;
+    return std::optional(create_cache_value(1));
+  });
+  ASSERT_TRUE(loaded);
+  EXPECT_EQ(3, loads) << "failed or negative loads were not retried";
+
+  auto cached = lruc.get_or_compute(key, [&](const auto&) {
+    loads++;
+    return std::optional(create_cache_value(2));
+  });
+  ASSERT_TRUE(cached);
+  EXPECT_EQ(1, cached->expiryTs);
+  EXPECT_EQ(3, loads);
+
+  // a waiter gives up on a slow load, told apart from a negative result.
+  auto slowKey = create_IpAddress("192.168.1.2");
+  std::promise<void> started;
+  std::promise<void> release;
+  std::thread leader([&] {
+    lruc.get_or_compute(slowKey, [&](const auto&) {
+      started.set_value();
+      release.get_future().wait();
+      return std::optional(create_cache_value(3));
+    });
+  });
+  started.get_future().wait();
+
+  auto slowLoader = [](const auto&) { return std::optional(create_cache_value(4)); };
+  EXPECT_THROW(lruc.get_or_compute(slowKey, slowLoader, std::chrono::milliseconds(10)), LRUC::LoadTimeoutError);
+
+  release.set_value();
+  leader.join();
+
+  IPLRUCache::ConstAccessor ca;
+  ASSERT_TRUE(lruc.find(ca, slowKey));
+  EXPECT_EQ(3, ca->expiryTs);
+}
+
+/**
+ * Test concurrent batches larger than the capacity keep the hash-table and the LRU list in sync.
+ */
+TEST(LRUCacheTest_Batch, ConcurrentMultiInsertFind) {
+  constexpr int LRUC_SIZE = 100;
+  constexpr size_t batchSize = 64;
+  IPVec ips;
+  ipJob(ips, 0, 1, 0, 4, 0, 255, 42);
+  IPLRUCache lruc{LRUC_SIZE};
+
+  tbb::parallel_for(size_t{0}, ips.size() / batchSize, [&](size_t batch) {
+    auto first = ips.begin() + batch * batchSize;
+    lruc.multi_insert(first, first + batchSize);
+
+    std::vector<IpAddress> keys;
+    for (auto it = first; it != first + batchSize; ++it) {
+      keys.push_back(std::get<0>(*it));
+    }
+    std::vector<std::optional<CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>>> results;
+    lruc.multi_find(keys.begin(), keys.end(), std::back_inserter(results));
+  });
+
+  ASSERT_EQ(LRUC_SIZE, lruc.size());
+
+  std::vector<IpAddress> keys;
+  for (auto& ip : ips) {
+    keys.push_back(std::get<0>(ip));
+  }
+  std::vector<std::optional<CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>>> results;
+  EXPECT_EQ(LRUC_SIZE, lruc.multi_find(keys.begin(), keys.end(), std::back_inserter(results)))
+    << "hash-table and LRU list out of sync";
+}
+
+/**
+ * Test the allocator template parameter and the slab pool block reuse.
+ */
+TEST(LRUCacheTest_Allocator, StdAndSlabAllocator) {
+  using StdCache = LRUC::LRUCache<int, std::string, tbb::tbb_hash_compare<int>, std::allocator<int>>;
+  StdCache stdCache{2};
+  stdCache.insert(1, "one");
+  stdCache.insert(2, "two");
+  stdCache.insert(3, "three");
+
+  StdCache::ConstAccessor ca;
+  EXPECT_FALSE(stdCache.find(ca, 1));
+  ASSERT_TRUE(stdCache.find(ca, 3));
+  EXPECT_EQ("three", *ca);
+
+  LRUC::SlabPool pool;
+  void* block = pool.allocate(24);
+  pool.deallocate(block, 24);
+  EXPECT_EQ(block, pool.allocate(32)) << "freed block of the same size class not reused";
+
+  // a bound allocator allocates from the given pool instead of the cache-owned one.
+  using SlabCache = LRUC::LRUCache<int, int, tbb::tbb_hash_compare<int>, LRUC::SlabAllocator<int>>;
+  SlabCache slabCache{2, 8, SlabCache::Promotion::Buffered, LRUC::SlabAllocator<int>(pool)};
+  for (int i = 0; i < 64; i++) {
+    slabCache.insert(i, i);
+  }
+
+  SlabCache::ConstAccessor sca;
+  EXPECT_EQ(2, slabCache.size());
+  ASSERT_TRUE(slabCache.find(sca, 63));
+  EXPECT_EQ(63, *sca);
+}
+
+namespace {
+
+struct alignas(128) OverAligned final {
+  int value_;
+};
+
+/**
+ * AlignmentWeigher counts the values stored off their alignment, it is called on the stored value.
+ */
+struct AlignmentWeigher final {
+  int* misaligned_;
+
+  int operator()(const int&, const OverAligned& value) const {
+    if (reinterpret_cast<uintptr_t>(&value) % alignof(OverAligned) != 0) {
+      (*misaligned_)++;
+    }
+
+    return 1;
+  }
+};
+
+}  // namespace
+
+/**
+ * Test over-aligned types get their alignment from the slab allocator, directly and as cache values.
+ */
+TEST(LRUCacheTest_Allocator, OverAligned) {
+  LRUC::SlabPool pool;
+  LRUC::SlabAllocator<OverAligned> allocator(pool);
+  OverAligned* block = allocator.allocate(3);
+  EXPECT_EQ(0U, reinterpret_cast<uintptr_t>(block) % alignof(OverAligned)) << "block is not 128 byte aligned";
+  allocator.deallocate(block, 3);
+
+  int misaligned = 0;
+  using AlignedCache =
+    LRUC::LRUCache<int, OverAligned, tbb::tbb_hash_compare<int>, LRUC::SlabAllocator<int>, AlignmentWeigher>;
+  AlignedCache lruc{8, 8, AlignedCache::Promotion::Buffered, LRUC::SlabAllocator<int>(), AlignmentWeigher{&misaligned}};
+  for (int i = 0; i < 16; i++) {
+    lruc.insert(i, OverAligned{i});
+  }
+
+  AlignedCache::ConstAccessor ca;
+  ASSERT_TRUE(lruc.find(ca, 15));
+  EXPECT_EQ(15, ca->value_);
+  EXPECT_EQ(0, misaligned) << "stored values are not 128 byte aligned";
+}
+
+/**
+ * Test shrinking in chunks while other threads insert, the hash-table and LRU list stay in sync.
+ */
+TEST(LRUCacheTest_Capacity, ConcurrentShrink) {
+  constexpr int LRUC_SIZE = 4096;
+  constexpr int NEW_SIZE = 64;
+  LRUC::LRUCache<int, int> lruc{LRUC_SIZE};
+
+  for (int i = 0; i < LRUC_SIZE; i++) {
+    lruc.insert(i, i);
+  }
+
+  std::thread shrinker([&] { lruc.set_capacity(NEW_SIZE); });
+  tbb::parallel_for(LRUC_SIZE, LRUC_SIZE * 2, [&](int i) { lruc.insert(i, i); });
+  shrinker.join();
+
+  lruc.set_capacity(NEW_SIZE);
+  EXPECT_EQ(NEW_SIZE, lruc.size());
+
+  int found = 0;
+  for (int i = 0; i < LRUC_SIZE * 2; i++) {
+    decltype(lruc)::ConstAccessor ca;
+    found += lruc.find(ca, i) ? 1 : 0;
+  }
+  EXPECT_EQ(NEW_SIZE, found) << "hash-table and LRU list out of sync";
+}
+
+/**
+ * Background eviction keeps size() within capacity + overshoot, and the maintenance thread
+ * trims down to the low watermark.
+ */
+TEST(LRUCacheTest_Maintenance, BackgroundEviction) {
+  constexpr int LRUC_SIZE = 1024;
+  constexpr int OVERSHOOT = 128;
+  constexpr int SLACK = 256;
+  LRUC::LRUCache<int, int> lruc{LRUC_SIZE};
+  lruc.start_maintenance(OVERSHOOT, SLACK);
+
+  // inserting threads may each account one entry before evicting beyond the high watermark.
+  const int bound = LRUC_SIZE + OVERSHOOT + static_cast<int>(std::thread::hardware_concurrency());
+  std::atomic<int> maxSize{0};
+
+  tbb::parallel_for(0, LRUC_SIZE * 8, [&](int i) {
+    lruc.insert(i, i);
+
+    int size = lruc.size();
+    int seen = maxSize.load();
+    while (size > seen && !maxSize.compare_exchange_weak(seen, size)) {
+    }
+  });
+  EXPECT_LE(maxSize.load(), bound);
+
+  // below the high watermark no cycle is requested, cross it once and let the thread trim.
+  int next = LRUC_SIZE * 8;
+  while (lruc.size() <= LRUC_SIZE) {
+    lruc.insert(next, next);
+    next++;
+  }
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (lruc.size() > LRUC_SIZE - SLACK && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(LRUC_SIZE - SLACK, lruc.size());
+
+  lruc.stop_maintenance();
+  for (int i = next; i < next + LRUC_SIZE * 2; i++) {
+    lruc.insert(i, i);
+  }
+  EXPECT_EQ(LRUC_SIZE, lruc.size());
+
+  int found = 0;
+  for (int i = 0; i < next + LRUC_SIZE * 2; i++) {
+    decltype(lruc)::ConstAccessor ca;
+    found += lruc.find(ca, i) ? 1 : 0;
+  }
+  EXPECT_EQ(LRUC_SIZE, found) << "hash-table and LRU list out of sync";
+}
+
+/**
+ * Weighted capacity: inserts evict until enough weight is freed, updates re-weigh the value.
+ */
+TEST(LRUCacheTest_Weigher, ByteBudget) {
+  constexpr int LRUC_SIZE = 100;
+  using StringLRUCache = LRUC::LRUCache<int,
+                                        std::string,
+                                        tbb::tbb_hash_compare<int>,
+                                        LRUC::SlabAllocator<std::pair<const int, std::string>>,
+                                        StringWeigher>;
+  StringLRUCache lruc{LRUC_SIZE};
+
+  for (int i = 0; i < 10; i++) {
+    lruc.insert(i, std::string(10, 'a'));
+  }
+  EXPECT_EQ(LRUC_SIZE, lruc.weight());
+  EXPECT_EQ(10, lruc.size());
+
+  // 35 bytes need four 10 bytes victims.
+  lruc.insert(10, std::string(35, 'b'));
+  EXPECT_EQ(95, lruc.weight());
+  EXPECT_EQ(7, lruc.size());
+
+  std::string value;
+  auto copyValue = [&value](const std::string& found) { value = found; };
+  EXPECT_FALSE(lruc.find_visit(3, copyValue));
+
+  // growing 4 evicts the least-recently used 5.
+  lruc.update(4, [](std::string& found) { found.append(10, 'c'); });
+  EXPECT_EQ(95, lruc.weight());
+  EXPECT_FALSE(lruc.find_visit(5, copyValue));
+  ASSERT_TRUE(lruc.find_visit(4, copyValue));
+  EXPECT_EQ(20u, value.size());
+
+  // heavier than the capacity, evicted right away.
+  EXPECT_TRUE(lruc.insert_or_assign(11, std::string(LRUC_SIZE + 1, 'd')));
+  EXPECT_FALSE(lruc.find_visit(11, copyValue));
+  EXPECT_EQ(95, lruc.weight());
+
+  EXPECT_EQ(1u, lruc.erase(10));
+  EXPECT_EQ(60, lruc.weight());
+  EXPECT_EQ(5, lruc.size());
+}
+
+/**
+ * Weights beyond int range are kept, negative or out-of-range weigher results are clamped.
+ */
+TEST(LRUCacheTest_Weigher, WideWeights) {
+  EXPECT_EQ(0, LRUC::clampWeight(-1));
+  EXPECT_EQ(0, LRUC::clampWeight(std::nan("")));
+  EXPECT_EQ(LRUC::MaxWeight, LRUC::clampWeight(std::numeric_limits<uint64_t>::max()));
+  EXPECT_EQ(LRUC::MaxWeight, LRUC::clampWeight(1e30));
+  EXPECT_EQ(42, LRUC::clampWeight(42.5f));
+
+  constexpr int64_t LRUC_SIZE = 5'000'000'000;
+  using GBLRUCache = LRUC::LRUCache<int,
+                                    std::string,
+                                    tbb::tbb_hash_compare<int>,
+                                    LRUC::SlabAllocator<std::pair<const int, std::string>>,
+                                    GigabyteWeigher>;
+  GBLRUCache lruc{LRUC_SIZE};
+  EXPECT_EQ(LRUC_SIZE, lruc.capacity());
+
+  lruc.insert(1, "aaa");
+  lruc.insert(2, "bb");
+  EXPECT_EQ(LRUC_SIZE, lruc.weight());
+  EXPECT_EQ(2, lruc.size());
+
+  // 1 GB more evicts the least-recently used 3 GB.
+  lruc.insert(3, "c");
+  EXPECT_EQ(3'000'000'000, lruc.weight());
+  EXPECT_EQ(2, lruc.size());
+
+  // a negative weight counts as 0.
+  lruc.insert(4, "");
+  EXPECT_EQ(3'000'000'000, lruc.weight());
+  EXPECT_EQ(3, lruc.size());
+
+  lruc.set_capacity(std::numeric_limits<int64_t>::max());
+  EXPECT_EQ(LRUC::MaxWeight, lruc.capacity());
+}
+
+/**
+ * TTL: expired entries are misses, are replaced by insert and are evicted before live entries.
+ */
+TEST(LRUCacheTest_Expiry, TimingWheel) {
+  using namespace std::chrono_literals;
+  constexpr int LRUC_SIZE = 4;
+  LRUC::LRUCache<int, int> lruc{LRUC_SIZE};
+
+  // 3, 4 are the least recently used but never expire.
+  lruc.insert(3, 3);
+  lruc.insert(4, 4);
+  EXPECT_TRUE(lruc.insert(1, 1, 20ms));
+  EXPECT_TRUE(lruc.insert(2, 2, 20ms));
+
+  decltype(lruc)::ConstAccessor ca;
+  EXPECT_TRUE(lruc.find(ca, 1));
+
+  std::this_thread::sleep_for(40ms);
+  EXPECT_FALSE(lruc.find(ca, 1));
+  EXPECT_FALSE(lruc.insert(3, 30, 20ms)) << "live entry is kept";
+
+  lruc.insert(5, 5);
+  EXPECT_EQ(3, lruc.size());
+  EXPECT_TRUE(lruc.find(ca, 3));
+  EXPECT_TRUE(lruc.find(ca, 4));
+  EXPECT_FALSE(lruc.find(ca, 2));
+
+  // an expired key is inserted again.
+  EXPECT_TRUE(lruc.insert(6, 6, 20ms));
+  std::this_thread::sleep_for(40ms);
+  EXPECT_TRUE(lruc.insert(6, 60, 1h));
+  ASSERT_TRUE(lruc.find(ca, 6));
+  EXPECT_EQ(60, *ca);
+
+  // entries beyond the first wheel level cascade down before expiring.
+  LRUC::LRUCache<int, int> wheel{100};
+  for (int i = 0; i < 10; i++) {
+    wheel.insert(i, i, 150ms);
+  }
+  wheel.insert(100, 100);
+  std::this_thread::sleep_for(250ms);
+  wheel.insert(101, 101);
+  EXPECT_EQ(2, wheel.size());
+  EXPECT_FALSE(wheel.find(ca, 0));
+  EXPECT_TRUE(wheel.find(ca, 100));
+}
+
+/**
+ * Removal listener: each operation delivers its removals as one batch, with the cause.
+ */
+TEST(LRUCacheTest_Listener, RemovalCauses) {
+  using namespace std::chrono_literals;
+  using Notification = LRUC::RemovalNotification<int, int>;
+  constexpr int LRUC_SIZE = 3;
+  LRUC::LRUCache<int, int> lruc{LRUC_SIZE};
+
+  std::vector<std::vector<Notification>> batches;
+  lruc.set_removal_listener([&lruc, &batches](std::vector<Notification>& removed) {
+    // delivered outside the locks, the cache is accessible.
+    EXPECT_LE(lruc.size(), lruc.capacity());
+    batches.push_back(std::move(removed));
+  });
+
+  auto lastBatch = [&batches](size_t size, LRUC::RemovalCause cause) {
+    ASSERT_FALSE(batches.empty());
+    ASSERT_EQ(size, batches.back().size());
+    for (const Notification& notification : batches.back()) {
+      EXPECT_EQ(notification.key, notification.value % 10);
+      EXPECT_TRUE(notification.cause == cause);
+    }
+  };
+
+  for (int i = 1; i <= 4; i++) {
+    lruc.insert(i, i);
+  }
+  ASSERT_EQ(1u, batches.size());
+  lastBatch(1, LRUC::RemovalCause::Size);
+  EXPECT_EQ(1, batches.back()[0].key);
+
+  EXPECT_FALSE(lruc.insert_or_assign(2, 12));
+  lastBatch(1, LRUC::RemovalCause::Replaced);
+  EXPECT_EQ(2, batches.back()[0].value) << "old value is notified";
+
+  EXPECT_EQ(1u, lruc.erase(3));
+  lastBatch(1, LRUC::RemovalCause::Explicit);
+
+  lruc.insert(5, 5, 20ms);
+  std::this_thread::sleep_for(40ms);
+  lruc.insert(6, 6);
+  lastBatch(1, LRUC::RemovalCause::Expired);
+  EXPECT_EQ(5, batches.back()[0].key);
+
+  // a shrink removes several entries in one batch.
+  const size_t calls = batches.size();
+  lruc.set_capacity(1);
+  EXPECT_EQ(calls + 1, batches.size());
+  lastBatch(2, LRUC::RemovalCause::Size);
+
+  // no removal, no call.
+  lruc.clear();
+  EXPECT_FALSE(lruc.erase(6));
+  EXPECT_EQ(calls + 1, batches.size());
+}
+
+/**
+ * OpenHashIndex with colliding hashes: every key shares one probe sequence, thus lookups go
+ * through the collision path and erase shifts the probe chain back.
+ */
+TEST(LRUCacheTest_OpenHashIndex, CollidingHashes) {
+  struct CollidingHashCompare {
+    size_t hash(int) const {
+      return 42;
+    }
+    bool equal(int lhs, int rhs) const {
+      return lhs == rhs;
+    }
+  };
+
+  constexpr int LRUC_SIZE = 64;
+  LRUC::LRUCache<int,
+                 int,
+                 CollidingHashCompare,
+                 LRUC::SlabAllocator<std::pair<const int, int>>,
+                 LRUC::UnitWeigher,
+                 LRUC::OpenHashIndex>
+    lruc{LRUC_SIZE};
+
+  for (int i = 0; i < LRUC_SIZE; i++) {
+    EXPECT_TRUE(lruc.insert(i, i));
+  }
+  EXPECT_FALSE(lruc.insert(LRUC_SIZE / 2, 0));
+
+  for (int i = 0; i < LRUC_SIZE; i += 2) {
+    EXPECT_EQ(1u, lruc.erase(i));
+  }
+
+  decltype(lruc)::ConstAccessor ca;
+  for (int i = 0; i < LRUC_SIZE; i++) {
+    EXPECT_EQ(i % 2 == 1, lruc.find(ca, i)) << i;
+  }
+
+  // evicts through the shifted chain.
+  for (int i = LRUC_SIZE; i < LRUC_SIZE * 3; i++) {
+    lruc.insert(i, i);
+  }
+  EXPECT_EQ(LRUC_SIZE, lruc.size());
+  ASSERT_TRUE(lruc.find(ca, LRUC_SIZE * 3 - 1));
+  EXPECT_EQ(LRUC_SIZE * 3 - 1, *ca);
+  EXPECT_FALSE(lruc.find(ca, 1));
+}
+
+/**
+ * Key-like lookups of a transparent hash-compare: std::string keys by std::string_view and
+ * const char*, IpAddress keys by the IPv4 address or the in6_addr. contains() does not promote.
+ */
+TEST(LRUCacheTest_Transparent, KeyLikeLookup) {
+  LRUC::LRUCache<std::string, int, LRUC::StringHashCompare> lruc{8};
+  const std::string key = "transparent";
+  EXPECT_TRUE(lruc.insert(key, 42));
+
+  decltype(lruc)::ConstAccessor ca;
+  ASSERT_TRUE(lruc.find(ca, std::string_view{key}));
+  EXPECT_EQ(42, *ca);
+  EXPECT_TRUE(lruc.contains("transparent"));
+  EXPECT_FALSE(lruc.contains(std::string_view{key}.substr(1)));
+  EXPECT_EQ(1u, lruc.erase(std::string_view{key}));
+  EXPECT_FALSE(lruc.contains(key));
+  EXPECT_EQ(0u, lruc.erase("transparent"));
+
+  // contains() leaves "a" least recently used.
+  LRUC::LRUCache<std::string, int, LRUC::StringHashCompare> order{2};
+  order.insert("a", 1);
+  order.insert("b", 2);
+  EXPECT_TRUE(order.contains("a"));
+  order.insert("c", 3);
+  EXPECT_FALSE(order.contains("a"));
+  EXPECT_TRUE(order.contains(std::string{"b"}));
+
+  IPLRUCache iplruc{8};
+  const auto ipv4 = create_IpAddress("192.168.1.1");
+  EXPECT_TRUE(iplruc.insert(ipv4, create_cache_value(1)));
+
+  sockaddr_in6 socket6{};
+  socket6.sin6_family = AF_INET6;
+  ASSERT_EQ(1, inet_pton(AF_INET6, "2001:db8::1", &socket6.sin6_addr));
+  const IpAddress ipv6{reinterpret_cast<sockaddr*>(&socket6)};
+  EXPECT_TRUE(iplruc.insert(ipv6, create_cache_value(2)));
+
+  IPLRUCache::ConstAccessor ipca;
+  ASSERT_TRUE(iplruc.find(ipca, ipv4.v4.sin_addr.s_addr));
+  EXPECT_EQ(1, ipca->expiryTs);
+  ASSERT_TRUE(iplruc.find(ipca, socket6.sin6_addr));
+  EXPECT_EQ(2, ipca->expiryTs);
+  EXPECT_FALSE(iplruc.contains(create_IpAddress("192.168.1.2").v4.sin_addr.s_addr));
+  EXPECT_EQ(1u, iplruc.erase(socket6.sin6_addr));
+  EXPECT_FALSE(iplruc.contains(ipv6));
+  EXPECT_TRUE(iplruc.contains(ipv4));
+}
+
+/**
+ * peek() copies the value without promoting it nor counting it, for keys, key-likes and HashedKey.
+ */
+TEST(LRUCacheTest_Peek, NoPromotion) {
+  using StatsLRUCache = LRUC::LRUCache<std::string,
+                                       int,
+                                       LRUC::StringHashCompare,
+                                       LRUC::SlabAllocator<std::pair<const std::string, int>>,
+                                       LRUC::UnitWeigher,
+                                       LRUC_DEFAULT_HASH_INDEX,
+                                       LRUC::ThreadStats>;
+  StatsLRUCache lruc{2};
+  StatsLRUCache::ConstAccessor ca;
+
+  lruc.insert("a", 1);
+  lruc.insert("b", 2);
+
+  ASSERT_TRUE(lruc.peek(ca, std::string{"a"}));
+  EXPECT_EQ(1, *ca);
+  ASSERT_TRUE(lruc.peek(ca, std::string_view{"b"}));
+  EXPECT_EQ(2, *ca);
+  const std::string a = "a";
+  ASSERT_TRUE(lruc.peek(ca, StatsLRUCache::hashed_key(a)));
+  EXPECT_EQ(1, *ca);
+  EXPECT_FALSE(lruc.peek(ca, "c"));
+
+  // peek() leaves "a" least recently used.
+  lruc.insert("c", 3);
+  EXPECT_FALSE(lruc.contains("a"));
+  EXPECT_FALSE(lruc.peek(ca, "a"));
+  EXPECT_TRUE(lruc.peek(ca, "b"));
+
+  const LRUC::CacheStats stats = lruc.stats();
+  EXPECT_EQ(0u, stats.hits);
+  EXPECT_EQ(0u, stats.misses);
+}
+
+/**
+ * HashedKey handles: the key hashed once is inserted, found and erased, and interoperates with
+ * plain keys.
+ */
+TEST(LRUCacheTest_HashedKey, FindInsertErase) {
+  IPLRUCache lruc{8};
+  const auto key = create_IpAddress("192.168.1.1");
+  const auto hashed = IPLRUCache::hashed_key(key);
+  EXPECT_EQ(tbb::tbb_hash_compare<IpAddress>::hash(key), hashed.hash());
+
+  EXPECT_TRUE(lruc.insert(hashed, create_cache_value(1)));
+  EXPECT_FALSE(lruc.insert(key, create_cache_value(2)));
+  EXPECT_FALSE(lruc.insert(hashed, create_cache_value(2)));
+
+  IPLRUCache::ConstAccessor ca;
+  ASSERT_TRUE(lruc.find(ca, hashed));
+  EXPECT_EQ(1, ca->expiryTs);
+  EXPECT_TRUE(lruc.contains(hashed));
+  EXPECT_EQ(1u, lruc.erase(hashed));
+  EXPECT_FALSE(lruc.find(ca, key));
+  EXPECT_EQ(0u, lruc.erase(hashed));
+
+  // the handle of an expired key replaces it.
+  const auto expiring = create_IpAddress("192.168.1.2");
+  EXPECT_TRUE(lruc.insert(expiring, create_cache_value(3), std::chrono::milliseconds(1)));
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  EXPECT_TRUE(lruc.insert(IPLRUCache::hashed_key(expiring), create_cache_value(4)));
+  ASSERT_TRUE(lruc.find(ca, expiring));
+  EXPECT_EQ(4, ca->expiryTs);
+}
+
+/**
+ * size() sums the striped counter, size_exact() counts under the list lock; both agree once the
+ * concurrent inserts, evictions and erases are done.
+ */
+TEST(LRUCacheTest_Size, StripedAndExact) {
+  constexpr int LRUC_SIZE = 1000;
+  LRUC::LRUCache<int, int> lruc{LRUC_SIZE};
+
+  tbb::parallel_for(0, LRUC_SIZE * 4, [&lruc](int key) {
+    lruc.insert(key, key);
+    if (key % 3 == 0) {
+      lruc.erase(key);
+    }
+  });
+
+  EXPECT_GE(LRUC_SIZE, lruc.size());
+  EXPECT_EQ(lruc.size_exact(), lruc.size());
+
+  for (int key = 0; key < LRUC_SIZE * 4; key++) {
+    lruc.erase(key);
+  }
+  EXPECT_EQ(0, lruc.size());
+  EXPECT_EQ(0, lruc.size_exact());
+}
+
+/**
+ * ThreadStats counts the lookups and evictions, contains() is not counted; the default NoStats
+ * counts nothing.
+ */
+TEST(LRUCacheTest_Stats, CountAndExport) {
+  using StatsLRUCache = LRUC::LRUCache<int,
+                                       int,
+                                       tbb::tbb_hash_compare<int>,
+                                       LRUC::SlabAllocator<std::pair<const int, int>>,
+                                       LRUC::UnitWeigher,
+                                       LRUC_DEFAULT_HASH_INDEX,
+                                       LRUC::ThreadStats>;
+  StatsLRUCache lruc{2};
+  StatsLRUCache::ConstAccessor ca;
+
+  lruc.insert(1, 1);
+  lruc.insert(2, 2);
+  lruc.insert(3, 3);
+
+  EXPECT_FALSE(lruc.find(ca, 1));
+  EXPECT_TRUE(lruc.find(ca, 2));
+  EXPECT_TRUE(lruc.find_visit(3, [](const int&) {}));
+  EXPECT_TRUE(lruc.contains(2));
+
+  const std::vector<int> keys{1, 2, 3};
+  std::vector<std::optional<int>> values(keys.size());
+  EXPECT_EQ(2u, lruc.multi_find(keys.begin(), keys.end(), values.begin()));
+
+  const LRUC::CacheStats stats = lruc.stats();
+  EXPECT_EQ(4u, stats.hits);
+  EXPECT_EQ(2u, stats.misses);
+  EXPECT_EQ(1u, stats.evictions);
+  EXPECT_EQ(0u, stats.skipped_promotions);
+  EXPECT_EQ(0u, stats.lock_waits);
+  EXPECT_DOUBLE_EQ(4.0 / 6.0, stats.hit_ratio());
+
+  EXPECT_EQ(R"({"hits":4,"misses":2,"evictions":1,"skipped_promotions":0,"lock_waits":0})", stats.to_json());
+  const std::string text = stats.to_prometheus("dns", R"(cache="a")");
+  EXPECT_NE(std::string::npos, text.find("# TYPE dns_hits_total counter\ndns_hits_total{cache=\"a\"} 4\n"));
+  EXPECT_NE(std::string::npos, text.find("dns_evictions_total{cache=\"a\"} 1\n"));
+  EXPECT_NE(std::string::npos, stats.to_prometheus().find("lruc_misses_total 2\n"));
+
+  LRUC::LRUCache<int, int> plain{2};
+  plain.insert(1, 1);
+  LRUC::LRUCache<int, int>::ConstAccessor plainCa;
+  EXPECT_TRUE(plain.find(plainCa, 1));
+  EXPECT_EQ(0u, plain.stats().hits);
+}
+
+TEST(LRUCacheTest_Stats, LatencyHistogram) {
+  using LRUC::LatencyHistogram;
+
+  // exact below SubBuckets, then SubBuckets linear buckets per power of 2.
+  EXPECT_EQ(7u, LatencyHistogram::bucketOf(7));
+  EXPECT_EQ(8u, LatencyHistogram::bucketOf(8));
+  EXPECT_EQ(15u, LatencyHistogram::bucketOf(15));
+  EXPECT_EQ(16u, LatencyHistogram::bucketOf(16));
+  EXPECT_EQ(LatencyHistogram::bucketOf(16), LatencyHistogram::bucketOf(17));
+  EXPECT_EQ(17u, LatencyHistogram::bucketHigh(LatencyHistogram::bucketOf(16)));
+  EXPECT_EQ(LatencyHistogram::BucketCount - 1, LatencyHistogram::bucketOf(UINT64_MAX));
+
+  for (uint64_t ns : {uint64_t{1}, uint64_t{100}, uint64_t{1'000}, uint64_t{12'345}, uint64_t{987'654'321}}) {
+    const uint64_t high = LatencyHistogram::bucketHigh(LatencyHistogram::bucketOf(ns));
+    EXPECT_LE(ns, high);
+    EXPECT_LE(high, ns + ns / LatencyHistogram::SubBuckets);
+  }
+
+  LatencyHistogram fast;
+  LatencyHistogram slow;
+  EXPECT_EQ(0u, fast.percentile(50));
+  EXPECT_EQ(0u, fast.max());
+
+  fast.record(100, 90);
+  slow.record(10'000, 10);
+  fast += slow;
+
+  EXPECT_EQ(100u, fast.count());
+  EXPECT_EQ(LatencyHistogram::bucketHigh(LatencyHistogram::bucketOf(100)), fast.percentile(50));
+  EXPECT_EQ(LatencyHistogram::bucketHigh(LatencyHistogram::bucketOf(100)), fast.percentile(90));
+  EXPECT_EQ(LatencyHistogram::bucketHigh(LatencyHistogram::bucketOf(10'000)), fast.percentile(99));
+  EXPECT_EQ(fast.percentile(99), fast.max());
+  EXPECT_EQ(0u, fast.to_json().find("{\"count\":100,\"p50\":"));
+}
+
+/**
+ * LatencyStats<1> samples every operation, thus each histogram counts its operations.
+ */
+TEST(LRUCacheTest_Stats, Latency) {
+  using LatencyLRUCache = LRUC::LRUCache<int,
+                                         int,
+                                         tbb::tbb_hash_compare<int>,
+                                         LRUC::SlabAllocator<std::pair<const int, int>>,
+                                         LRUC::UnitWeigher,
+                                         LRUC_DEFAULT_HASH_INDEX,
+                                         LRUC::LatencyStats<1>>;
+  LatencyLRUCache lruc{2};
+  LatencyLRUCache::ConstAccessor ca;
+
+  lruc.insert(1, 1);
+  lruc.insert(2, 2);
+  lruc.insert(3, 3);
+  lruc.insert_or_assign(3, 4);
+
+  EXPECT_FALSE(lruc.find(ca, 1));
+  EXPECT_TRUE(lruc.find(ca, 2));
+  EXPECT_TRUE(lruc.find_visit(3, [](const int&) {}));
+  EXPECT_EQ(1u, lruc.erase(2));
+
+  LRUC::LatencySnapshot latency = lruc.latency();
+  EXPECT_EQ(3u, latency[LRUC::LatencyOp::Find].count());
+  EXPECT_EQ(4u, latency[LRUC::LatencyOp::Insert].count());
+  EXPECT_EQ(1u, latency[LRUC::LatencyOp::Erase].count());
+  EXPECT_EQ(1u, latency[LRUC::LatencyOp::Eviction].count());
+  EXPECT_EQ(2u, lruc.stats().hits);
+
+  latency += lruc.latency();
+  EXPECT_EQ(6u, latency[LRUC::LatencyOp::Find].count());
+  EXPECT_EQ(0u, latency.to_json().find("{\"find\":{\"count\":6,"));
+
+  LRUC::LRUCache<int, int> plain{2};
+  plain.insert(1, 1);
+  EXPECT_EQ(0u, plain.latency()[LRUC::LatencyOp::Insert].count());
+}
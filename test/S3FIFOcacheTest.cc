@@ -0,0 +1,238 @@
+/**
+ * Unit Test for S3FIFOCache with type:
+ *
+ * key type: IpAddress
+ * value type: CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>>
+ */
+#include "lrucache_common.h"
+
+#include <atomic>
+#include <numeric>
+
+using namespace testing;
+
+/**
+ * Init. S3FIFOCache with 255 entries
+ */
+class S3FIFOCacheTest : public Test {
+protected:
+  constexpr static int LRUC_SIZE = 255;
+  constexpr static int EXPIRYTS = 42;
+
+  // IPv4 a.b.c.d with 'a' stick to 192 and 'b', 'c', 'd' has the range [from,to)
+  constexpr static int bfrom{0};
+  constexpr static int bto{1};
+  constexpr static int cfrom{0};
+  constexpr static int cto{1};
+  constexpr static int dfrom{0};
+  constexpr static int dto{255};
+
+  std::random_device rd{};
+  std::mt19937 gen{rd()};
+
+  IPS3FIFOCache lruc{LRUC_SIZE};
+
+protected:
+  void SetUp() override { ipJob(lruc, bfrom, bto, cfrom, cto, dfrom, dto, EXPIRYTS); }
+  void TearDown() override {}
+};
+
+/**
+ * Single thread access S3-FIFO cache test.
+ */
+TEST_F(S3FIFOCacheTest, TestSingleThread) {
+  ASSERT_EQ(LRUC_SIZE, lruc.size()) << "cache.size() result not match";
+  ASSERT_EQ(LRUC_SIZE, lruc.capacity()) << "cache.capacity() result not match";
+
+  // random generator
+  std::uniform_int_distribution<> rangeD{0, 254};
+  std::uniform_int_distribution<> rangeFalseB{1, 254};
+
+  std::stringstream randomFalseIPv4;
+  randomFalseIPv4 << "192." << rangeFalseB(gen) << ".0." << rangeD(gen);
+
+  IPS3FIFOCache::ConstAccessor ca;
+  EXPECT_FALSE(lruc.find(ca, create_IpAddress(randomFalseIPv4.str())))
+      << "IP [" << randomFalseIPv4.str() << "] shouldn't be found in lru-cache";
+  EXPECT_TRUE(ca.empty());
+
+  std::stringstream randomIPv4;
+  randomIPv4 << "192.0.0." << rangeD(gen);
+  EXPECT_TRUE(lruc.find(ca, create_IpAddress(randomIPv4.str())))
+      << "IP [" << randomIPv4.str() << "] can't be found in lru-cache";
+  EXPECT_EQ(EXPIRYTS, ca->expiryTs);
+  ca.release();
+  EXPECT_TRUE(ca.empty());
+
+  EXPECT_EQ(1u, lruc.erase(create_IpAddress(randomIPv4.str())));
+  EXPECT_EQ(0u, lruc.erase(create_IpAddress(randomIPv4.str())));
+  EXPECT_EQ(LRUC_SIZE - 1, lruc.size());
+
+  EXPECT_TRUE(lruc.insert(create_IpAddress(randomIPv4.str()), create_cache_value(EXPIRYTS)));
+  EXPECT_FALSE(lruc.insert(create_IpAddress(randomIPv4.str()), create_cache_value(EXPIRYTS)));
+  EXPECT_EQ(LRUC_SIZE, lruc.size());
+
+  lruc.clear();
+  EXPECT_FALSE(lruc.find(ca, create_IpAddress(randomIPv4.str()))) << "cache cleared but IP key still can be found";
+  EXPECT_EQ(0, lruc.size()) << "cache cleared but size still show not 0";
+
+  ASSERT_EQ(LRUC_SIZE, lruc.capacity()) << "cache.capacity() result not match";
+}
+
+/**
+ * multi-threads access S3-FIFO cache test.
+ *
+ * Insert/find/erase new IPs into a fully filled cache concurrently, the size is within the capacity afterwards.
+ */
+TEST_F(S3FIFOCacheTest, TestMultiThread) {
+  std::vector<int> keys(LRUC_SIZE * 4);
+  std::iota(keys.begin(), keys.end(), 0);
+
+  tbb::parallel_for_each(begin(keys), end(keys), [this](int key) {
+    auto ip = create_IpAddress(getIPv4(1 + key / 255, 0, key % 255));
+
+    lruc.insert(ip, create_cache_value(EXPIRYTS));
+    IPS3FIFOCache::ConstAccessor ca;
+    if (lruc.find(ca, ip)) {
+      EXPECT_EQ(EXPIRYTS, ca->expiryTs);
+    }
+
+    if (key % 2) {
+      lruc.erase(ip);
+    }
+  });
+
+  EXPECT_GE(LRUC_SIZE, lruc.size()) << "cache.size() result not match";
+}
+
+
+/**
+ * Keys hit while in the small FIFO move to main, one-off keys are evicted from small only.
+ */
+TEST(S3FIFOCacheTest_Fifo, ScanResistant) {
+  constexpr int capacity = 100;
+  constexpr int hotCnt = 50;
+  LRUC::S3FIFOCache<int, int> lruc{capacity};
+  LRUC::S3FIFOCache<int, int>::ConstAccessor ca;
+
+  EXPECT_EQ(hotCnt, scanHotKeys(lruc, capacity, hotCnt, 2)) << "scan flushed a hot key";
+  // the hot keys were moved to main, the latest scan keys are still in small.
+  for (int key = 0; key < hotCnt; key++) {
+    EXPECT_TRUE(lruc.peek(ca, key));
+    EXPECT_EQ(key, *ca);
+  }
+  EXPECT_TRUE(lruc.contains(1000 + capacity * 5 - 1));
+}
+
+/**
+ * A key evicted from small is remembered as ghost, inserting it again goes to main thus it
+ * outlives newer one-off keys.
+ */
+TEST(S3FIFOCacheTest_Fifo, GhostReadmitsToMain) {
+  constexpr int capacity = 10;
+  LRUC::S3FIFOCache<int, int> lruc{capacity};
+  LRUC::S3FIFOCache<int, int>::ConstAccessor ca;
+
+  for (int key = 0; key <= capacity; key++) {
+    EXPECT_TRUE(lruc.insert(key, key));
+  }
+  EXPECT_FALSE(lruc.find(ca, 0));
+
+  EXPECT_TRUE(lruc.insert(0, 42));
+  for (int key = 100; key < 100 + capacity * 2; key++) {
+    lruc.insert(key, key);
+  }
+
+  EXPECT_TRUE(lruc.find(ca, 0));
+  EXPECT_EQ(42, *ca);
+  EXPECT_EQ(capacity, lruc.size());
+}
+
+/**
+ * Erased entries leave stale FIFO slots, which never evict a re-inserted key nor skew the size.
+ */
+TEST(S3FIFOCacheTest_Fifo, EraseReinsert) {
+  constexpr int capacity = 10;
+  LRUC::S3FIFOCache<int, int> lruc{capacity};
+  LRUC::S3FIFOCache<int, int>::ConstAccessor ca;
+
+  for (int round = 0; round < 3; round++) {
+    for (int key = 0; key < capacity; key++) {
+      EXPECT_TRUE(lruc.insert(key, round));
+      EXPECT_FALSE(lruc.insert(key, round));
+    }
+    EXPECT_EQ(capacity, lruc.size());
+
+    for (int key = 0; key < capacity; key++) {
+      EXPECT_EQ(1u, lruc.erase(key));
+    }
+    EXPECT_EQ(0, lruc.size());
+  }
+
+  for (int key = 0; key < capacity; key++) {
+    lruc.insert(key, key);
+  }
+  for (int key = 0; key < capacity; key++) {
+    EXPECT_TRUE(lruc.find(ca, key));
+  }
+}
+
+namespace {
+
+/**
+ * Counted counts its live instances, i.e. the values held by cache nodes.
+ */
+struct Counted final {
+  static inline std::atomic<int> live{0};
+
+  Counted() { live++; }
+  Counted(const Counted&) { live++; }
+  Counted& operator=(const Counted&) = default;
+  ~Counted() { live--; }
+};
+
+}  // namespace
+
+/**
+ * An insert/erase churn under the capacity frees the erased nodes, not only once evicting.
+ */
+TEST(S3FIFOCacheTest_Fifo, EraseChurnReclaims) {
+  constexpr int capacity = 100;
+  constexpr int keyCnt = 10;
+  {
+    LRUC::S3FIFOCache<int, Counted> lruc{capacity};
+
+    for (int i = 0; i < 100'000; i++) {
+      lruc.insert(i % keyCnt, Counted());
+      lruc.erase(i % keyCnt);
+      // erased nodes up to ReclaimPercent of the capacity, the resident keys and the temporary.
+      ASSERT_GE(capacity / 2 + keyCnt + 2, Counted::live.load()) << "erased nodes not reclaimed";
+    }
+    EXPECT_EQ(0, lruc.size());
+  }
+
+  EXPECT_EQ(0, Counted::live.load());
+}
+
+/**
+ * peek() and contains() find resident keys only.
+ */
+TEST(S3FIFOCacheTest_Peek, ResidentKeys) {
+  LRUC::S3FIFOCache<int, int> lruc{100};
+  LRUC::S3FIFOCache<int, int>::ConstAccessor ca;
+
+  for (int key = 0; key < 10; key++) {
+    lruc.insert(key, key * 2);
+  }
+
+  for (int key = 0; key < 10; key++) {
+    ASSERT_TRUE(lruc.peek(ca, key)) << key;
+    EXPECT_EQ(key * 2, *ca);
+    EXPECT_TRUE(lruc.contains(key));
+  }
+  EXPECT_FALSE(lruc.peek(ca, 10));
+  EXPECT_FALSE(lruc.contains(10));
+
+  EXPECT_EQ(1u, lruc.erase(3));
+  EXPECT_FALSE(lruc.contains(3));
+}
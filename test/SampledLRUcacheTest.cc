@@ -0,0 +1,200 @@
+/**
+ * Unit Test for SampledLRUCache with type:
+ *
+ * key type: IpAddress
+ * value type: CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>>
+ */
+#include "lrucache_common.h"
+
+#include <numeric>
+
+using namespace testing;
+
+/**
+ * Init. SampledLRUCache with 255 entries
+ */
+class SampledLRUCacheTest : public Test {
+protected:
+  constexpr static int LRUC_SIZE = 255;
+  constexpr static int EXPIRYTS = 42;
+
+  // IPv4 a.b.c.d with 'a' stick to 192 and 'b', 'c', 'd' has the range [from,to)
+  constexpr static int bfrom{0};
+  constexpr static int bto{1};
+  constexpr static int cfrom{0};
+  constexpr static int cto{1};
+  constexpr static int dfrom{0};
+  constexpr static int dto{255};
+
+  std::random_device rd{};
+  std::mt19937 gen{rd()};
+
+  IPSampledLRUCache lruc{LRUC_SIZE};
+
+protected:
+  void SetUp() override { ipJob(lruc, bfrom, bto, cfrom, cto, dfrom, dto, EXPIRYTS); }
+  void TearDown() override {}
+};
+
+/**
+ * Single thread access sampled LRU cache test.
+ */
+TEST_F(SampledLRUCacheTest, TestSingleThread) {
+  ASSERT_EQ(LRUC_SIZE, lruc.size()) << "cache.size() result not match";
+  ASSERT_EQ(LRUC_SIZE, lruc.capacity()) << "cache.capacity() result not match";
+
+  // random generator
+  std::uniform_int_distribution<> rangeD{0, 254};
+  std::uniform_int_distribution<> rangeFalseB{1, 254};
+
+  std::stringstream randomFalseIPv4;
+  randomFalseIPv4 << "192." << rangeFalseB(gen) << ".0." << rangeD(gen);
+
+  IPSampledLRUCache::ConstAccessor ca;
+  EXPECT_FALSE(lruc.find(ca, create_IpAddress(randomFalseIPv4.str())))
+      << "IP [" << randomFalseIPv4.str() << "] shouldn't be found in lru-cache";
+  EXPECT_TRUE(ca.empty());
+
+  std::stringstream randomIPv4;
+  randomIPv4 << "192.0.0." << rangeD(gen);
+  EXPECT_TRUE(lruc.find(ca, create_IpAddress(randomIPv4.str())))
+      << "IP [" << randomIPv4.str() << "] can't be found in lru-cache";
+  EXPECT_EQ(EXPIRYTS, ca->expiryTs);
+  ca.release();
+  EXPECT_TRUE(ca.empty());
+
+  EXPECT_EQ(1u, lruc.erase(create_IpAddress(randomIPv4.str())));
+  EXPECT_EQ(0u, lruc.erase(create_IpAddress(randomIPv4.str())));
+  EXPECT_EQ(LRUC_SIZE - 1, lruc.size());
+
+  EXPECT_TRUE(lruc.insert(create_IpAddress(randomIPv4.str()), create_cache_value(EXPIRYTS)));
+  EXPECT_FALSE(lruc.insert(create_IpAddress(randomIPv4.str()), create_cache_value(EXPIRYTS)));
+  EXPECT_EQ(LRUC_SIZE, lruc.size());
+
+  lruc.clear();
+  EXPECT_FALSE(lruc.find(ca, create_IpAddress(randomIPv4.str()))) << "cache cleared but IP key still can be found";
+  EXPECT_EQ(0, lruc.size()) << "cache cleared but size still show not 0";
+
+  ASSERT_EQ(LRUC_SIZE, lruc.capacity()) << "cache.capacity() result not match";
+}
+
+/**
+ * multi-threads access sampled LRU cache test.
+ *
+ * Insert/find/erase new IPs into a fully filled cache concurrently, the size never exceeds the capacity.
+ */
+TEST_F(SampledLRUCacheTest, TestMultiThread) {
+  std::vector<int> keys(LRUC_SIZE * 4);
+  std::iota(keys.begin(), keys.end(), 0);
+
+  tbb::parallel_for_each(begin(keys), end(keys), [this](int key) {
+    auto ip = create_IpAddress(getIPv4(1 + key / 255, 0, key % 255));
+
+    lruc.insert(ip, create_cache_value(EXPIRYTS));
+    IPSampledLRUCache::ConstAccessor ca;
+    if (lruc.find(ca, ip)) {
+      EXPECT_EQ(EXPIRYTS, ca->expiryTs);
+    }
+    EXPECT_GE(LRUC_SIZE, lruc.size());
+
+    if (key % 2) {
+      lruc.erase(ip);
+    }
+  });
+
+  EXPECT_GE(LRUC_SIZE, lruc.size()) << "cache.size() result not match";
+}
+
+/**
+ * Recently found keys outlive the keys left untouched, the victims are the oldest of the samples.
+ */
+TEST(SampledLRUCacheTest_Sampling, RecentlyUsedSurvive) {
+  constexpr int capacity = 100;
+  constexpr int hotCnt = 50;
+  // each eviction sees an untouched key among that many samples, but with negligible odds.
+  LRUC::SampledLRUCache<int, int> lruc{capacity, capacity};
+  LRUC::SampledLRUCache<int, int>::ConstAccessor ca;
+
+  for (int key = 0; key < capacity; key++) {
+    EXPECT_TRUE(lruc.insert(key, key));
+  }
+  for (int key = 0; key < hotCnt; key++) {
+    EXPECT_TRUE(lruc.find(ca, key));
+  }
+
+  // half as many new keys as untouched ones.
+  for (int key = 1000; key < 1000 + (capacity - hotCnt) / 2; key++) {
+    EXPECT_TRUE(lruc.insert(key, key));
+    EXPECT_GE(static_cast<size_t>(capacity), lruc.size());
+  }
+
+  for (int key = 0; key < hotCnt; key++) {
+    EXPECT_TRUE(lruc.find(ca, key)) << "evicted recently used key " << key;
+  }
+  EXPECT_EQ(static_cast<size_t>(capacity), lruc.size());
+}
+
+/**
+ * One sample per eviction still evicts occupied slots only and keeps the cache full.
+ */
+TEST(SampledLRUCacheTest_Sampling, SingleSample) {
+  constexpr int capacity = 16;
+  LRUC::SampledLRUCache<int, int> lruc{capacity, 1};
+  LRUC::SampledLRUCache<int, int>::ConstAccessor ca;
+  EXPECT_EQ(1u, lruc.sample_count());
+
+  for (int key = 0; key < capacity * 10; key++) {
+    EXPECT_TRUE(lruc.insert(key, key));
+    EXPECT_TRUE(lruc.find(ca, key));
+    EXPECT_EQ(key, *ca);
+    EXPECT_EQ(static_cast<size_t>(std::min(key + 1, capacity)), lruc.size());
+  }
+}
+
+/**
+ * Erase frees the slot of the entry, inserts take the freed slots before evicting.
+ */
+TEST(SampledLRUCacheTest_Sampling, EraseFreesSlot) {
+  constexpr int capacity = 10;
+  LRUC::SampledLRUCache<int, int> lruc{capacity};
+  LRUC::SampledLRUCache<int, int>::ConstAccessor ca;
+
+  for (int key = 0; key < capacity; key++) {
+    lruc.insert(key, key);
+  }
+  for (int key = 0; key < capacity; key += 2) {
+    EXPECT_EQ(1u, lruc.erase(key));
+  }
+  EXPECT_EQ(static_cast<size_t>(capacity / 2), lruc.size());
+
+  for (int key = 100; key < 100 + capacity / 2; key++) {
+    EXPECT_TRUE(lruc.insert(key, key));
+  }
+  for (int key = 1; key < capacity; key += 2) {
+    EXPECT_TRUE(lruc.find(ca, key)) << "key " << key << " evicted while a slot was free";
+  }
+  EXPECT_EQ(static_cast<size_t>(capacity), lruc.size());
+}
+
+/**
+ * peek() and contains() find resident keys only.
+ */
+TEST(SampledLRUCacheTest_Peek, ResidentKeys) {
+  LRUC::SampledLRUCache<int, int> lruc{100};
+  LRUC::SampledLRUCache<int, int>::ConstAccessor ca;
+
+  for (int key = 0; key < 10; key++) {
+    lruc.insert(key, key * 2);
+  }
+
+  for (int key = 0; key < 10; key++) {
+    ASSERT_TRUE(lruc.peek(ca, key)) << key;
+    EXPECT_EQ(key * 2, *ca);
+    EXPECT_TRUE(lruc.contains(key));
+  }
+  EXPECT_FALSE(lruc.peek(ca, 10));
+  EXPECT_FALSE(lruc.contains(10));
+
+  EXPECT_EQ(1u, lruc.erase(3));
+  EXPECT_FALSE(lruc.contains(3));
+}
@@ -7,6 +7,7 @@
 
 #include "lrucache_common.h"
 #include <iostream>
+#include <numeric>
 using namespace std;
 
 using namespace testing;
@@ -84,6 +85,23 @@ TEST_F(ScaleLRUCacheTest, TestSingleThread) {
   ASSERT_EQ(LRUC_SIZE, lruc.capacity()) << "cache.capacity() result not match";
 }
 
+/**
+ * find_visit reads the stored value in place from the owning shard.
+ */
+TEST_F(ScaleLRUCacheTest, TestFindVisit) {
+  // insert into an empty cache, shards are not evicting.
+  lruc.clear();
+  lruc.insert(create_IpAddress("192.0.0.1"), create_cache_value(EXPIRYTS));
+
+  int64_t expiryTs = 0;
+  EXPECT_TRUE(lruc.find_visit(create_IpAddress("192.0.0.1"), [&](const auto& value) { expiryTs = value.expiryTs; }));
+  EXPECT_EQ(EXPIRYTS, expiryTs);
+
+  bool visited = false;
+  EXPECT_FALSE(lruc.find_visit(create_IpAddress("192.1.0.1"), [&](const auto&) { visited = true; }));
+  EXPECT_FALSE(visited) << "visitor invoked for a key not in cache";
+}
+
 /**
  * multi-threads access LRU cache test.
  *
@@ -167,3 +185,427 @@ TEST_F(ScaleLRUCacheTest, TestMultiThread_1) {
   ASSERT_EQ(LRUC_SIZE, ipCnt) << "IP count not match";
   ASSERT_EQ(LRUC_SIZE, lruc.capacity()) << "cache.capacity() result not match";
 }
+
+/**
+ * Test rvalue insert, emplace and try_emplace with std::string value.
+ */
+TEST(ScaleLRUCacheTest_Emplace, MoveAndEmplace) {
+  using StringCache = LRUC::ScalableLRUCache<int, std::string>;
+  StringCache lruc{42, 4};
+
+  std::string value(64, 'm');
+  EXPECT_TRUE(lruc.insert(1, std::move(value)));
+  EXPECT_TRUE(value.empty()) << "value not moved into the cache";
+
+  EXPECT_TRUE(lruc.emplace(2, 64, 'e'));
+
+  std::string arg = "kept";
+  EXPECT_FALSE(lruc.try_emplace(2, std::move(arg)));
+  EXPECT_EQ("kept", arg) << "try_emplace consumed args of an existing key";
+
+  StringCache::ConstAccessor ca;
+  ASSERT_TRUE(lruc.find(ca, 1));
+  EXPECT_EQ(std::string(64, 'm'), *ca);
+  ASSERT_TRUE(lruc.find(ca, 2));
+  EXPECT_EQ(std::string(64, 'e'), *ca);
+}
+
+/**
+ * Test insert_or_assign and update in the owning shard.
+ */
+TEST(ScaleLRUCacheTest_Upsert, InsertOrAssignUpdate) {
+  SCALE_IPLRUCache lruc{42, 4};
+  auto key = create_IpAddress("192.168.1.1");
+
+  EXPECT_TRUE(lruc.insert_or_assign(key, create_cache_value(1)));
+  EXPECT_FALSE(lruc.insert_or_assign(key, create_cache_value(2)));
+  EXPECT_TRUE(lruc.update(key, [](auto& value) { value.denialInfoCode = 7; }));
+  EXPECT_FALSE(lruc.update(create_IpAddress("192.168.1.2"), [](auto& value) { value.denialInfoCode = 7; }));
+
+  SCALE_IPLRUCache::ConstAccessor ca;
+  ASSERT_TRUE(lruc.find(ca, key));
+  EXPECT_EQ(2, ca->expiryTs);
+  EXPECT_EQ(7, ca->denialInfoCode);
+  EXPECT_EQ(1, lruc.size());
+}
+
+/**
+ * Test get_or_compute loads into the owning shard once.
+ */
+TEST(ScaleLRUCacheTest_Load, GetOrCompute) {
+  SCALE_IPLRUCache lruc{42, 4};
+  auto key = create_IpAddress("192.168.1.1");
+  int loads = 0;
+  auto loader = [&loads](const auto&) {
+    loads++;
+    return std::optional(create_cache_value(42));
+  };
+
+  auto loaded = lruc.get_or_compute(key, loader);
+  auto cached = lruc.get_or_compute(key, loader);
+
+  ASSERT_TRUE(loaded);
+  ASSERT_TRUE(cached);
+  EXPECT_EQ(42, cached->expiryTs);
+  EXPECT_EQ(1, loads);
+  EXPECT_EQ(1, lruc.size());
+}
+
+/**
+ * Test multi_insert and multi_find group the batch by shard and keep the batch order of results.
+ */
+TEST(ScaleLRUCacheTest_Batch, MultiFindInsert) {
+  SCALE_IPLRUCache lruc{1024, 4};
+  std::vector<std::tuple<IpAddress, CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>>> batch;
+  ipJob(batch, 0, 1, 0, 1, 0, 128, 0);
+  for (size_t i = 0; i < batch.size(); i++) {
+    std::get<1>(batch[i]).expiryTs = i;
+  }
+
+  EXPECT_EQ(batch.size(), lruc.multi_insert(batch.begin(), batch.end()));
+  EXPECT_EQ(0, lruc.multi_insert(batch.begin(), batch.end()));
+
+  std::vector<IpAddress> keys;
+  for (auto& entry : batch) {
+    keys.push_back(std::get<0>(entry));
+  }
+  keys.push_back(create_IpAddress("192.1.0.1"));
+
+  std::vector<std::optional<CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>>> results;
+  EXPECT_EQ(batch.size(), lruc.multi_find(keys.begin(), keys.end(), std::back_inserter(results)));
+  ASSERT_EQ(keys.size(), results.size());
+  for (size_t i = 0; i < batch.size(); i++) {
+    ASSERT_TRUE(results[i]);
+    EXPECT_EQ(static_cast<int64_t>(i), results[i]->expiryTs) << "result not in batch order";
+  }
+  EXPECT_FALSE(results.back());
+}
+
+/**
+ * Test set_capacity redistributes the new capacity across the shards.
+ */
+TEST(ScaleLRUCacheTest_Capacity, SetCapacity) {
+  constexpr size_t NEW_SIZE = 102;
+  SCALE_IPLRUCache lruc{1024, 4};
+  ipJob(lruc, 0, 4, 0, 1, 0, 255, 42);
+
+  lruc.set_capacity(NEW_SIZE);
+  EXPECT_EQ(static_cast<long long>(NEW_SIZE), lruc.capacity());
+  EXPECT_EQ(27, lruc.capacity(0));
+  EXPECT_EQ(25, lruc.capacity(3));
+
+  for (size_t i = 0; i < lruc.shardCount(); i++) {
+    EXPECT_LE(lruc.size(i), lruc.capacity(i));
+  }
+}
+
+/**
+ * Test the weight budget is split across the shards like the capacity.
+ */
+TEST(ScaleLRUCacheTest_Weigher, ByteBudget) {
+  constexpr size_t LRUC_SIZE = 400;
+  LRUC::ScalableLRUCache<int,
+                         std::string,
+                         tbb::tbb_hash_compare<int>,
+                         LRUC::SlabAllocator<std::pair<const int, std::string>>,
+                         StringWeigher>
+    lruc{LRUC_SIZE, 4};
+
+  for (int i = 0; i < 200; i++) {
+    lruc.insert(i, std::string(10, 'a'));
+  }
+
+  int64_t weight = 0;
+  for (size_t i = 0; i < lruc.shardCount(); i++) {
+    EXPECT_LE(lruc.weight(i), lruc.capacity(i));
+    weight += lruc.weight(i);
+  }
+  EXPECT_EQ(weight, lruc.weight());
+  EXPECT_EQ(lruc.size() * 10, lruc.weight());
+  EXPECT_LE(lruc.weight(), static_cast<int64_t>(LRUC_SIZE));
+}
+
+/**
+ * Test per-shard and total weights and capacities past 2^31 are reported without truncation.
+ */
+TEST(ScaleLRUCacheTest_Weigher, WideWeights) {
+  constexpr size_t LRUC_SIZE = 10'000'000'000;
+  LRUC::ScalableLRUCache<int,
+                         std::string,
+                         tbb::tbb_hash_compare<int>,
+                         LRUC::SlabAllocator<std::pair<const int, std::string>>,
+                         GigabyteWeigher>
+    lruc{LRUC_SIZE, 2};
+
+  EXPECT_EQ(5'000'000'000, lruc.capacity(0));
+  EXPECT_EQ(5'000'000'000, lruc.capacity(1));
+  EXPECT_EQ(static_cast<int64_t>(LRUC_SIZE), lruc.capacity());
+
+  for (int i = 0; i < 8; i++) {
+    lruc.insert(i, "aa");
+  }
+
+  int64_t weight = 0;
+  for (size_t i = 0; i < lruc.shardCount(); i++) {
+    EXPECT_LE(lruc.weight(i), lruc.capacity(i));
+    EXPECT_EQ(lruc.size(i) * 2'000'000'000LL, lruc.weight(i));
+    weight += lruc.weight(i);
+  }
+  EXPECT_EQ(weight, lruc.weight());
+  EXPECT_GT(lruc.weight(), int64_t{std::numeric_limits<int>::max()});
+}
+
+/**
+ * Test every shard notifies the entries it evicts.
+ */
+TEST(ScaleLRUCacheTest_Listener, EvictionsNotified) {
+  constexpr size_t LRUC_SIZE = 400;
+  constexpr int INSERTS = 1000;
+  LRUC::ScalableLRUCache<int, int> lruc{LRUC_SIZE, 4};
+
+  std::atomic<long long> evicted{0};
+  lruc.set_removal_listener([&evicted](std::vector<LRUC::RemovalNotification<int, int>>& removed) {
+    for (const auto& notification : removed) {
+      EXPECT_TRUE(notification.cause == LRUC::RemovalCause::Size);
+      EXPECT_EQ(notification.key, notification.value);
+    }
+    evicted += static_cast<long long>(removed.size());
+  });
+
+  for (int i = 0; i < INSERTS; i++) {
+    lruc.insert(i, i);
+  }
+
+  EXPECT_EQ(INSERTS, lruc.size() + evicted.load());
+}
+
+/**
+ * ScalableLRUCache with S3FIFOCache shards.
+ */
+TEST(ScaleLRUCacheTest_S3FIFOShard, FindInsertErase) {
+  constexpr size_t LRUC_SIZE = 400;
+  LRUC::ScalableLRUCache<int,
+                         int,
+                         tbb::tbb_hash_compare<int>,
+                         LRUC::SlabAllocator<std::pair<const int, int>>,
+                         LRUC::UnitWeigher,
+                         LRUC::S3FIFOShard>
+    lruc{LRUC_SIZE, 4};
+  ASSERT_EQ(static_cast<long long>(LRUC_SIZE), lruc.capacity());
+
+  std::vector<int> keys(LRUC_SIZE * 4);
+  std::iota(keys.begin(), keys.end(), 0);
+
+  tbb::parallel_for_each(begin(keys), end(keys), [&lruc](int key) {
+    EXPECT_TRUE(lruc.insert(key, key));
+
+    decltype(lruc)::ConstAccessor ca;
+    if (lruc.find(ca, key)) {
+      EXPECT_EQ(key, *ca);
+    }
+  });
+  EXPECT_GE(static_cast<long long>(LRUC_SIZE), lruc.size());
+
+  decltype(lruc)::ConstAccessor ca;
+  EXPECT_TRUE(lruc.insert(-1, 42));
+  EXPECT_TRUE(lruc.find(ca, -1));
+  EXPECT_EQ(42, *ca);
+  EXPECT_EQ(1u, lruc.erase(-1));
+  EXPECT_FALSE(lruc.find(ca, -1));
+
+  lruc.clear();
+  EXPECT_EQ(0, lruc.size());
+}
+
+/**
+ * Key-like lookups route to the shard owning the key.
+ */
+TEST(ScaleLRUCacheTest_Transparent, KeyLikeLookup) {
+  LRUC::ScalableLRUCache<std::string, int, LRUC::StringHashCompare> lruc{400, 4};
+
+  for (int i = 0; i < 100; i++) {
+    EXPECT_TRUE(lruc.insert(std::to_string(i), i));
+  }
+
+  decltype(lruc)::ConstAccessor ca;
+  for (int i = 0; i < 100; i++) {
+    const std::string key = std::to_string(i);
+    ASSERT_TRUE(lruc.find(ca, std::string_view{key})) << key;
+    EXPECT_EQ(i, *ca);
+    EXPECT_TRUE(lruc.contains(key.c_str()));
+  }
+
+  EXPECT_EQ(1u, lruc.erase(std::string_view{"42"}));
+  EXPECT_FALSE(lruc.contains("42"));
+  EXPECT_EQ(99, lruc.size());
+}
+
+/**
+ * The promotion throttle is set on every shard, hits on the recently inserted keys are skipped.
+ */
+TEST(ScaleLRUCacheTest_Promotion, Throttle) {
+  constexpr size_t shardCount = 4;
+  LRUC::ScalableLRUCache<int,
+                         int,
+                         tbb::tbb_hash_compare<int>,
+                         LRUC::SlabAllocator<std::pair<const int, int>>,
+                         LRUC::UnitWeigher,
+                         LRUC::BasicLRUShard<LRUC::ThreadStats>>
+    lruc{400, shardCount};
+  lruc.set_promotion_throttle({1.0, std::chrono::milliseconds{0}});
+  decltype(lruc)::ConstAccessor ca;
+
+  for (int i = 0; i < 100; i++) {
+    lruc.insert(i, i);
+  }
+  for (int i = 0; i < 100; i++) {
+    EXPECT_TRUE(lruc.find(ca, i));
+  }
+
+  EXPECT_EQ(100u, lruc.stats().skipped_promotions);
+  for (size_t i = 0; i < shardCount; i++) {
+    EXPECT_EQ(lruc.stats(i).hits, lruc.stats(i).skipped_promotions);
+  }
+}
+
+/**
+ * peek() is routed to the shard owning the key, for both shard policies.
+ */
+TEST(ScaleLRUCacheTest_Peek, RoutedToShard) {
+  auto check = [](auto& lruc) {
+    using Cache = std::decay_t<decltype(lruc)>;
+
+    for (int i = 0; i < 100; i++) {
+      EXPECT_TRUE(lruc.insert(i, i));
+    }
+
+    typename Cache::ConstAccessor ca;
+    for (int i = 0; i < 100; i++) {
+      ASSERT_TRUE(lruc.peek(ca, i)) << i;
+      EXPECT_EQ(i, *ca);
+      ASSERT_TRUE(lruc.peek(ca, Cache::hashed_key(i))) << i;
+      EXPECT_EQ(i, *ca);
+    }
+    EXPECT_FALSE(lruc.peek(ca, 100));
+    EXPECT_FALSE(lruc.contains(100));
+  };
+
+  LRUC::ScalableLRUCache<int, int> lru{400, 4};
+  check(lru);
+
+  LRUC::ScalableLRUCache<int,
+                         int,
+                         tbb::tbb_hash_compare<int>,
+                         LRUC::SlabAllocator<std::pair<const int, int>>,
+                         LRUC::UnitWeigher,
+                         LRUC::S3FIFOShard>
+    s3fifo{400, 4};
+  check(s3fifo);
+}
+
+/**
+ * HashedKey handles are routed to the shard owning the key, for both shard policies.
+ */
+TEST(ScaleLRUCacheTest_HashedKey, FindInsertErase) {
+  auto check = [](auto& lruc) {
+    using Cache = std::decay_t<decltype(lruc)>;
+
+    for (int i = 0; i < 100; i++) {
+      EXPECT_TRUE(lruc.insert(Cache::hashed_key(i), i));
+    }
+
+    typename Cache::ConstAccessor ca;
+    for (int i = 0; i < 100; i++) {
+      ASSERT_TRUE(lruc.find(ca, i)) << i;
+      EXPECT_EQ(i, *ca);
+    }
+
+    const int key = 42;
+    EXPECT_EQ(1u, lruc.erase(Cache::hashed_key(key)));
+    EXPECT_FALSE(lruc.find(ca, Cache::hashed_key(key)));
+    EXPECT_EQ(99, lruc.size());
+  };
+
+  LRUC::ScalableLRUCache<int, int> lru{400, 4};
+  check(lru);
+
+  LRUC::ScalableLRUCache<int,
+                         int,
+                         tbb::tbb_hash_compare<int>,
+                         LRUC::SlabAllocator<std::pair<const int, int>>,
+                         LRUC::UnitWeigher,
+                         LRUC::S3FIFOShard>
+    s3fifo{400, 4};
+  check(s3fifo);
+}
+
+/**
+ * Shards of BasicLRUShard<ThreadStats> count, stats() sums the shards and the exports list them.
+ */
+TEST(ScaleLRUCacheTest_Stats, PerShardAndTotal) {
+  constexpr size_t shardCount = 4;
+  LRUC::ScalableLRUCache<int,
+                         int,
+                         tbb::tbb_hash_compare<int>,
+                         LRUC::SlabAllocator<std::pair<const int, int>>,
+                         LRUC::UnitWeigher,
+                         LRUC::BasicLRUShard<LRUC::ThreadStats>>
+    lruc{400, shardCount};
+  decltype(lruc)::ConstAccessor ca;
+
+  for (int i = 0; i < 100; i++) {
+    lruc.insert(i, i);
+  }
+  for (int i = 0; i < 200; i++) {
+    lruc.find(ca, i);
+  }
+
+  LRUC::CacheStats sum;
+  for (size_t i = 0; i < shardCount; i++) {
+    sum += lruc.stats(i);
+  }
+
+  const LRUC::CacheStats total = lruc.stats();
+  EXPECT_EQ(100u, total.hits);
+  EXPECT_EQ(100u, total.misses);
+  EXPECT_EQ(sum.hits, total.hits);
+  EXPECT_EQ(sum.misses, total.misses);
+  EXPECT_EQ(0u, lruc.stats(shardCount).hits);
+
+  const std::string text = lruc.stats_prometheus("lruc");
+  EXPECT_NE(std::string::npos, text.find("lruc_hits_total{shard=\"0\"} " + std::to_string(lruc.stats(0).hits) + "\n"));
+  EXPECT_NE(std::string::npos, text.find("lruc_hits_total{shard=\"3\"}"));
+
+  const std::string json = lruc.stats_json();
+  EXPECT_EQ(0u, json.find("{\"total\":" + total.to_json() + ",\"shards\":[" + lruc.stats(0).to_json() + ","));
+}
+
+TEST(ScaleLRUCacheTest_Stats, Latency) {
+  constexpr size_t shardCount = 4;
+  LRUC::ScalableLRUCache<int,
+                         int,
+                         tbb::tbb_hash_compare<int>,
+                         LRUC::SlabAllocator<std::pair<const int, int>>,
+                         LRUC::UnitWeigher,
+                         LRUC::BasicLRUShard<LRUC::LatencyStats<1>>>
+    lruc{400, shardCount};
+  decltype(lruc)::ConstAccessor ca;
+
+  for (int i = 0; i < 100; i++) {
+    lruc.insert(i, i);
+  }
+  for (int i = 0; i < 200; i++) {
+    lruc.find(ca, i);
+  }
+
+  uint64_t finds = 0;
+  for (size_t i = 0; i < shardCount; i++) {
+    finds += lruc.latency(i)[LRUC::LatencyOp::Find].count();
+  }
+
+  const LRUC::LatencySnapshot latency = lruc.latency();
+  EXPECT_EQ(200u, latency[LRUC::LatencyOp::Find].count());
+  EXPECT_EQ(100u, latency[LRUC::LatencyOp::Insert].count());
+  EXPECT_EQ(200u, finds);
+  EXPECT_EQ(0u, lruc.latency(shardCount)[LRUC::LatencyOp::Find].count());
+}
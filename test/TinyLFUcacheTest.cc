@@ -0,0 +1,181 @@
+/**
+ * Unit Test for TinyLFUCache with type:
+ *
+ * key type: IpAddress
+ * value type: CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>>
+ */
+#include "lrucache_common.h"
+
+#include <numeric>
+
+using namespace testing;
+
+/**
+ * Init. TinyLFUCache with 255 entries
+ */
+class TinyLFUCacheTest : public Test {
+protected:
+  constexpr static int LRUC_SIZE = 255;
+  constexpr static int EXPIRYTS = 42;
+
+  // IPv4 a.b.c.d with 'a' stick to 192 and 'b', 'c', 'd' has the range [from,to)
+  constexpr static int bfrom{0};
+  constexpr static int bto{1};
+  constexpr static int cfrom{0};
+  constexpr static int cto{1};
+  constexpr static int dfrom{0};
+  constexpr static int dto{255};
+
+  std::random_device rd{};
+  std::mt19937 gen{rd()};
+
+  IPTinyLFUCache lruc{LRUC_SIZE};
+
+protected:
+  void SetUp() override { ipJob(lruc, bfrom, bto, cfrom, cto, dfrom, dto, EXPIRYTS); }
+  void TearDown() override {}
+};
+
+/**
+ * Single thread access TinyLFU cache test.
+ */
+TEST_F(TinyLFUCacheTest, TestSingleThread) {
+  ASSERT_EQ(LRUC_SIZE, lruc.size()) << "cache.size() result not match";
+  ASSERT_EQ(LRUC_SIZE, lruc.capacity()) << "cache.capacity() result not match";
+
+  // random generator
+  std::uniform_int_distribution<> rangeD{0, 254};
+  std::uniform_int_distribution<> rangeFalseB{1, 254};
+
+  std::stringstream randomFalseIPv4;
+  randomFalseIPv4 << "192." << rangeFalseB(gen) << ".0." << rangeD(gen);
+
+  IPTinyLFUCache::ConstAccessor ca;
+  EXPECT_FALSE(lruc.find(ca, create_IpAddress(randomFalseIPv4.str())))
+      << "IP [" << randomFalseIPv4.str() << "] shouldn't be found in lru-cache";
+  EXPECT_TRUE(ca.empty());
+
+  std::stringstream randomIPv4;
+  randomIPv4 << "192.0.0." << rangeD(gen);
+  EXPECT_TRUE(lruc.find(ca, create_IpAddress(randomIPv4.str())))
+      << "IP [" << randomIPv4.str() << "] can't be found in lru-cache";
+  EXPECT_EQ(EXPIRYTS, ca->expiryTs);
+  ca.release();
+  EXPECT_TRUE(ca.empty());
+
+  EXPECT_EQ(1u, lruc.erase(create_IpAddress(randomIPv4.str())));
+  EXPECT_EQ(0u, lruc.erase(create_IpAddress(randomIPv4.str())));
+  EXPECT_EQ(LRUC_SIZE - 1, lruc.size());
+
+  EXPECT_TRUE(lruc.insert(create_IpAddress(randomIPv4.str()), create_cache_value(EXPIRYTS)));
+  EXPECT_FALSE(lruc.insert(create_IpAddress(randomIPv4.str()), create_cache_value(EXPIRYTS)));
+  EXPECT_EQ(LRUC_SIZE, lruc.size());
+
+  lruc.clear();
+  EXPECT_FALSE(lruc.find(ca, create_IpAddress(randomIPv4.str()))) << "cache cleared but IP key still can be found";
+  EXPECT_EQ(0, lruc.size()) << "cache cleared but size still show not 0";
+
+  ASSERT_EQ(LRUC_SIZE, lruc.capacity()) << "cache.capacity() result not match";
+}
+
+/**
+ * multi-threads access TinyLFU cache test.
+ *
+ * Insert/find/erase new IPs into a fully filled cache concurrently, the size never exceeds the capacity.
+ */
+TEST_F(TinyLFUCacheTest, TestMultiThread) {
+  std::vector<int> keys(LRUC_SIZE * 4);
+  std::iota(keys.begin(), keys.end(), 0);
+
+  tbb::parallel_for_each(begin(keys), end(keys), [this](int key) {
+    auto ip = create_IpAddress(getIPv4(1 + key / 255, 0, key % 255));
+
+    lruc.insert(ip, create_cache_value(EXPIRYTS));
+    IPTinyLFUCache::ConstAccessor ca;
+    if (lruc.find(ca, ip)) {
+      EXPECT_EQ(EXPIRYTS, ca->expiryTs);
+    }
+    EXPECT_GE(LRUC_SIZE, lruc.size());
+
+    if (key % 2) {
+      lruc.erase(ip);
+    }
+  });
+
+  EXPECT_GE(LRUC_SIZE, lruc.size()) << "cache.size() result not match";
+}
+
+/**
+ * Frequently used keys stay in the main region while a one-off scan passes through the window.
+ */
+TEST(TinyLFUCacheTest_Admission, ScanResistant) {
+  constexpr int capacity = 100;
+  constexpr int hotCnt = 50;
+  LRUC::TinyLFUCache<int, int> lruc{capacity};
+
+  // the sketch estimates, a colliding scan key may win against a hot one.
+  EXPECT_LE(hotCnt * 9 / 10, scanHotKeys(lruc, capacity, hotCnt, 3)) << "scan flushed the hot keys";
+
+  // plain LRU loses all of them.
+  LRUC::LRUCache<int, int> lru{capacity};
+  for (int key = 0; key < hotCnt; key++) {
+    lru.insert(key, key);
+  }
+  for (int key = 1000; key < 1000 + capacity * 5; key++) {
+    lru.insert(key, key);
+  }
+  LRUC::LRUCache<int, int>::ConstAccessor lca;
+  EXPECT_FALSE(lru.find(lca, 0));
+}
+
+/**
+ * A new key does win the admission once it is used more often than the main victim.
+ */
+TEST(TinyLFUCacheTest_Admission, FrequentCandidateAdmitted) {
+  constexpr int capacity = 100;
+  LRUC::TinyLFUCache<int, int> lruc{capacity};
+  LRUC::TinyLFUCache<int, int>::ConstAccessor ca;
+
+  for (int key = 0; key < capacity; key++) {
+    lruc.insert(key, key);
+  }
+  ASSERT_EQ(static_cast<size_t>(capacity), lruc.size());
+
+  constexpr int newKey = 4242;
+  for (int i = 0; i < 5; i++) {
+    EXPECT_FALSE(lruc.find(ca, newKey));
+  }
+  lruc.insert(newKey, newKey);
+
+  // pass it through the window by a few one-off keys.
+  for (int key = 1000; key < 1010; key++) {
+    lruc.insert(key, key);
+  }
+
+  EXPECT_TRUE(lruc.find(ca, newKey));
+  EXPECT_EQ(newKey, *ca);
+  EXPECT_EQ(static_cast<size_t>(capacity), lruc.size());
+}
+
+/**
+ * peek() and contains() find resident keys only, without recording them into the sketch.
+ */
+TEST(TinyLFUCacheTest_Peek, ResidentKeys) {
+  LRUC::TinyLFUCache<int, int> lruc{100};
+  LRUC::TinyLFUCache<int, int>::ConstAccessor ca;
+
+  for (int key = 0; key < 10; key++) {
+    lruc.insert(key, key * 2);
+  }
+
+  for (int key = 0; key < 10; key++) {
+    ASSERT_TRUE(lruc.peek(ca, key)) << key;
+    EXPECT_EQ(key * 2, *ca);
+    EXPECT_TRUE(lruc.contains(key));
+  }
+  EXPECT_FALSE(lruc.peek(ca, 10));
+  EXPECT_FALSE(lruc.contains(10));
+
+  EXPECT_EQ(1u, lruc.erase(3));
+  EXPECT_FALSE(lruc.contains(3));
+}
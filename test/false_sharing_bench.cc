@@ -0,0 +1,97 @@
+/**
+ * False sharing benchmarks of the LRUCache size counter and field layout.
+ *
+ * BM_SharedCounter and BM_StripedCounter count from 1 to 64 threads into one std::atomic and into
+ * one LRUC::StripedCounter respectively, one iteration per add; with threads on several cores the
+ * shared atomic bounces its cache line, the striped counter does not.
+ *
+ * BM_FindInsertSize runs find/insert on one shared LRUCache, each thread reading size() every
+ * SIZE_PERIOD accesses.
+ */
+#include <benchmark/benchmark.h>
+
+#include <cache_line.h>
+#include <lrucache_common.h>
+
+#include <atomic>
+#include <cstdint>
+
+namespace {
+
+constexpr size_t CACHE_SIZE = 2'000;
+constexpr int KEY_CNT = 4'000;
+constexpr int SIZE_PERIOD = 64;
+
+constexpr int maxThreads = 64;
+
+// padded off the neighbouring globals, thus only the threads themselves share its line.
+alignas(LRUC::CacheLineSize) std::atomic<int64_t> sharedCounter{0};
+LRUC::StripedCounter* stripedCounter;
+LRUC::LRUCache<int, int>* lruc;
+
+}  // namespace
+
+/**
+ * Adds to one std::atomic shared by all threads.
+ */
+static void BM_SharedCounter(benchmark::State& state) {
+  for (auto _ : state) {
+    sharedCounter.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SharedCounter)->ThreadRange(1, maxThreads);
+
+/**
+ * Adds to one LRUC::StripedCounter shared by all threads.
+ */
+static void BM_StripedCounter(benchmark::State& state) {
+  if (state.thread_index == 0) {
+    stripedCounter = new LRUC::StripedCounter{};
+  }
+
+  for (auto _ : state) {
+    stripedCounter->add(1);
+  }
+
+  state.SetItemsProcessed(state.iterations());
+
+  if (state.thread_index == 0) {
+    delete stripedCounter;
+  }
+}
+BENCHMARK(BM_StripedCounter)->ThreadRange(1, maxThreads);
+
+/**
+ * find/insert on one LRUCache shared by all threads, reading size() every SIZE_PERIOD accesses.
+ */
+static void BM_FindInsertSize(benchmark::State& state) {
+  if (state.thread_index == 0) {
+    lruc = new LRUC::LRUCache<int, int>{CACHE_SIZE};
+  }
+
+  int key = state.thread_index * KEY_CNT / state.threads;
+  int64_t size = 0;
+  for (auto _ : state) {
+    key = (key + 1) % KEY_CNT;
+
+    LRUC::LRUCache<int, int>::ConstAccessor ca;
+    if (!lruc->find(ca, key)) {
+      lruc->insert(key, key);
+    }
+
+    if (key % SIZE_PERIOD == 0) {
+      benchmark::DoNotOptimize(size += lruc->size());
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations());
+
+  if (state.thread_index == 0) {
+    delete lruc;
+  }
+}
+BENCHMARK(BM_FindInsertSize)->ThreadRange(1, maxThreads);
+
+BENCHMARK_MAIN();
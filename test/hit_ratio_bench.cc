@@ -0,0 +1,453 @@
+/**
+ * Hit ratio comparison of the cache engines on synthetic traces.
+ *
+ * Each BM_HitRatio benchmark replays one trace through one engine, a miss inserts the key
+ * (read-through), and reports the hit ratio as counter "hit_ratio"; the time is of the whole replay.
+ *
+ * Each BM_Throughput benchmark replays the Zipf trace from several threads into one shared cache,
+ * one iteration per access.
+ *
+ * SampledLRUCache runs with several sample counts (second argument), and LRUCache/SampledLRUCache
+ * throughput with 1 to 64 threads.
+ *
+ * BM_HitRatioThrottledLRUCache replays the traces through LRUCache with try-lock promotion and a
+ * PromotionThrottle (MRU percent and window ms arguments); counter "relinks_per_hit" is the share
+ * of hits which took the list lock to promote, against the hit ratio. BM_ThroughputThrottledLRUCache
+ * shares one such cache between threads and counts the list lock waits per access.
+ */
+#include <benchmark/benchmark.h>
+
+#include <lrucache_common.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t CACHE_SIZE = 2'000;
+constexpr int KEY_CNT = 100'000;
+constexpr size_t TRACE_LEN = 1'000'000;
+constexpr double ZIPF_SKEW = 0.99;
+
+// scan trace: every SCAN_PERIOD accesses a scan of SCAN_LEN keys never seen before.
+constexpr size_t SCAN_PERIOD = 50'000;
+constexpr int SCAN_LEN = 10'000;
+
+// shifting trace: SHIFT_PERIOD accesses of Zipf alternate with SHIFT_PERIOD accesses of a
+// working set of SHIFT_SET keys sliding over keys never seen before.
+constexpr size_t SHIFT_PERIOD = 100'000;
+constexpr int SHIFT_SET = 1'500;
+
+// thread count (depends on hardware)
+constexpr size_t tcnt = 16;
+constexpr int maxThreads = 64;
+
+/**
+ * zipfTrace returns TRACE_LEN keys in [0, KEY_CNT) of Zipf distribution, key 0 is the most popular.
+ * Fixed seed, thus all engines replay the same trace.
+ */
+std::vector<int> zipfTrace() {
+  std::vector<double> cdf(KEY_CNT);
+  double sum = 0;
+  for (int i = 0; i < KEY_CNT; i++) {
+    sum += 1.0 / std::pow(static_cast<double>(i + 1), ZIPF_SKEW);
+    cdf[static_cast<size_t>(i)] = sum;
+  }
+
+  std::mt19937 gen{42};
+  std::uniform_real_distribution<double> uniform{0, sum};
+
+  std::vector<int> trace(TRACE_LEN);
+  for (auto& key : trace) {
+    key = static_cast<int>(std::lower_bound(cdf.begin(), cdf.end(), uniform(gen)) - cdf.begin());
+  }
+
+  return trace;
+}
+
+/**
+ * scanTrace returns zipfTrace() interleaved with periodic scans of one-off keys.
+ */
+std::vector<int> scanTrace() {
+  const auto zipf = zipfTrace();
+  std::vector<int> trace;
+  trace.reserve(TRACE_LEN + TRACE_LEN / SCAN_PERIOD * SCAN_LEN);
+
+  int scanKey = KEY_CNT;
+  for (size_t i = 0; i < zipf.size(); i++) {
+    if (i % SCAN_PERIOD == SCAN_PERIOD / 2) {
+      for (int j = 0; j < SCAN_LEN; j++) {
+        trace.push_back(scanKey++);
+      }
+    }
+    trace.push_back(zipf[i]);
+  }
+
+  return trace;
+}
+
+/**
+ * shiftTrace returns zipfTrace() with every other period replaced by a recency heavy phase, each
+ * access picks a key of the sliding working set, which slides by one key every 10 accesses.
+ */
+std::vector<int> shiftTrace() {
+  auto trace = zipfTrace();
+
+  std::mt19937 gen{42};
+  std::uniform_int_distribution<int> pick{0, SHIFT_SET - 1};
+
+  int base = KEY_CNT;
+  for (size_t i = 0; i < trace.size(); i++) {
+    if ((i / SHIFT_PERIOD) % 2 == 1) {
+      trace[i] = base + pick(gen);
+      base += i % 10 == 0;
+    }
+  }
+
+  return trace;
+}
+
+enum TraceKind { Zipf, ZipfScan, Shift };
+
+const std::vector<int>& trace(int kind) {
+  static const std::vector<int> zipf = zipfTrace();
+  static const std::vector<int> scan = scanTrace();
+  static const std::vector<int> shift = shiftTrace();
+
+  switch (kind) {
+    case ZipfScan:
+      return scan;
+    case Shift:
+      return shift;
+    default:
+      return zipf;
+  }
+}
+
+const char* traceLabel(int kind) {
+  switch (kind) {
+    case ZipfScan:
+      return "zipf+scan";
+    case Shift:
+      return "zipf/recency";
+    default:
+      return "zipf";
+  }
+}
+
+/**
+ * lookup returns true on a hit, one overload per engine.
+ */
+bool lookup(LRUC::LRUCache<int, int>& cache, int key) {
+  LRUC::LRUCache<int, int>::ConstAccessor ca;
+  return cache.find(ca, key);
+}
+
+bool lookup(LRUC::LRUClockCache<int, int>& cache, int key) {
+  return cache.find(key).has_value();
+}
+
+bool lookup(LRUC::TinyLFUCache<int, int>& cache, int key) {
+  LRUC::TinyLFUCache<int, int>::ConstAccessor ca;
+  return cache.find(ca, key);
+}
+
+bool lookup(LRUC::ARCCache<int, int>& cache, int key) {
+  LRUC::ARCCache<int, int>::ConstAccessor ca;
+  return cache.find(ca, key);
+}
+
+bool lookup(LRUC::S3FIFOCache<int, int>& cache, int key) {
+  LRUC::S3FIFOCache<int, int>::ConstAccessor ca;
+  return cache.find(ca, key);
+}
+
+bool lookup(LRUC::SampledLRUCache<int, int>& cache, int key) {
+  LRUC::SampledLRUCache<int, int>::ConstAccessor ca;
+  return cache.find(ca, key);
+}
+
+using ThrottledLRUCache = LRUC::LRUCache<int,
+                                         int,
+                                         tbb::tbb_hash_compare<int>,
+                                         LRUC::SlabAllocator<std::pair<const int, int>>,
+                                         LRUC::UnitWeigher,
+                                         LRUC_DEFAULT_HASH_INDEX,
+                                         LRUC::ThreadStats>;
+
+bool lookup(ThrottledLRUCache& cache, int key) {
+  ThrottledLRUCache::ConstAccessor ca;
+  return cache.find(ca, key);
+}
+
+/**
+ * makeThrottled returns a try-lock promotion LRUCache of CACHE_SIZE, throttled by mruPercent of
+ * the list and windowMs; try-lock promotion takes the list lock once per promoted hit.
+ */
+std::unique_ptr<ThrottledLRUCache> makeThrottled(int64_t mruPercent, int64_t windowMs) {
+  auto cache = std::make_unique<ThrottledLRUCache>(
+    static_cast<int>(CACHE_SIZE), std::thread::hardware_concurrency() * 8, ThrottledLRUCache::Promotion::TryLock);
+  cache->set_promotion_throttle(
+    {static_cast<double>(mruPercent) / 100.0, std::chrono::milliseconds{windowMs}});
+
+  return cache;
+}
+
+/**
+ * relinksPerHit returns the share of the hits counted in stats which were promoted.
+ */
+double relinksPerHit(const LRUC::CacheStats& stats) {
+  return stats.hits == 0 ? 0.0
+                         : static_cast<double>(stats.hits - stats.skipped_promotions) / static_cast<double>(stats.hits);
+}
+
+/**
+ * replay runs the TraceKind selected by state.range(0) through TCache, constructed of CACHE_SIZE
+ * and args.
+ */
+template <typename TCache, typename... TArgs>
+void replay(benchmark::State& state, TArgs... args) {
+  const auto& keys = trace(static_cast<int>(state.range(0)));
+
+  size_t hits = 0;
+  for (auto _ : state) {
+    TCache cache{CACHE_SIZE, args...};
+    hits = 0;
+
+    for (int key : keys) {
+      if (lookup(cache, key)) {
+        hits++;
+      } else {
+        cache.insert(key, key);
+      }
+    }
+  }
+
+  state.counters["hit_ratio"] = static_cast<double>(hits) / static_cast<double>(keys.size());
+  state.SetLabel(traceLabel(static_cast<int>(state.range(0))));
+}
+
+/**
+ * sampleArgs runs each TraceKind with SampledLRUCache sample counts 1, 5 (default) and 16.
+ */
+void sampleArgs(benchmark::internal::Benchmark* bench) {
+  for (int kind = Zipf; kind <= Shift; kind++) {
+    for (int sampleCount : {1, 5, 16}) {
+      bench->Args({kind, sampleCount});
+    }
+  }
+}
+
+/**
+ * concurrentReplay replays the Zipf trace into one TCache shared by all threads, each thread
+ * starts at its own offset of the trace.
+ */
+template <typename TCache>
+void concurrentReplay(benchmark::State& state) {
+  static TCache* cache;
+  const auto& keys = trace(Zipf);
+
+  if (state.thread_index == 0) {
+    cache = new TCache{CACHE_SIZE};
+  }
+
+  size_t i = keys.size() / static_cast<size_t>(state.threads) * static_cast<size_t>(state.thread_index);
+  size_t hits = 0;
+  for (auto _ : state) {
+    const int key = keys[i++ % keys.size()];
+    if (lookup(*cache, key)) {
+      hits++;
+    } else {
+      cache->insert(key, key);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  state.counters["hit_ratio"] = benchmark::Counter(
+    static_cast<double>(hits) / static_cast<double>(state.iterations()), benchmark::Counter::kAvgThreads);
+
+  if (state.thread_index == 0) {
+    delete cache;
+  }
+}
+
+/**
+ * throttleArgs runs each TraceKind unthrottled, with MRU percents 10, 25 and 50, and with a 1 ms
+ * window.
+ */
+void throttleArgs(benchmark::internal::Benchmark* bench) {
+  for (int kind = Zipf; kind <= Shift; kind++) {
+    bench->Args({kind, 0, 0});
+    for (int mruPercent : {10, 25, 50}) {
+      bench->Args({kind, mruPercent, 0});
+    }
+    bench->Args({kind, 0, 1});
+  }
+}
+
+}  // namespace
+
+/**
+ * Hit ratio of LRUCache.
+ */
+static void BM_HitRatioLRUCache(benchmark::State& state) {
+  replay<LRUC::LRUCache<int, int>>(state);
+}
+BENCHMARK(BM_HitRatioLRUCache)->DenseRange(Zipf, Shift)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+/**
+ * Hit ratio of LRUClockCache.
+ */
+static void BM_HitRatioLRUClockCache(benchmark::State& state) {
+  replay<LRUC::LRUClockCache<int, int>>(state);
+}
+BENCHMARK(BM_HitRatioLRUClockCache)->DenseRange(Zipf, Shift)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+/**
+ * Hit ratio of TinyLFUCache.
+ */
+static void BM_HitRatioTinyLFUCache(benchmark::State& state) {
+  replay<LRUC::TinyLFUCache<int, int>>(state);
+}
+BENCHMARK(BM_HitRatioTinyLFUCache)->DenseRange(Zipf, Shift)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+/**
+ * Hit ratio of ARCCache.
+ */
+static void BM_HitRatioARCCache(benchmark::State& state) {
+  replay<LRUC::ARCCache<int, int>>(state);
+}
+BENCHMARK(BM_HitRatioARCCache)->DenseRange(Zipf, Shift)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+/**
+ * Hit ratio of S3FIFOCache.
+ */
+static void BM_HitRatioS3FIFOCache(benchmark::State& state) {
+  replay<LRUC::S3FIFOCache<int, int>>(state);
+}
+BENCHMARK(BM_HitRatioS3FIFOCache)->DenseRange(Zipf, Shift)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+/**
+ * Hit ratio of SampledLRUCache by sample count.
+ */
+static void BM_HitRatioSampledLRUCache(benchmark::State& state) {
+  replay<LRUC::SampledLRUCache<int, int>>(state, static_cast<size_t>(state.range(1)));
+}
+BENCHMARK(BM_HitRatioSampledLRUCache)->Apply(sampleArgs)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+/**
+ * Throughput of LRUCache.
+ */
+static void BM_ThroughputLRUCache(benchmark::State& state) {
+  concurrentReplay<LRUC::LRUCache<int, int>>(state);
+}
+BENCHMARK(BM_ThroughputLRUCache)->ThreadRange(1, maxThreads);
+
+/**
+ * Throughput of LRUClockCache.
+ */
+static void BM_ThroughputLRUClockCache(benchmark::State& state) {
+  concurrentReplay<LRUC::LRUClockCache<int, int>>(state);
+}
+BENCHMARK(BM_ThroughputLRUClockCache)->Threads(1)->Threads(tcnt);
+
+/**
+ * Throughput of TinyLFUCache.
+ */
+static void BM_ThroughputTinyLFUCache(benchmark::State& state) {
+  concurrentReplay<LRUC::TinyLFUCache<int, int>>(state);
+}
+BENCHMARK(BM_ThroughputTinyLFUCache)->Threads(1)->Threads(tcnt);
+
+/**
+ * Throughput of ARCCache.
+ */
+static void BM_ThroughputARCCache(benchmark::State& state) {
+  concurrentReplay<LRUC::ARCCache<int, int>>(state);
+}
+BENCHMARK(BM_ThroughputARCCache)->Threads(1)->Threads(tcnt);
+
+/**
+ * Throughput of S3FIFOCache.
+ */
+static void BM_ThroughputS3FIFOCache(benchmark::State& state) {
+  concurrentReplay<LRUC::S3FIFOCache<int, int>>(state);
+}
+BENCHMARK(BM_ThroughputS3FIFOCache)->Threads(1)->Threads(tcnt);
+
+/**
+ * Throughput of SampledLRUCache.
+ */
+static void BM_ThroughputSampledLRUCache(benchmark::State& state) {
+  concurrentReplay<LRUC::SampledLRUCache<int, int>>(state);
+}
+BENCHMARK(BM_ThroughputSampledLRUCache)->ThreadRange(1, maxThreads);
+
+/**
+ * Hit ratio and list relinks per hit of LRUCache by promotion throttle.
+ */
+static void BM_HitRatioThrottledLRUCache(benchmark::State& state) {
+  const auto& keys = trace(static_cast<int>(state.range(0)));
+
+  size_t hits = 0;
+  LRUC::CacheStats stats;
+  for (auto _ : state) {
+    auto cache = makeThrottled(state.range(1), state.range(2));
+    hits = 0;
+
+    for (int key : keys) {
+      if (lookup(*cache, key)) {
+        hits++;
+      } else {
+        cache->insert(key, key);
+      }
+    }
+
+    stats = cache->stats();
+  }
+
+  state.counters["hit_ratio"] = static_cast<double>(hits) / static_cast<double>(keys.size());
+  state.counters["relinks_per_hit"] = relinksPerHit(stats);
+  state.SetLabel(traceLabel(static_cast<int>(state.range(0))));
+}
+BENCHMARK(BM_HitRatioThrottledLRUCache)->Apply(throttleArgs)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+/**
+ * Throughput of LRUCache by promotion throttle (MRU percent argument), with the list lock waits
+ * and the relinks per hit.
+ */
+static void BM_ThroughputThrottledLRUCache(benchmark::State& state) {
+  static std::unique_ptr<ThrottledLRUCache> cache;
+  const auto& keys = trace(Zipf);
+
+  if (state.thread_index == 0) {
+    cache = makeThrottled(state.range(0), 0);
+  }
+
+  size_t i = keys.size() / static_cast<size_t>(state.threads) * static_cast<size_t>(state.thread_index);
+  for (auto _ : state) {
+    const int key = keys[i++ % keys.size()];
+    if (!lookup(*cache, key)) {
+      cache->insert(key, key);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations());
+
+  if (state.thread_index == 0) {
+    const LRUC::CacheStats stats = cache->stats();
+    state.counters["hit_ratio"] = stats.hit_ratio();
+    state.counters["relinks_per_hit"] = relinksPerHit(stats);
+    state.counters["lock_waits_per_access"] =
+      static_cast<double>(stats.lock_waits) / static_cast<double>(stats.hits + stats.misses);
+    cache.reset();
+  }
+}
+BENCHMARK(BM_ThroughputThrottledLRUCache)->Arg(0)->Arg(25)->Threads(1)->Threads(tcnt);
+
+BENCHMARK_MAIN();
@@ -2,6 +2,14 @@
 
 #include <lrucache_common.h>
 
+#include <tbb/scalable_allocator.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
 using namespace AtsPluginUtils;
 
 using IPVec = std::vector<std::tuple<IpAddress, CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>>>;
@@ -13,6 +21,49 @@ IPVec* randomIPs;
 // thread count (depends on hardware)
 constexpr size_t tcnt = 16;
 
+// heap allocation counters, enabled only inside the footprint benchmarks.
+std::atomic<bool> countAlloc{false};
+std::atomic<size_t> allocCnt{0};
+std::atomic<size_t> allocBytes{0};
+
+/**
+ * Replaced global allocation functions, used for counting the heap allocations made by the cache
+ * through operator new. tbb::concurrent_hash_map allocates its own nodes via tbb_allocator thus
+ * those are not counted.
+ */
+void* operator new(std::size_t size) {
+  if (countAlloc.load(std::memory_order_relaxed)) {
+    allocCnt.fetch_add(1, std::memory_order_relaxed);
+    allocBytes.fetch_add(size, std::memory_order_relaxed);
+  }
+
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+void* operator new[](std::size_t size) {
+  return ::operator new(size);
+}
+
+void operator delete[](void* p) noexcept {
+  ::operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+  ::operator delete(p);
+}
+
 /**
  * Benchmark for LRUCache find and insert in each thread.
  */
@@ -444,4 +495,596 @@ BENCHMARK(BM_LRUCacheConcurrentFindInsertErase_3)
     // ->Name("[concurrent] Find/Insert/Erase same key in different Thread")
     ->Threads(tcnt);
 
+/**
+ * Benchmark for LRUCache heap footprint of the LRU list.
+ *
+ * Reports the operator new allocations and bytes per inserted entry.
+ */
+static void BM_LRUCacheInsertFootprint_1(benchmark::State& state) {
+  // keep those const variables inside the function and make it as constexpr
+  constexpr int LRUC_SIZE = 65'025;
+  constexpr int bfrom{0};
+  constexpr int bto{1};
+  constexpr int cfrom{0};
+  constexpr int cto{255};
+  constexpr int dfrom{0};
+  constexpr int dto{255};
+  constexpr int EXPIRYTS{42};
+
+  IPVec ips;
+  ipJob(ips, bfrom, bto, cfrom, cto, dfrom, dto, EXPIRYTS);
+
+  size_t allocs = 0;
+  size_t bytes = 0;
+
+  for (auto _ : state) {
+    IPLRUCache cache{LRUC_SIZE};
+
+    allocCnt = 0;
+    allocBytes = 0;
+    countAlloc = true;
+    for (const auto& [ip, value] : ips) {
+      cache.insert(ip, value);
+    }
+    countAlloc = false;
+
+    allocs = allocCnt.load();
+    bytes = allocBytes.load();
+  }
+
+  state.counters["allocs_per_entry"] = static_cast<double>(allocs) / static_cast<double>(ips.size());
+  state.counters["bytes_per_entry"] = static_cast<double>(bytes) / static_cast<double>(ips.size());
+}
+BENCHMARK(BM_LRUCacheInsertFootprint_1);
+// ->Name("Insert heap footprint");
+
+using StringLRUCache = LRUC::LRUCache<int, std::string>;
+
+/**
+ * insertStringValue runs one benchmark iteration per insert of a std::string value into a fresh key.
+ * Value preparation is excluded from timing and from the allocation counters.
+ *
+ * Reports the operator new allocations per insert, each allocation of the value is a copy
+ * since the value length is beyond the small string optimization.
+ */
+template <typename TInsert>
+void insertStringValue(benchmark::State& state, TInsert&& insert) {
+  constexpr int LRUC_SIZE = 1'000'000;
+  constexpr size_t VALUE_LEN = 128;
+
+  StringLRUCache cache{LRUC_SIZE};
+  int key = 0;
+  size_t allocs = 0;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::string value(VALUE_LEN, 'v');
+    allocCnt = 0;
+    countAlloc = true;
+    state.ResumeTiming();
+
+    insert(cache, key++ % LRUC_SIZE, std::move(value));
+
+    state.PauseTiming();
+    countAlloc = false;
+    allocs += allocCnt.load();
+    state.ResumeTiming();
+  }
+
+  state.counters["allocs_per_insert"] = static_cast<double>(allocs) / static_cast<double>(state.iterations());
+}
+
+/**
+ * Benchmark for LRUCache insert std::string value by const reference.
+ */
+static void BM_LRUCacheStringInsertCopy_1(benchmark::State& state) {
+  insertStringValue(state, [](StringLRUCache& cache, int key, std::string&& value) {
+    const std::string& ref = value;
+    cache.insert(key, ref);
+  });
+}
+BENCHMARK(BM_LRUCacheStringInsertCopy_1);
+// ->Name("Insert std::string by copy");
+
+/**
+ * Benchmark for LRUCache insert std::string value by rvalue reference.
+ */
+static void BM_LRUCacheStringInsertMove_1(benchmark::State& state) {
+  insertStringValue(state, [](StringLRUCache& cache, int key, std::string&& value) {
+    cache.insert(key, std::move(value));
+  });
+}
+BENCHMARK(BM_LRUCacheStringInsertMove_1);
+// ->Name("Insert std::string by move");
+
+/**
+ * Benchmark for LRUCache emplace std::string value from constructor arguments.
+ */
+static void BM_LRUCacheStringEmplace_1(benchmark::State& state) {
+  insertStringValue(state, [](StringLRUCache& cache, int key, std::string&& value) {
+    cache.emplace(key, value.size(), 'v');
+  });
+}
+BENCHMARK(BM_LRUCacheStringEmplace_1);
+// ->Name("Emplace std::string");
+
+/**
+ * batchInsertFind runs one benchmark iteration per batch of random keys, inserting the batch
+ * into a cache at half of the key range thus inserts evict, then looking the batch up.
+ * Batch preparation is excluded from timing.
+ */
+template <typename TBatchOp>
+void batchInsertFind(benchmark::State& state, TBatchOp&& batchOp) {
+  // keep those const variables inside the function and make it as constexpr
+  constexpr int KEY_CNT = 65'025;
+  constexpr int LRUC_SIZE = KEY_CNT / 2;
+  constexpr int bfrom{0};
+  constexpr int bto{1};
+  constexpr int cfrom{0};
+  constexpr int cto{255};
+  constexpr int dfrom{0};
+  constexpr int dto{255};
+  constexpr int EXPIRYTS{42};
+
+  const size_t batchSize = static_cast<size_t>(state.range(0));
+
+  // init. random device.
+  std::random_device rd{};
+  std::mt19937 gen{rd()};
+
+  // uniform distribution device
+  std::uniform_int_distribution<size_t> pick{0, KEY_CNT - 1};
+
+  // init. benchmark suite variables.
+  if (state.thread_index == 0) {
+    lruc = new IPLRUCache{LRUC_SIZE};
+    randomIPs = new IPVec;
+    // init. random ip vector
+    ipJob(*randomIPs, bfrom, bto, cfrom, cto, dfrom, dto, EXPIRYTS);
+  }
+
+  IPVec batch;
+  std::vector<IpAddress> keys;
+  std::vector<std::optional<CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>>> results;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    batch.clear();
+    keys.clear();
+    results.clear();
+    for (size_t i = 0; i < batchSize; i++) {
+      batch.push_back((*randomIPs)[pick(gen)]);
+      keys.push_back(std::get<0>((*randomIPs)[pick(gen)]));
+    }
+    state.ResumeTiming();
+
+    batchOp(batch, keys, results);
+  }
+
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(batchSize));
+
+  // cleanup benchmark suite variables.
+  if (state.thread_index == 0) {
+    delete randomIPs;
+    delete lruc;
+  }
+}
+
+/**
+ * Benchmark for LRUCache multi_insert and multi_find in each thread, across batch sizes.
+ */
+static void BM_LRUCacheConcurrentMultiInsertFind_1(benchmark::State& state) {
+  batchInsertFind(state, [](const IPVec& batch, const std::vector<IpAddress>& keys, auto& results) {
+    lruc->multi_insert(batch.begin(), batch.end());
+    lruc->multi_find(keys.begin(), keys.end(), std::back_inserter(results));
+  });
+}
+BENCHMARK(BM_LRUCacheConcurrentMultiInsertFind_1)
+    // ->Name("[concurrent] multi_insert/multi_find batch in each Thread")
+    ->Arg(1)
+    ->Arg(8)
+    ->Arg(32)
+    ->Arg(128)
+    ->Threads(tcnt);
+
+/**
+ * Benchmark for LRUCache insert and find of the same batches key by key, baseline of
+ * BM_LRUCacheConcurrentMultiInsertFind_1.
+ */
+static void BM_LRUCacheConcurrentLoopInsertFind_1(benchmark::State& state) {
+  batchInsertFind(state, [](const IPVec& batch, const std::vector<IpAddress>& keys, auto& results) {
+    for (auto& entry : batch) {
+      lruc->insert(std::get<0>(entry), std::get<1>(entry));
+    }
+
+    for (auto& key : keys) {
+      IPLRUCache::ConstAccessor ca{};
+      if (lruc->find(ca, key)) {
+        results.emplace_back(*ca);
+      } else {
+        results.emplace_back();
+      }
+    }
+  });
+}
+BENCHMARK(BM_LRUCacheConcurrentLoopInsertFind_1)
+    // ->Name("[concurrent] insert/find batch key by key in each Thread")
+    ->Arg(1)
+    ->Arg(8)
+    ->Arg(32)
+    ->Arg(128)
+    ->Threads(tcnt);
+
+using IPValue = CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>;
+
+template <typename TAllocator>
+using AllocIPLRUCache = LRUC::LRUCache<IpAddress, IPValue, tbb::tbb_hash_compare<IpAddress>, TAllocator>;
+
+/**
+ * churnInsert runs one benchmark iteration per insert of a random key from twice the cache
+ * capacity into a warmed up cache, thus about every other insert evicts.
+ *
+ * Reports the operator new allocations per insert, tbb::scalable_allocator does not allocate
+ * through operator new thus it is reported as zero.
+ */
+template <typename TCache>
+void churnInsert(benchmark::State& state) {
+  // keep those const variables inside the function and make it as constexpr
+  constexpr int LRUC_SIZE = 32'512;
+  constexpr int bfrom{0};
+  constexpr int bto{1};
+  constexpr int cfrom{0};
+  constexpr int cto{255};
+  constexpr int dfrom{0};
+  constexpr int dto{255};
+  constexpr int EXPIRYTS{42};
+  constexpr size_t PICK_CNT = 4096;
+
+  static TCache* cache;
+
+  // init. random device.
+  std::random_device rd{};
+  std::mt19937 gen{rd()};
+
+  // init. benchmark suite variables.
+  if (state.thread_index == 0) {
+    cache = new TCache{LRUC_SIZE};
+    randomIPs = new IPVec;
+    // init. random ip vector
+    ipJob(*randomIPs, bfrom, bto, cfrom, cto, dfrom, dto, EXPIRYTS);
+
+    // warm up, fills the cache and the allocator free lists.
+    for (auto& ip : *randomIPs) {
+      cache->insert(std::get<0>(ip), std::get<1>(ip));
+    }
+
+    allocCnt = 0;
+    countAlloc = true;
+  }
+
+  // uniform distribution device
+  std::uniform_int_distribution<size_t> pick{0, static_cast<size_t>(bto * cto * dto) - 1};
+  std::vector<size_t> picks(PICK_CNT);
+  for (auto& idx : picks) {
+    idx = pick(gen);
+  }
+
+  size_t i = 0;
+  for (auto _ : state) {
+    auto& ip = (*randomIPs)[picks[i++ % PICK_CNT]];
+    cache->insert(std::get<0>(ip), std::get<1>(ip));
+  }
+
+  // cleanup benchmark suite variables.
+  if (state.thread_index == 0) {
+    countAlloc = false;
+    state.counters["allocs_per_insert"] =
+      static_cast<double>(allocCnt.load()) / static_cast<double>(state.iterations() * state.threads);
+
+    delete randomIPs;
+    delete cache;
+  }
+}
+
+/**
+ * Benchmark for LRUCache insert/evict churn with the default per-cache slab pool.
+ */
+static void BM_LRUCacheChurnSlabAllocator_1(benchmark::State& state) {
+  churnInsert<AllocIPLRUCache<LRUC::SlabAllocator<std::pair<const IpAddress, IPValue>>>>(state);
+}
+BENCHMARK(BM_LRUCacheChurnSlabAllocator_1)
+    // ->Name("Insert/evict churn with SlabAllocator")
+    ->Threads(1)
+    ->Threads(tcnt);
+
+/**
+ * Benchmark for LRUCache insert/evict churn with tbb::scalable_allocator.
+ */
+static void BM_LRUCacheChurnScalableAllocator_1(benchmark::State& state) {
+  churnInsert<AllocIPLRUCache<tbb::scalable_allocator<std::pair<const IpAddress, IPValue>>>>(state);
+}
+BENCHMARK(BM_LRUCacheChurnScalableAllocator_1)
+    // ->Name("Insert/evict churn with tbb::scalable_allocator")
+    ->Threads(1)
+    ->Threads(tcnt);
+
+/**
+ * Benchmark for LRUCache insert/evict churn with std::allocator.
+ */
+static void BM_LRUCacheChurnStdAllocator_1(benchmark::State& state) {
+  churnInsert<AllocIPLRUCache<std::allocator<std::pair<const IpAddress, IPValue>>>>(state);
+}
+BENCHMARK(BM_LRUCacheChurnStdAllocator_1)
+    // ->Name("Insert/evict churn with std::allocator")
+    ->Threads(1)
+    ->Threads(tcnt);
+
+/**
+ * insertTailLatency times every insert of a random key from twice the cache capacity into a
+ * warmed up cache, thus about every other insert evicts. Eviction is inline, or done by the
+ * maintenance thread if background is true.
+ *
+ * Reports the per-insert latency percentiles of the last SAMPLE_CNT inserts of each thread,
+ * averaged across the threads.
+ */
+void insertTailLatency(benchmark::State& state, bool background) {
+  // keep those const variables inside the function and make it as constexpr
+  constexpr int LRUC_SIZE = 32'512;
+  constexpr int OVERSHOOT = 1024;
+  constexpr int SLACK = 256;
+  constexpr int bfrom{0};
+  constexpr int bto{1};
+  constexpr int cfrom{0};
+  constexpr int cto{255};
+  constexpr int dfrom{0};
+  constexpr int dto{255};
+  constexpr int EXPIRYTS{42};
+  constexpr size_t PICK_CNT = 4096;
+  constexpr size_t SAMPLE_CNT = 1 << 16;
+
+  // init. random device.
+  std::random_device rd{};
+  std::mt19937 gen{rd()};
+
+  // init. benchmark suite variables.
+  if (state.thread_index == 0) {
+    lruc = new IPLRUCache{LRUC_SIZE};
+    randomIPs = new IPVec;
+    // init. random ip vector
+    ipJob(*randomIPs, bfrom, bto, cfrom, cto, dfrom, dto, EXPIRYTS);
+
+    for (auto& ip : *randomIPs) {
+      lruc->insert(std::get<0>(ip), std::get<1>(ip));
+    }
+
+    if (background) {
+      lruc->start_maintenance(OVERSHOOT, SLACK);
+    }
+  }
+
+  // uniform distribution device
+  std::uniform_int_distribution<size_t> pick{0, static_cast<size_t>(bto * cto * dto) - 1};
+  std::vector<size_t> picks(PICK_CNT);
+  for (auto& idx : picks) {
+    idx = pick(gen);
+  }
+
+  // ring of the latest samples, sized up front thus recording does not allocate.
+  std::vector<int64_t> samples(SAMPLE_CNT);
+
+  size_t i = 0;
+  for (auto _ : state) {
+    auto& ip = (*randomIPs)[picks[i % PICK_CNT]];
+
+    const auto start = std::chrono::steady_clock::now();
+    lruc->insert(std::get<0>(ip), std::get<1>(ip));
+    const auto end = std::chrono::steady_clock::now();
+
+    samples[i++ % SAMPLE_CNT] = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  }
+
+  samples.resize(std::min(i, SAMPLE_CNT));
+  std::sort(samples.begin(), samples.end());
+
+  auto percentile = [&samples](double p) {
+    return samples.empty() ? 0.0 : static_cast<double>(samples[static_cast<size_t>(p * (samples.size() - 1))]);
+  };
+
+  state.counters["p50_ns"] = benchmark::Counter(percentile(0.5), benchmark::Counter::kAvgThreads);
+  state.counters["p99_ns"] = benchmark::Counter(percentile(0.99), benchmark::Counter::kAvgThreads);
+  state.counters["p999_ns"] = benchmark::Counter(percentile(0.999), benchmark::Counter::kAvgThreads);
+  state.counters["max_ns"] = benchmark::Counter(percentile(1.0), benchmark::Counter::kAvgThreads);
+
+  // cleanup benchmark suite variables.
+  if (state.thread_index == 0) {
+    state.counters["end_size"] = lruc->size();
+
+    delete randomIPs;
+    delete lruc;
+  }
+}
+
+/**
+ * Benchmark for LRUCache insert tail latency, evicting in the inserting threads.
+ */
+static void BM_LRUCacheInsertTailLatencyInline_1(benchmark::State& state) {
+  insertTailLatency(state, false);
+}
+BENCHMARK(BM_LRUCacheInsertTailLatencyInline_1)
+    // ->Name("Insert tail latency with inline eviction")
+    ->Threads(1)
+    ->Threads(tcnt);
+
+/**
+ * Benchmark for LRUCache insert tail latency, evicting in the maintenance thread.
+ */
+static void BM_LRUCacheInsertTailLatencyBackground_1(benchmark::State& state) {
+  insertTailLatency(state, true);
+}
+BENCHMARK(BM_LRUCacheInsertTailLatencyBackground_1)
+    // ->Name("Insert tail latency with background eviction")
+    ->Threads(1)
+    ->Threads(tcnt);
+
+template <typename TIndex>
+using IndexIPLRUCache = LRUC::LRUCache<IpAddress,
+                                       IPValue,
+                                       tbb::tbb_hash_compare<IpAddress>,
+                                       LRUC::SlabAllocator<std::pair<const IpAddress, IPValue>>,
+                                       LRUC::UnitWeigher,
+                                       TIndex>;
+
+/**
+ * findHit runs one benchmark iteration per find of a random cached key, the cache is filled up
+ * front and never evicts, thus it measures the hash-index probe plus the read buffer record.
+ */
+template <typename TCache>
+void findHit(benchmark::State& state) {
+  // keep those const variables inside the function and make it as constexpr
+  constexpr int LRUC_SIZE = 65'025;
+  constexpr int bfrom{0};
+  constexpr int bto{1};
+  constexpr int cfrom{0};
+  constexpr int cto{255};
+  constexpr int dfrom{0};
+  constexpr int dto{255};
+  constexpr int EXPIRYTS{42};
+  constexpr size_t PICK_CNT = 4096;
+
+  static TCache* cache;
+
+  // init. random device.
+  std::random_device rd{};
+  std::mt19937 gen{rd()};
+
+  // init. benchmark suite variables.
+  if (state.thread_index == 0) {
+    cache = new TCache{LRUC_SIZE};
+    randomIPs = new IPVec;
+    // init. random ip vector
+    ipJob(*randomIPs, bfrom, bto, cfrom, cto, dfrom, dto, EXPIRYTS);
+
+    for (auto& ip : *randomIPs) {
+      cache->insert(std::get<0>(ip), std::get<1>(ip));
+    }
+  }
+
+  // uniform distribution device
+  std::uniform_int_distribution<size_t> pick{0, static_cast<size_t>(bto * cto * dto) - 1};
+  std::vector<size_t> picks(PICK_CNT);
+  for (auto& idx : picks) {
+    idx = pick(gen);
+  }
+
+  size_t i = 0;
+  for (auto _ : state) {
+    typename TCache::ConstAccessor ca{};
+    benchmark::DoNotOptimize(cache->find(ca, std::get<0>((*randomIPs)[picks[i++ % PICK_CNT]])));
+  }
+
+  // cleanup benchmark suite variables.
+  if (state.thread_index == 0) {
+    delete randomIPs;
+    delete cache;
+  }
+}
+
+/**
+ * Benchmark for LRUCache find hits with the tbb::concurrent_hash_map index.
+ */
+static void BM_LRUCacheFindTbbIndex_1(benchmark::State& state) {
+  findHit<IndexIPLRUCache<LRUC::TbbHashIndex>>(state);
+}
+BENCHMARK(BM_LRUCacheFindTbbIndex_1)
+    // ->Name("Find hits with TbbHashIndex")
+    ->Threads(1)
+    ->Threads(tcnt);
+
+/**
+ * Benchmark for LRUCache find hits with the open-addressing index.
+ */
+static void BM_LRUCacheFindOpenIndex_1(benchmark::State& state) {
+  findHit<IndexIPLRUCache<LRUC::OpenHashIndex>>(state);
+}
+BENCHMARK(BM_LRUCacheFindOpenIndex_1)
+    // ->Name("Find hits with OpenHashIndex")
+    ->Threads(1)
+    ->Threads(tcnt);
+
+/**
+ * Benchmark for LRUCache insert/evict churn with the tbb::concurrent_hash_map index.
+ */
+static void BM_LRUCacheChurnTbbIndex_1(benchmark::State& state) {
+  churnInsert<IndexIPLRUCache<LRUC::TbbHashIndex>>(state);
+}
+BENCHMARK(BM_LRUCacheChurnTbbIndex_1)
+    // ->Name("Insert/evict churn with TbbHashIndex")
+    ->Threads(1)
+    ->Threads(tcnt);
+
+/**
+ * Benchmark for LRUCache insert/evict churn with the open-addressing index.
+ */
+static void BM_LRUCacheChurnOpenIndex_1(benchmark::State& state) {
+  churnInsert<IndexIPLRUCache<LRUC::OpenHashIndex>>(state);
+}
+BENCHMARK(BM_LRUCacheChurnOpenIndex_1)
+    // ->Name("Insert/evict churn with OpenHashIndex")
+    ->Threads(1)
+    ->Threads(tcnt);
+
+template <typename TStats>
+using StatsIPLRUCache = LRUC::LRUCache<IpAddress,
+                                       IPValue,
+                                       tbb::tbb_hash_compare<IpAddress>,
+                                       LRUC::SlabAllocator<std::pair<const IpAddress, IPValue>>,
+                                       LRUC::UnitWeigher,
+                                       LRUC_DEFAULT_HASH_INDEX,
+                                       TStats>;
+
+/**
+ * Benchmark for LRUCache find hits without stats, the baseline of the stats policies.
+ */
+static void BM_LRUCacheFindNoStats_1(benchmark::State& state) {
+  findHit<StatsIPLRUCache<LRUC::NoStats>>(state);
+}
+BENCHMARK(BM_LRUCacheFindNoStats_1)
+    // ->Name("Find hits with NoStats")
+    ->Threads(1)
+    ->Threads(tcnt);
+
+/**
+ * Benchmark for LRUCache find hits counted by ThreadStats.
+ */
+static void BM_LRUCacheFindThreadStats_1(benchmark::State& state) {
+  findHit<StatsIPLRUCache<LRUC::ThreadStats>>(state);
+}
+BENCHMARK(BM_LRUCacheFindThreadStats_1)
+    // ->Name("Find hits with ThreadStats")
+    ->Threads(1)
+    ->Threads(tcnt);
+
+/**
+ * Benchmark for LRUCache find hits counted and timed 1 in 64 by LatencyStats.
+ */
+static void BM_LRUCacheFindLatencyStats_1(benchmark::State& state) {
+  findHit<StatsIPLRUCache<LRUC::LatencyStats<64>>>(state);
+}
+BENCHMARK(BM_LRUCacheFindLatencyStats_1)
+    // ->Name("Find hits with LatencyStats<64>")
+    ->Threads(1)
+    ->Threads(tcnt);
+
+/**
+ * Benchmark for LRUCache insert/evict churn timed 1 in 64 by LatencyStats, compare with
+ * BM_LRUCacheChurnTbbIndex_1.
+ */
+static void BM_LRUCacheChurnLatencyStats_1(benchmark::State& state) {
+  churnInsert<StatsIPLRUCache<LRUC::LatencyStats<64>>>(state);
+}
+BENCHMARK(BM_LRUCacheChurnLatencyStats_1)
+    // ->Name("Insert/evict churn with LatencyStats<64>")
+    ->Threads(1)
+    ->Threads(tcnt);
+
 BENCHMARK_MAIN();
@@ -23,6 +23,7 @@
 #include <iostream>
 #include <random>
 #include <sstream>
+#include <string>
 #include <thread>
 #include <tuple>
 #include <unordered_set>
@@ -49,6 +50,34 @@ using SCALE_IPLRUCache = LRUC::ScalableLRUCache<IpAddress, CacheValue<CACHE_VALU
 
 using IPClockLRUCache = LRUC::LRUClockCache<IpAddress, CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>>;
 
+using IPTinyLFUCache = LRUC::TinyLFUCache<IpAddress, CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>>;
+
+using IPARCCache = LRUC::ARCCache<IpAddress, CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>>;
+
+using IPS3FIFOCache = LRUC::S3FIFOCache<IpAddress, CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>>;
+
+using IPSampledLRUCache = LRUC::SampledLRUCache<IpAddress, CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>>;
+
+/**
+ * StringWeigher weighs a string value by its length, for the weighted capacity tests.
+ *
+ */
+struct StringWeigher {
+  int operator()(int, const std::string& value) const {
+    return static_cast<int>(value.size());
+  }
+};
+
+/**
+ * GigabyteWeigher weighs a value of n characters as n GB, an empty value as -1.
+ *
+ */
+struct GigabyteWeigher {
+  int64_t operator()(int, const std::string& value) const {
+    return value.empty() ? -1 : static_cast<int64_t>(value.size()) * 1'000'000'000;
+  }
+};
+
 namespace {
 
 /**
@@ -155,6 +184,46 @@ void containerInsert(IPClockLRUCache& lruc, int b, int c, int d, int expiryTS) {
   lruc.insert(create_IpAddress(getIPv4(b, c, d)), create_cache_value(expiryTS));
 }
 
+/**
+ * containerInsert inserts IPv4 class C address into LRUC::TinyLFUCache with value
+ * CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>
+ *
+ */
+template <>
+void containerInsert(IPTinyLFUCache& lruc, int b, int c, int d, int expiryTS) {
+  lruc.insert(create_IpAddress(getIPv4(b, c, d)), create_cache_value(expiryTS));
+}
+
+/**
+ * containerInsert inserts IPv4 class C address into LRUC::ARCCache with value
+ * CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>
+ *
+ */
+template <>
+void containerInsert(IPARCCache& lruc, int b, int c, int d, int expiryTS) {
+  lruc.insert(create_IpAddress(getIPv4(b, c, d)), create_cache_value(expiryTS));
+}
+
+/**
+ * containerInsert inserts IPv4 class C address into LRUC::S3FIFOCache with value
+ * CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>
+ *
+ */
+template <>
+void containerInsert(IPS3FIFOCache& lruc, int b, int c, int d, int expiryTS) {
+  lruc.insert(create_IpAddress(getIPv4(b, c, d)), create_cache_value(expiryTS));
+}
+
+/**
+ * containerInsert inserts IPv4 class C address into LRUC::SampledLRUCache with value
+ * CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>
+ *
+ */
+template <>
+void containerInsert(IPSampledLRUCache& lruc, int b, int c, int d, int expiryTS) {
+  lruc.insert(create_IpAddress(getIPv4(b, c, d)), create_cache_value(expiryTS));
+}
+
 /**
  * ipJob fills the container/cache t with ranged IPv4 class address (e.g '192.b.c.d')
  * with value CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>
@@ -187,4 +256,37 @@ void ipJob(T&& t, int bfrom, int bto, int cfrom, int cto, int dfrom, int dto, in
   }
 }
 
+/**
+ * scanHotKeys is the scan-resistance scenario of the eviction policies: hotCnt keys are looked up
+ * warmRounds times, inserted on a miss, then a scan of 5 * capacity one-off keys runs through the
+ * cache, each a miss keeping the size within capacity.
+ *
+ * Returns the number of hot keys found after the scan.
+ */
+template <typename TCache>
+int scanHotKeys(TCache& lruc, int capacity, int hotCnt, int warmRounds) {
+  typename TCache::ConstAccessor ca;
+
+  for (int round = 0; round < warmRounds; round++) {
+    for (int key = 0; key < hotCnt; key++) {
+      if (!lruc.find(ca, key)) {
+        lruc.insert(key, key);
+      }
+    }
+  }
+
+  for (int key = 1000; key < 1000 + capacity * 5; key++) {
+    EXPECT_FALSE(lruc.find(ca, key));
+    lruc.insert(key, key);
+    EXPECT_GE(static_cast<size_t>(capacity), static_cast<size_t>(lruc.size()));
+  }
+
+  int hits = 0;
+  for (int key = 0; key < hotCnt; key++) {
+    hits += lruc.find(ca, key);
+  }
+
+  return hits;
+}
+
 }  // namespace
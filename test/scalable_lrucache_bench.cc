@@ -412,4 +412,111 @@ BENCHMARK(BM_ScalableLRUCacheConcurrentFindInsertErase_2)
     // ->Name("[concurrent] Scalable LRU Cache Find/Insert/Erase in different Thread")
     ->Threads(tcnt);
 
+/**
+ * batchInsertFind runs one benchmark iteration per batch of random keys, inserting the batch
+ * into a cache at half of the key range thus inserts evict, then looking the batch up.
+ * Batch preparation is excluded from timing.
+ */
+template <typename TBatchOp>
+void batchInsertFind(benchmark::State& state, TBatchOp&& batchOp) {
+  // keep those const variables inside the function and make it as constexpr
+  constexpr int KEY_CNT = 65'025;
+  constexpr int LRUC_SIZE = KEY_CNT / 2;
+  constexpr int bfrom{0};
+  constexpr int bto{1};
+  constexpr int cfrom{0};
+  constexpr int cto{255};
+  constexpr int dfrom{0};
+  constexpr int dto{255};
+  constexpr int EXPIRYTS{42};
+
+  const size_t batchSize = static_cast<size_t>(state.range(0));
+
+  // init. random device.
+  std::random_device rd{};
+  std::mt19937 gen{rd()};
+
+  // uniform distribution device
+  std::uniform_int_distribution<size_t> pick{0, KEY_CNT - 1};
+
+  // init. benchmark suite variables.
+  if (state.thread_index == 0) {
+    slruc = new SCALE_IPLRUCache{LRUC_SIZE};
+    randomIPs = new IPVec;
+    // init. random ip vector
+    ipJob(*randomIPs, bfrom, bto, cfrom, cto, dfrom, dto, EXPIRYTS);
+  }
+
+  IPVec batch;
+  std::vector<IpAddress> keys;
+  std::vector<std::optional<CacheValue<CACHE_VALUE_TYPE::TIME_ENTITY_LOOKUP_INFO>>> results;
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    batch.clear();
+    keys.clear();
+    results.clear();
+    for (size_t i = 0; i < batchSize; i++) {
+      batch.push_back((*randomIPs)[pick(gen)]);
+      keys.push_back(std::get<0>((*randomIPs)[pick(gen)]));
+    }
+    state.ResumeTiming();
+
+    batchOp(batch, keys, results);
+  }
+
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(batchSize));
+
+  // cleanup benchmark suite variables.
+  if (state.thread_index == 0) {
+    delete randomIPs;
+    delete slruc;
+  }
+}
+
+/**
+ * Benchmark for ScalableLRUCache multi_insert and multi_find in each thread, across batch sizes.
+ */
+static void BM_ScalableLRUCacheConcurrentMultiInsertFind_1(benchmark::State& state) {
+  batchInsertFind(state, [](const IPVec& batch, const std::vector<IpAddress>& keys, auto& results) {
+    slruc->multi_insert(batch.begin(), batch.end());
+    slruc->multi_find(keys.begin(), keys.end(), std::back_inserter(results));
+  });
+}
+BENCHMARK(BM_ScalableLRUCacheConcurrentMultiInsertFind_1)
+    // ->Name("[concurrent] Scalable multi_insert/multi_find batch in each Thread")
+    ->Arg(1)
+    ->Arg(8)
+    ->Arg(32)
+    ->Arg(128)
+    ->Threads(tcnt);
+
+/**
+ * Benchmark for ScalableLRUCache insert and find of the same batches key by key, baseline of
+ * BM_ScalableLRUCacheConcurrentMultiInsertFind_1.
+ */
+static void BM_ScalableLRUCacheConcurrentLoopInsertFind_1(benchmark::State& state) {
+  batchInsertFind(state, [](const IPVec& batch, const std::vector<IpAddress>& keys, auto& results) {
+    for (auto& entry : batch) {
+      slruc->insert(std::get<0>(entry), std::get<1>(entry));
+    }
+
+    for (auto& key : keys) {
+      SCALE_IPLRUCache::ConstAccessor ca{};
+      if (slruc->find(ca, key)) {
+        results.emplace_back(*ca);
+      } else {
+        results.emplace_back();
+      }
+    }
+  });
+}
+BENCHMARK(BM_ScalableLRUCacheConcurrentLoopInsertFind_1)
+    // ->Name("[concurrent] Scalable insert/find batch key by key in each Thread")
+    ->Arg(1)
+    ->Arg(8)
+    ->Arg(32)
+    ->Arg(128)
+    ->Threads(tcnt);
+
 BENCHMARK_MAIN();